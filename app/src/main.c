@@ -10,8 +10,13 @@
 #include <lib/connect/bt_connect.h>
 #include <lib/connect/usb_connect.h>
 
+#include <lib/keyboard/kb_autocal.h>
+#include <lib/keyboard/kb_configurator.h>
 #include <lib/keyboard/kb_handle.h>
+#include <lib/keyboard/kb_latency.h>
 #include <lib/keyboard/kb_settings.h>
+#include <lib/keyboard/kb_stats.h>
+#include <lib/keyboard/kb_trace.h>
 
 #include <lib/led/kb_backlight.h>
 
@@ -34,8 +39,8 @@ static struct k_thread kb_bl_thread_data;
 
 static void kb_bl_thread(void *a, void *b, void *c) {
     while (true) {
-        kb_backlight_handle();
-        k_yield();
+        k_timeout_t next_frame = kb_backlight_handle();
+        kb_backlight_wait(next_frame);
     }
 }
 #endif // CONFIG_KB_BACKLIGHT
@@ -43,6 +48,10 @@ static void kb_bl_thread(void *a, void *b, void *c) {
 static void kb_thread(void *a, void *b, void *c) {
     while (true) {
         kb_handle();
+#if CONFIG_ARCH_POSIX
+        // Simulated time only advances while waiting
+        k_busy_wait(10);
+#endif // CONFIG_ARCH_POSIX
         k_yield();
     }
 }
@@ -92,6 +101,59 @@ int main(void) {
     }
     LOG_DBG("KBSettings is ready!");
 
+#if CONFIG_KB_STATS
+    ret = kb_stats_init();
+    if (ret) {
+        LOG_ERR("KBStats init error: %d", ret);
+        return 0;
+    }
+    LOG_DBG("KBStats is ready!");
+#endif // CONFIG_KB_STATS
+
+#if CONFIG_KB_CONFIGURATOR
+    ret = kb_configurator_init();
+    if (ret) {
+        LOG_ERR("KBConfigurator init error: %d", ret);
+        return 0;
+    }
+    LOG_DBG("KBConfigurator is ready!");
+#endif // CONFIG_KB_CONFIGURATOR
+
+#if CONFIG_KB_AUTOCAL
+    ret = kb_autocal_init();
+    if (ret) {
+        LOG_ERR("KBAutocal init error: %d", ret);
+        return 0;
+    }
+    LOG_DBG("KBAutocal is ready!");
+#endif // CONFIG_KB_AUTOCAL
+
+#if CONFIG_KB_LATENCY
+    ret = kb_latency_init();
+    if (ret) {
+        LOG_ERR("KBLatency init error: %d", ret);
+        return 0;
+    }
+    LOG_DBG("KBLatency is ready!");
+#endif // CONFIG_KB_LATENCY
+
+#if CONFIG_KB_TRACE_RECORD
+    ret = kb_trace_record_init();
+    if (ret) {
+        LOG_ERR("KBTrace record init error: %d", ret);
+        return 0;
+    }
+    LOG_DBG("KBTrace recording is ready!");
+#endif // CONFIG_KB_TRACE_RECORD
+
+#if CONFIG_KB_TRACE_REPLAY
+    ret = kb_trace_replay_start(kscan);
+    if (ret) {
+        LOG_ERR("KBTrace replay error: %d", ret);
+        return 0;
+    }
+#endif // CONFIG_KB_TRACE_REPLAY
+
     k_thread_create(&kb_thread_data, kb_thread_stack, KB_THREAD_STACK_SIZE,
                     kb_thread, NULL, NULL, NULL, KB_THREAD_PRIO, 0, K_NO_WAIT);
     k_thread_name_set(&kb_thread_data, "kb_thread");
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: Apache-2.0
+#define DT_DRV_COMPAT kscan_emul
+
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/spinlock.h>
+
+#include <drivers/kscan.h>
+#include <drivers/kscan_emul.h>
+
+#include <string.h>
+
+LOG_MODULE_REGISTER(kscan_emul, CONFIG_KSCAN_LOG_LEVEL);
+
+struct kscan_emul_config {
+    const size_t key_count;
+};
+
+struct kscan_emul_data {
+    struct k_spinlock lock;
+    uint16_t *values;
+    kscan_emul_source_cb source;
+    void *source_user_data;
+};
+
+static inline void bm_set(uint32_t *bm, uint16_t idx) {
+    bm[idx / 32] |= (1u << (idx % 32));
+}
+
+// Run the sample source if set, must be called without the lock held
+static void kscan_emul_run_source(const struct device *dev) {
+    const struct kscan_emul_config *cfg = dev->config;
+    struct kscan_emul_data *data = dev->data;
+
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+    kscan_emul_source_cb source = data->source;
+    void *user_data = data->source_user_data;
+    k_spin_unlock(&data->lock, key);
+
+    if (source) {
+        source(dev, data->values, cfg->key_count, user_data);
+    }
+}
+
+static int kscan_emul_poll_normal(const struct device *dev, uint32_t *bitmap,
+                                  const uint16_t *thresholds,
+                                  uint16_t *values) {
+    const struct kscan_emul_config *cfg = dev->config;
+    struct kscan_emul_data *data = dev->data;
+    int pressed_count = 0;
+
+    kscan_emul_run_source(dev);
+
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+    for (size_t i = 0; i < cfg->key_count; ++i) {
+        uint16_t val = data->values[i];
+        if (val >= thresholds[i]) {
+            bm_set(bitmap, i);
+            pressed_count++;
+        }
+        if (values) {
+            values[i] = val;
+        }
+    }
+    k_spin_unlock(&data->lock, key);
+
+    return pressed_count;
+}
+
+static int kscan_emul_poll_race(const struct device *dev, uint32_t *bitmap,
+                                const uint16_t *thresholds, uint16_t *values) {
+    const struct kscan_emul_config *cfg = dev->config;
+    struct kscan_emul_data *data = dev->data;
+    int max_val = 0;
+    int pressed_index = -1;
+
+    kscan_emul_run_source(dev);
+
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+    for (size_t i = 0; i < cfg->key_count; ++i) {
+        uint16_t val = data->values[i];
+        if (val >= thresholds[i] && max_val < val) {
+            max_val = val;
+            pressed_index = i;
+        }
+        if (values) {
+            values[i] = val;
+        }
+    }
+    k_spin_unlock(&data->lock, key);
+
+    if (pressed_index >= 0) {
+        bm_set(bitmap, pressed_index);
+    }
+
+    return pressed_index;
+}
+
+static DEVICE_API(kscan, kscan_emul_api) = {
+    .poll_normal = &kscan_emul_poll_normal,
+    .poll_race = &kscan_emul_poll_race,
+};
+
+size_t kscan_emul_key_count(const struct device *dev) {
+    const struct kscan_emul_config *cfg = dev->config;
+    return cfg->key_count;
+}
+
+int kscan_emul_set_value(const struct device *dev, size_t key,
+                         uint16_t value) {
+    const struct kscan_emul_config *cfg = dev->config;
+    struct kscan_emul_data *data = dev->data;
+
+    if (key >= cfg->key_count) {
+        return -EINVAL;
+    }
+
+    k_spinlock_key_t lock_key = k_spin_lock(&data->lock);
+    data->values[key] = value;
+    k_spin_unlock(&data->lock, lock_key);
+
+    return 0;
+}
+
+int kscan_emul_set_values(const struct device *dev, const uint16_t *values,
+                          size_t count) {
+    const struct kscan_emul_config *cfg = dev->config;
+    struct kscan_emul_data *data = dev->data;
+
+    if (!values || count > cfg->key_count) {
+        return -EINVAL;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+    memcpy(data->values, values, count * sizeof(values[0]));
+    k_spin_unlock(&data->lock, key);
+
+    return 0;
+}
+
+int kscan_emul_set_source(const struct device *dev, kscan_emul_source_cb cb,
+                          void *user_data) {
+    struct kscan_emul_data *data = dev->data;
+
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+    data->source = cb;
+    data->source_user_data = user_data;
+    k_spin_unlock(&data->lock, key);
+
+    return 0;
+}
+
+static int kscan_emul_init(const struct device *dev) {
+    const struct kscan_emul_config *cfg = dev->config;
+
+    LOG_INF("KScan (emulated) ready: %u keys", (unsigned)cfg->key_count);
+
+    return 0;
+}
+
+#define KSCAN_EMUL_DEFINE(inst)                                                \
+    static uint16_t kscan_emul_values_##inst[DT_INST_PROP(inst, key_count)];   \
+                                                                               \
+    static struct kscan_emul_data kscan_emul_data_##inst = {                   \
+        .values = kscan_emul_values_##inst,                                    \
+    };                                                                         \
+                                                                               \
+    static const struct kscan_emul_config kscan_emul_config_##inst = {         \
+        .key_count = DT_INST_PROP(inst, key_count),                            \
+    };                                                                         \
+                                                                               \
+    DEVICE_DT_INST_DEFINE(inst, kscan_emul_init, NULL,                         \
+                          &kscan_emul_data_##inst, &kscan_emul_config_##inst,  \
+                          POST_KERNEL, CONFIG_KERNEL_INIT_PRIORITY_DEVICE,     \
+                          &kscan_emul_api);
+
+DT_INST_FOREACH_STATUS_OKAY(KSCAN_EMUL_DEFINE)
@@ -43,13 +43,11 @@ static bool kscan_key_pressed_by_threshold(const struct adc_dt_spec *spec,
                                            uint16_t *value,
                                            uint16_t threshold) {
     uint16_t val = read_io_channel(spec);
-    if (val < threshold) {
-        return false;
-    }
+    // Stored for released keys too, calibration needs their rest values
     if (value) {
         *value = val;
     }
-    return true;
+    return val >= threshold;
 }
 
 static inline void bm_set(uint32_t *bm, uint16_t idx) {
@@ -57,7 +55,8 @@ static inline void bm_set(uint32_t *bm, uint16_t idx) {
 }
 
 static int kscan_enables_poll_normal(const struct device *dev, uint32_t *bitmap,
-                                     uint16_t *thresholds, uint16_t *values) {
+                                     const uint16_t *thresholds,
+                                     uint16_t *values) {
     const struct kscan_enables_config *cfg = dev->config;
     int err;
     uint8_t key_index = 0;
@@ -98,7 +97,8 @@ gpio_set_err:
 }
 
 static int kscan_enables_poll_race(const struct device *dev, uint32_t *bitmap,
-                                   uint16_t *thresholds, uint16_t *values) {
+                                   const uint16_t *thresholds,
+                                   uint16_t *values) {
     const struct kscan_enables_config *cfg = dev->config;
     int err;
     int max_val = 0;
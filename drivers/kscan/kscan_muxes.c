@@ -40,13 +40,11 @@ static bool kscan_key_pressed_by_threshold(const struct adc_dt_spec *spec,
                                            uint16_t *value,
                                            uint16_t threshold) {
     uint16_t val = read_io_channel(spec);
-    if (val < threshold) {
-        return false;
-    }
+    // Stored for released keys too, calibration needs their rest values
     if (value) {
         *value = val;
     }
-    return true;
+    return val >= threshold;
 }
 
 static inline void bm_set(uint32_t *bm, uint16_t idx) {
@@ -54,7 +52,8 @@ static inline void bm_set(uint32_t *bm, uint16_t idx) {
 }
 
 static int kscan_muxes_poll_normal(const struct device *dev, uint32_t *bitmap,
-                                   uint16_t *thresholds, uint16_t *values) {
+                                   const uint16_t *thresholds,
+                                   uint16_t *values) {
     const struct kscan_muxes_config *cfg = dev->config;
     int err, ch_cnt;
     uint8_t key_index = 0;
@@ -93,7 +92,7 @@ static int kscan_muxes_poll_normal(const struct device *dev, uint32_t *bitmap,
 }
 
 static int kscan_muxes_poll_race(const struct device *dev, uint32_t *bitmap,
-                                 uint16_t *thresholds, uint16_t *values) {
+                                 const uint16_t *thresholds, uint16_t *values) {
     const struct kscan_muxes_config *cfg = dev->config;
     int err, ch_cnt;
     int max_val = 0;
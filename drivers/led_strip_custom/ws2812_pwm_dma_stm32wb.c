@@ -4,6 +4,8 @@
 
 #define DT_DRV_COMPAT ws2812_pwm_dma_stm32wb
 
+#include <drivers/led_strip_async.h>
+
 #include <stdint.h>
 #include <stm32wbxx_hal.h>
 #include <string.h>
@@ -24,6 +26,37 @@ LOG_MODULE_REGISTER(ws2812_pwm_dma_stm32wb, CONFIG_LED_STRIP_LOG_LEVEL);
 #define WS2812_T1H_NS 700U
 #define WS2812_RESET_US 80U
 
+/* DMA element read from RAM per WS2812 bit. CCR only ever holds values
+   below the bit period (~80 ticks), so narrower elements are enough. The
+   peripheral side always stays word sized: CCR is a 32-bit register and a
+   narrower AHB write would be replicated into every byte lane, while the
+   DMA zero-extends a narrow memory element into a word write. */
+#define WS2812_DMA_PDATAALIGN DMA_PDATAALIGN_WORD
+#if CONFIG_WS2812_STRIP_PWM_DMA_STM32WB_ELEM_BYTE
+typedef uint8_t ws_dma_elem_t;
+#define WS2812_DMA_MDATAALIGN DMA_MDATAALIGN_BYTE
+#elif CONFIG_WS2812_STRIP_PWM_DMA_STM32WB_ELEM_HALFWORD
+typedef uint16_t ws_dma_elem_t;
+#define WS2812_DMA_MDATAALIGN DMA_MDATAALIGN_HALFWORD
+#else
+typedef uint32_t ws_dma_elem_t;
+#define WS2812_DMA_MDATAALIGN DMA_MDATAALIGN_WORD
+#endif
+
+/* Bits per LED plus a single trailing 0 which keeps the line low while the
+   latch timer runs */
+#define WS2812_DMA_SEQ_LEN(led_count) ((led_count) * 24 + 1)
+
+#if CONFIG_WS2812_STRIP_PWM_DMA_STM32WB_STREAMING
+/* Circular DMA ring of two halves, each holding bits of this many LEDs */
+#define WS2812_STREAM_HALF_LEDS                                                \
+    CONFIG_WS2812_STRIP_PWM_DMA_STM32WB_STREAM_HALF_LEDS
+#define WS2812_STREAM_HALF_LEN (WS2812_STREAM_HALF_LEDS * 24)
+#define WS2812_DMA_MODE DMA_CIRCULAR
+#else
+#define WS2812_DMA_MODE DMA_NORMAL
+#endif // CONFIG_WS2812_STRIP_PWM_DMA_STM32WB_STREAMING
+
 struct ws2812_pwm_cfg {
     uint32_t bit_rate;
 
@@ -47,53 +80,81 @@ struct ws2812_pwm_data {
     uint32_t ws_period_ticks;
     uint32_t ws_t0h_ticks;
     uint32_t ws_t1h_ticks;
-    uint32_t ws_reset_slots;
-
-    struct k_sem ws_sem;
-    bool sem_release;
 
-    uint32_t *dma_buff;
-
-    size_t dma_seq_len;
+    // Double buffering: one buffer is streaming while the next frame is
+    // encoded into the other one. In streaming mode these are the two
+    // halves of the DMA ring.
+    ws_dma_elem_t *dma_buff[2];
+    size_t dma_seq_len[2];
+
+    // Index of the buffer being streamed
+    uint8_t active;
+    // Transfer or the latch period after it is in progress
+    bool busy;
+    // The other buffer holds a frame waiting for the transfer to complete
+    bool pending;
+
+    // Keeps the line low for the reset (latch) time after a transfer
+    struct k_timer latch_timer;
+
+#if CONFIG_WS2812_STRIP_PWM_DMA_STM32WB_STREAMING
+    // Frame being streamed, read from the DMA ISR
+    const struct led_rgb *stream_pixels;
+    size_t stream_len;
+    // Next LED of the frame to encode
+    size_t stream_next;
+    // Ring halves filled with zeros since the frame ended
+    uint8_t stream_zero_halves;
+#endif // CONFIG_WS2812_STRIP_PWM_DMA_STM32WB_STREAMING
+
+    led_strip_async_cb cb;
+    void *cb_user_data;
+
+    const struct device *dev;
 
     void (*post_init)(void);
 };
 
-static void ws_encode24(uint32_t grb24, uint32_t *out, size_t *pos,
+static void ws_encode24(uint32_t grb24, ws_dma_elem_t *out, size_t *pos,
                         uint32_t ws_t1h_ticks, uint32_t ws_t0h_ticks) {
     for (int bit = 23; bit >= 0; --bit) {
         bool one = (grb24 >> bit) & 1U;
-        out[(*pos)++] = one ? ws_t1h_ticks : ws_t0h_ticks;
+        out[(*pos)++] = (ws_dma_elem_t)(one ? ws_t1h_ticks : ws_t0h_ticks);
     }
 }
 
-static void ws_build_buffer(const struct device *dev, struct led_rgb *pixels,
-                            size_t num_pixels) {
+static inline uint32_t ws_pixel_grb(const struct led_rgb *pixel) {
+    return ((uint32_t)pixel->g << 16) | ((uint32_t)pixel->r << 8) |
+           ((uint32_t)pixel->b << 0);
+}
+
+#if !CONFIG_WS2812_STRIP_PWM_DMA_STM32WB_STREAMING
+
+static size_t ws_build_buffer(const struct device *dev, ws_dma_elem_t *buf,
+                              struct led_rgb *pixels, size_t num_pixels) {
     const struct ws2812_pwm_cfg *cfg = dev->config;
     struct ws2812_pwm_data *data = dev->data;
 
     size_t p = 0;
 
+    num_pixels = MIN(num_pixels, cfg->length);
+
     for (size_t i = 0; i < num_pixels; ++i) {
-        uint32_t grb = ((uint32_t)pixels[i].g << 16) |
-                       ((uint32_t)pixels[i].r << 8) |
-                       ((uint32_t)pixels[i].b << 0);
-        ws_encode24(grb, data->dma_buff, &p, data->ws_t1h_ticks,
+        ws_encode24(ws_pixel_grb(&pixels[i]), buf, &p, data->ws_t1h_ticks,
                     data->ws_t0h_ticks);
     }
 
-    /* Reset tail: keep line low by producing 0-high pulses for many bit slots.
-       For PWM1 mode, CCR=0 → output stays low for entire slot. */
-    for (uint32_t i = 0; i < data->ws_reset_slots; ++i) {
-        data->dma_buff[p++] = 0;
-    }
+    /* For PWM1 mode, CCR=0 → output stays low, the latch timer takes care
+       of the reset time */
+    buf[p++] = 0;
 
-    data->dma_seq_len = MIN(p, cfg->dma_seq_len_max);
+    return MIN(p, cfg->dma_seq_len_max);
 }
 
 /* Build DMA buffer directly from channel array using DT color_mapping. */
-static void ws_build_buffer_channels(const struct device *dev,
-                                     const uint8_t *ch, size_t nch) {
+static size_t ws_build_buffer_channels(const struct device *dev,
+                                       ws_dma_elem_t *buf, const uint8_t *ch,
+                                       size_t nch) {
     const struct ws2812_pwm_cfg *cfg = dev->config;
     struct ws2812_pwm_data *data = dev->data;
 
@@ -130,51 +191,225 @@ static void ws_build_buffer_channels(const struct device *dev,
         }
 
         uint32_t grb = ((uint32_t)g << 16) | ((uint32_t)r << 8) | (uint32_t)b;
-        ws_encode24(grb, data->dma_buff, &p, data->ws_t1h_ticks,
-                    data->ws_t0h_ticks);
+        ws_encode24(grb, buf, &p, data->ws_t1h_ticks, data->ws_t0h_ticks);
     }
 
-    /* Reset tail keeps line low */
-    for (uint32_t i = 0; i < data->ws_reset_slots; ++i) {
-        data->dma_buff[p++] = 0;
+    /* Keep line low, see ws_build_buffer */
+    buf[p++] = 0;
+
+    return MIN(p, cfg->dma_seq_len_max);
+}
+
+/* Kick DMA transfer of the active buffer into CCR each update event. */
+static void ws_start_dma(struct ws2812_pwm_data *data) {
+    /* Ensure CCR starts at 0 (idle low) before streaming */
+    __HAL_TIM_SET_COMPARE(&data->htim, data->tim_channel, 0);
+
+    /* Start PWM + DMA: HAL will trigger DMA on CC request to load CCR */
+    HAL_TIM_PWM_Start_DMA((TIM_HandleTypeDef *)&data->htim, data->tim_channel,
+                          (const uint32_t *)data->dma_buff[data->active],
+                          (uint16_t)data->dma_seq_len[data->active]);
+}
+
+/* Index of the buffer the next frame can be encoded into.
+   Drops the queued frame since it is going to be overwritten. */
+static uint8_t ws_back_buffer(struct ws2812_pwm_data *data) {
+    unsigned int key = irq_lock();
+    data->pending = false;
+    uint8_t back = data->busy ? !data->active : data->active;
+    irq_unlock(key);
+
+    return back;
+}
+
+/* Start streaming encoded 'back' buffer or queue it behind the running
+   transfer. */
+static void ws_submit(struct ws2812_pwm_data *data, uint8_t back,
+                      size_t seq_len) {
+    data->dma_seq_len[back] = seq_len;
+
+    unsigned int key = irq_lock();
+    if (data->busy) {
+        data->pending = true;
+    } else {
+        data->active = back;
+        data->busy = true;
+        ws_start_dma(data);
     }
+    irq_unlock(key);
+}
+
+/* Called by HAL from DMA ISR when the whole buffer has been transferred.
+   Only WS2812 instances drive TIM with HAL DMA, so 'htim' is always ours. */
+void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim) {
+    struct ws2812_pwm_data *data =
+        CONTAINER_OF(htim, struct ws2812_pwm_data, htim);
+
+    /* The last bit may still be clocking out, the timer keeps running with
+       the trailing 0 in CCR so the line stays low afterwards. Strip latches
+       the frame after the line stayed low for the reset time, nothing may be
+       sent before that. */
+    k_timer_start(&data->latch_timer, K_USEC(WS2812_RESET_US), K_NO_WAIT);
+}
+
+static void ws_latch_expired(struct k_timer *timer) {
+    struct ws2812_pwm_data *data =
+        CONTAINER_OF(timer, struct ws2812_pwm_data, latch_timer);
+
+    HAL_TIM_PWM_Stop_DMA(&data->htim, data->tim_channel);
 
-    data->dma_seq_len = MIN(p, cfg->dma_seq_len_max);
+    if (data->pending) {
+        data->pending = false;
+        data->active = !data->active;
+        ws_start_dma(data);
+    } else {
+        data->busy = false;
+    }
+
+    if (data->cb) {
+        data->cb(data->dev, data->cb_user_data);
+    }
 }
 
-/* Kick DMA transfer of ws_buf[] into CCR4 each update event. */
-static void ws_start_dma(const struct device *dev) {
+static int ws2812_pwm_update_rgb(const struct device *dev,
+                                 struct led_rgb *pixels, size_t num_pixels) {
     struct ws2812_pwm_data *data = dev->data;
 
-    /* Ensure CCR starts at 0 (idle low) before streaming */
+    uint8_t back = ws_back_buffer(data);
+    size_t len = ws_build_buffer(dev, data->dma_buff[back], pixels, num_pixels);
+    ws_submit(data, back, len);
+    return 0;
+}
+
+static int ws2812_pwm_update_channels(const struct device *dev,
+                                      uint8_t *channels, size_t num_channels) {
+    struct ws2812_pwm_data *data = dev->data;
+
+    uint8_t back = ws_back_buffer(data);
+    size_t len = ws_build_buffer_channels(dev, data->dma_buff[back], channels,
+                                          num_channels);
+    ws_submit(data, back, len);
+    return 0;
+}
+
+#else // CONFIG_WS2812_STRIP_PWM_DMA_STM32WB_STREAMING
+
+/* Encode next LEDs of the streamed frame into ring 'half', the rest of the
+   half is filled with zeros (line low) once the frame is over. */
+static void ws_stream_fill(struct ws2812_pwm_data *data, uint8_t half) {
+    ws_dma_elem_t *buf = data->dma_buff[half];
+    size_t p = 0;
+
+    size_t n = MIN(data->stream_len - data->stream_next,
+                   (size_t)WS2812_STREAM_HALF_LEDS);
+    for (size_t i = 0; i < n; ++i) {
+        const struct led_rgb *pixel =
+            &data->stream_pixels[data->stream_next + i];
+        ws_encode24(ws_pixel_grb(pixel), buf, &p, data->ws_t1h_ticks,
+                    data->ws_t0h_ticks);
+    }
+    data->stream_next += n;
+
+    memset(&buf[p], 0, (WS2812_STREAM_HALF_LEN - p) * sizeof(*buf));
+
+    if (n == 0) {
+        data->stream_zero_halves++;
+    }
+}
+
+/* Called from DMA ISR when ring 'half' has been transferred, the DMA is
+   streaming the other half now. */
+static void ws_stream_half_done(struct ws2812_pwm_data *data, uint8_t half) {
+    if (data->stream_zero_halves >= 2) {
+        /* The first zero half has been sent completely, the frame is out.
+           Zeros keep circulating until the latch timer stops the DMA. */
+        if (data->stream_zero_halves == 2) {
+            data->stream_zero_halves++;
+            k_timer_start(&data->latch_timer, K_USEC(WS2812_RESET_US),
+                          K_NO_WAIT);
+        }
+        return;
+    }
+
+    ws_stream_fill(data, half);
+}
+
+static void ws_start_dma(struct ws2812_pwm_data *data) {
     __HAL_TIM_SET_COMPARE(&data->htim, data->tim_channel, 0);
 
-    /* Start PWM + DMA: HAL will trigger DMA on CC4 request to load CCR4 */
     HAL_TIM_PWM_Start_DMA((TIM_HandleTypeDef *)&data->htim, data->tim_channel,
-                          (uint32_t *)data->dma_buff,
-                          (uint16_t)data->dma_seq_len);
+                          (const uint32_t *)data->dma_buff[0],
+                          (uint16_t)(WS2812_STREAM_HALF_LEN * 2));
+}
+
+void HAL_TIM_PWM_PulseFinishedHalfCpltCallback(TIM_HandleTypeDef *htim) {
+    ws_stream_half_done(CONTAINER_OF(htim, struct ws2812_pwm_data, htim), 0);
+}
+
+void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim) {
+    ws_stream_half_done(CONTAINER_OF(htim, struct ws2812_pwm_data, htim), 1);
+}
+
+static void ws_latch_expired(struct k_timer *timer) {
+    struct ws2812_pwm_data *data =
+        CONTAINER_OF(timer, struct ws2812_pwm_data, latch_timer);
+
+    HAL_TIM_PWM_Stop_DMA(&data->htim, data->tim_channel);
+    data->busy = false;
+
+    if (data->cb) {
+        data->cb(data->dev, data->cb_user_data);
+    }
 }
 
+/* 'pixels' are encoded just in time from the DMA ISR, so they must stay
+   untouched until the transfer completes. */
 static int ws2812_pwm_update_rgb(const struct device *dev,
                                  struct led_rgb *pixels, size_t num_pixels) {
+    const struct ws2812_pwm_cfg *cfg = dev->config;
     struct ws2812_pwm_data *data = dev->data;
 
-    ws_build_buffer(dev, pixels, num_pixels);
-    k_sem_reset(&data->ws_sem);
-    data->sem_release = false;
-    ws_start_dma(dev);
-    k_sem_take(&data->ws_sem, K_FOREVER);
-    HAL_TIM_PWM_Stop_DMA(&data->htim, data->tim_channel);
+    if (data->busy) {
+        return -EBUSY;
+    }
+
+    data->stream_pixels = pixels;
+    data->stream_len = MIN(num_pixels, cfg->length);
+    data->stream_next = 0;
+    data->stream_zero_halves = 0;
+
+    ws_stream_fill(data, 0);
+    ws_stream_fill(data, 1);
+
+    data->busy = true;
+    ws_start_dma(data);
     return 0;
 }
 
 static int ws2812_pwm_update_channels(const struct device *dev,
                                       uint8_t *channels, size_t num_channels) {
-    ws_build_buffer_channels(dev, channels, num_channels);
-    ws_start_dma(dev);
+    return -ENOTSUP;
+}
+
+#endif // CONFIG_WS2812_STRIP_PWM_DMA_STM32WB_STREAMING
+
+int led_strip_async_set_callback(const struct device *dev,
+                                 led_strip_async_cb cb, void *user_data) {
+    struct ws2812_pwm_data *data = dev->data;
+
+    unsigned int key = irq_lock();
+    data->cb = cb;
+    data->cb_user_data = user_data;
+    irq_unlock(key);
+
     return 0;
 }
 
+bool led_strip_async_busy(const struct device *dev) {
+    struct ws2812_pwm_data *data = dev->data;
+    return data->busy;
+}
+
 static unsigned int ws2812_pwm_length(const struct device *dev) {
     const struct ws2812_pwm_cfg *cfg = dev->config;
     return cfg->length;
@@ -228,10 +463,6 @@ static void ws_compute_timings(const struct device *dev) {
         data->ws_t1h_ticks = data->ws_period_ticks - 1;
 
     /* Reset (latch) slots = time/1.25us: */
-    data->ws_reset_slots =
-        (uint32_t)(((uint64_t)WS2812_RESET_US * 1000ULL + 1249ULL) / 1250ULL);
-    if (data->ws_reset_slots < 64)
-        data->ws_reset_slots = 64; // safe margin
 
     /* --- (Re)configure TIM2 quickly with computed ARR --- */
     TIM_HandleTypeDef *htim = (TIM_HandleTypeDef *)&data->htim;
@@ -262,12 +493,9 @@ static void ws_compute_timings(const struct device *dev) {
 
 static void ws2812_pwm_dma_isr(const void *arg) {
     struct ws2812_pwm_data *data = (struct ws2812_pwm_data *)arg;
+    /* Transfer progress is reported through HAL_TIM_PWM_PulseFinished*
+       callbacks */
     HAL_DMA_IRQHandler(&data->hdma);
-    if (data->sem_release) {
-        k_sem_give(&data->ws_sem);
-    } else {
-        data->sem_release = true;
-    }
 }
 
 static int ws2812_pwm_init(const struct device *dev) {
@@ -303,7 +531,16 @@ static int ws2812_pwm_init(const struct device *dev) {
 
     ws_compute_timings(dev);
 
-    k_sem_init(&data->ws_sem, 0, 1);
+    // Largest compare value stored in a DMA element
+    if (data->ws_t1h_ticks > (ws_dma_elem_t)-1) {
+        LOG_ERR("Compare value of %u ticks does not fit into DMA element",
+                data->ws_t1h_ticks);
+        return -EINVAL;
+    }
+
+    k_timer_init(&data->latch_timer, ws_latch_expired, NULL);
+
+    data->dev = dev;
 
     if (data->post_init) {
         data->post_init();
@@ -316,8 +553,15 @@ static int ws2812_pwm_init(const struct device *dev) {
     static const uint8_t ws2812_pwm_##idx##_color_mapping[] =                  \
         DT_INST_PROP(idx, color_mapping)
 
+#if CONFIG_WS2812_STRIP_PWM_DMA_STM32WB_STREAMING
+#define WS2812_DMA_BUFFER(idx, led_count)                                      \
+    static ws_dma_elem_t                                                       \
+        ws2812_pwm_##idx##_dma_buffer[2][WS2812_STREAM_HALF_LEN]
+#else
 #define WS2812_DMA_BUFFER(idx, led_count)                                      \
-    static uint32_t ws2812_pwm_##idx##_dma_buffer[led_count * 24 + 256]
+    static ws_dma_elem_t                                                       \
+        ws2812_pwm_##idx##_dma_buffer[2][WS2812_DMA_SEQ_LEN(led_count)]
+#endif // CONFIG_WS2812_STRIP_PWM_DMA_STM32WB_STREAMING
 
 #define WS2812_POST_INIT_FN(idx) static void ws2812_pwm_##idx##_post_init(void)
 
@@ -333,7 +577,8 @@ static int ws2812_pwm_init(const struct device *dev) {
     WS2812_DMA_BUFFER(idx, DT_INST_PROP(idx, chain_length));                   \
     WS2812_POST_INIT_FN(idx);                                                  \
     static struct ws2812_pwm_data ws2812_pwm_##idx##_data = {                  \
-        .dma_buff = ws2812_pwm_##idx##_dma_buffer,                             \
+        .dma_buff = {ws2812_pwm_##idx##_dma_buffer[0],                         \
+                     ws2812_pwm_##idx##_dma_buffer[1]},                        \
         .tim_channel = DT_INST_PROP(idx, st_tim_channel),                      \
         .post_init = ws2812_pwm_##idx##_post_init,                             \
         .hdma =                                                                \
@@ -346,9 +591,9 @@ static int ws2812_pwm_init(const struct device *dev) {
                         .Direction = DMA_MEMORY_TO_PERIPH,                     \
                         .PeriphInc = DMA_PINC_DISABLE,                         \
                         .MemInc = DMA_MINC_ENABLE,                             \
-                        .PeriphDataAlignment = DMA_PDATAALIGN_WORD,            \
-                        .MemDataAlignment = DMA_MDATAALIGN_WORD,               \
-                        .Mode = DMA_NORMAL,                                    \
+                        .PeriphDataAlignment = WS2812_DMA_PDATAALIGN,          \
+                        .MemDataAlignment = WS2812_DMA_MDATAALIGN,             \
+                        .Mode = WS2812_DMA_MODE,                               \
                         .Priority = DMA_PRIORITY_MEDIUM,                       \
                     },                                                         \
                 .Parent = (TIM_HandleTypeDef *)&ws2812_pwm_##idx##_data.htim,  \
@@ -375,7 +620,8 @@ static int ws2812_pwm_init(const struct device *dev) {
         .length = DT_INST_PROP(idx, chain_length),                             \
         .bit_rate = DT_INST_PROP(idx, bit_rate),                               \
         .num_colors = DT_INST_PROP_LEN(idx, color_mapping),                    \
-        .dma_seq_len_max = DT_INST_PROP(idx, chain_length) * 24 + 256,         \
+        .dma_seq_len_max =                                                     \
+            WS2812_DMA_SEQ_LEN(DT_INST_PROP(idx, chain_length)),               \
     };                                                                         \
     DEVICE_DT_INST_DEFINE(idx, ws2812_pwm_init, NULL,                          \
                           &ws2812_pwm_##idx##_data, &ws2812_pwm_##idx##_cfg,   \
@@ -4,19 +4,21 @@
 #include <zephyr/device.h>
 #include <zephyr/toolchain.h>
 
+// 'values', if not NULL, gets the raw sample of every key, released keys
+// included
 __subsystem struct kscan_driver_api {
     int (*poll_normal)(const struct device *dev, uint32_t *bitmap,
-                       uint16_t *thresholds, uint16_t *values);
+                       const uint16_t *thresholds, uint16_t *values);
     int (*poll_race)(const struct device *dev, uint32_t *bitmap,
-                     uint16_t *thresholds, uint16_t *values);
+                     const uint16_t *thresholds, uint16_t *values);
 };
 
 __syscall int kscan_poll_normal(const struct device *dev, uint32_t *bitmap,
-                                uint16_t *thresholds, uint16_t *values);
+                                const uint16_t *thresholds, uint16_t *values);
 
 static inline int z_impl_kscan_poll_normal(const struct device *dev,
                                            uint32_t *bitmap,
-                                           uint16_t *thresholds,
+                                           const uint16_t *thresholds,
                                            uint16_t *values) {
     __ASSERT_NO_MSG(DEVICE_API_IS(kscan, dev));
 
@@ -25,10 +27,11 @@ static inline int z_impl_kscan_poll_normal(const struct device *dev,
 }
 
 __syscall int kscan_poll_race(const struct device *dev, uint32_t *bitmap,
-                              uint16_t *threshold, uint16_t *values);
+                              const uint16_t *threshold, uint16_t *values);
 
 static inline int z_impl_kscan_poll_race(const struct device *dev,
-                                         uint32_t *bitmap, uint16_t *thresholds,
+                                         uint32_t *bitmap,
+                                         const uint16_t *thresholds,
                                          uint16_t *values) {
     __ASSERT_NO_MSG(DEVICE_API_IS(kscan, dev));
 
@@ -0,0 +1,37 @@
+#ifndef DRIVERS_KSCAN_EMUL_H_
+#define DRIVERS_KSCAN_EMUL_H_
+
+#include <zephyr/device.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Backend API of the emulated kscan driver ("kscan-emul" compatible).
+//
+// Polls report the last set raw value of every key, a key is pressed when
+// its value reaches the threshold, same as with the ADC based drivers.
+
+// Sample source invoked on every poll before the values are evaluated.
+//
+// 'values' holds 'count' raw key values from the previous poll and may be
+// changed in place, e.g. to replay a scripted press sequence.
+typedef void (*kscan_emul_source_cb)(const struct device *dev,
+                                     uint16_t *values, size_t count,
+                                     void *user_data);
+
+// Amount of emulated keys
+size_t kscan_emul_key_count(const struct device *dev);
+
+// Set raw value of key 'key'
+int kscan_emul_set_value(const struct device *dev, size_t key,
+                         uint16_t value);
+
+// Set raw values of the first 'count' keys
+int kscan_emul_set_values(const struct device *dev, const uint16_t *values,
+                          size_t count);
+
+// Set sample source invoked on every poll, NULL to disable
+int kscan_emul_set_source(const struct device *dev, kscan_emul_source_cb cb,
+                          void *user_data);
+
+#endif // DRIVERS_KSCAN_EMUL_H_
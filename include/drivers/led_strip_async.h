@@ -0,0 +1,33 @@
+#ifndef DRIVERS_LED_STRIP_ASYNC_H_
+#define DRIVERS_LED_STRIP_ASYNC_H_
+
+#include <zephyr/device.h>
+
+#include <stdbool.h>
+
+// Non-blocking extension of the LED strip API.
+//
+// Implemented by LED strip drivers selecting CONFIG_LED_STRIP_ASYNC.
+// For such drivers 'led_strip_update_rgb' and 'led_strip_update_channels'
+// only encode the frame and start (or queue) its transfer, they never wait
+// for the strip to be clocked out. The next frame can be encoded while the
+// previous one is still streaming, if a newer frame is submitted before the
+// queued one started, the queued one is dropped.
+//
+// Drivers streaming the frame just in time (e.g. WS2812 PWM DMA streaming
+// mode) read the passed pixels until the transfer completes. Such pixels must
+// not be modified while 'led_strip_async_busy', updates fail with -EBUSY
+// meanwhile.
+
+// Callback invoked from ISR every time a frame finished streaming
+typedef void (*led_strip_async_cb)(const struct device *dev,
+                                   void *user_data);
+
+// Set callback invoked when a frame finished streaming, NULL to disable
+int led_strip_async_set_callback(const struct device *dev,
+                                 led_strip_async_cb cb, void *user_data);
+
+// Whether a frame is streaming or queued
+bool led_strip_async_busy(const struct device *dev);
+
+#endif // DRIVERS_LED_STRIP_ASYNC_H_
@@ -3,6 +3,7 @@
 #ifndef LIB_BT_CONNECT_H_
 #define LIB_BT_CONNECT_H_
 
+#include <lib/keyboard/kb_key.h>
 #include <lib/keyboard/kb_settings.h>
 #include <lib/led/kb_backlight_state.h>
 
@@ -25,6 +26,28 @@ void bt_connect_send_master_kb_settings();
 
 void bt_connect_send_master_bl_state();
 
+// Forward backlight key event to the other half, sent by the key handling
+// with CONFIG_BT_INTER_KB_COMM_BL_EVENTS
+void bt_connect_send_bl_event(const kb_key_t *key);
+
+enum bt_connect_calib_op {
+    BT_CONNECT_CALIB_START = 0,
+    BT_CONNECT_CALIB_FINISH,
+    BT_CONNECT_CALIB_ABORT,
+};
+
+// Control calibration mode of the slave half (see kb_calibration.h)
+//
+// Returns -ENOTCONN if the slave half is not connected
+int bt_connect_send_master_calib(enum bt_connect_calib_op op);
+
+// Send captured calibration of key 'index' to the master half
+int bt_connect_send_slave_calib_key(uint8_t index,
+                                    const kb_settings_key_calib_t *calib);
+
+// Tell the master half all 'count' calibrated keys were sent
+int bt_connect_send_slave_calib_done(uint8_t count);
+
 bool bt_connect_is_ready();
 
 void bt_connect_start_advertising();
@@ -16,6 +16,11 @@ void usb_connect_handle_wakeup();
 
 bool usb_connect_is_ready();
 
+// Whether the keyboard is powered from USB (VBUS present)
+//
+// Falls back to 'usb_connect_is_ready' if VBUS can not be detected
+bool usb_connect_is_powered();
+
 uint32_t usb_connect_duration();
 
 #endif // LIB_USB_CONNECT_H_
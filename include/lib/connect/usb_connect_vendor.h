@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef LIB_USB_CONNECT_VENDOR_H_
+#define LIB_USB_CONNECT_VENDOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Vendor defined HID interface ('hid_vendor' node) next to the keyboard one.
+//
+// Every report is prefixed with its report ID, the payload is always
+// USB_CONNECT_VENDOR_REPORT_SIZE bytes long. Output reports arrive as
+// SET_REPORT requests, input reports are queued and sent over the interrupt
+// IN endpoint one at a time.
+
+#define USB_CONNECT_VENDOR_REPORT_SIZE 63
+
+enum usb_connect_vendor_report_id {
+    // Feature, keyboard scan loop statistics (see kb_stats.h)
+    USB_CONNECT_VENDOR_REPORT_STATS = 1,
+    // Output, configurator command (see kb_configurator.h)
+    USB_CONNECT_VENDOR_REPORT_COMMAND,
+    // Input, configurator command response
+    USB_CONNECT_VENDOR_REPORT_RESPONSE,
+    // Input, live key values stream
+    USB_CONNECT_VENDOR_REPORT_STREAM,
+
+    USB_CONNECT_VENDOR_REPORT_COUNT,
+};
+
+// Fill out feature report payload 'buf' of 'len' bytes, 'buf' is zeroed
+typedef void (*usb_connect_vendor_feature_cb)(uint8_t *buf, uint16_t len);
+
+// Handle output report payload 'buf' of 'len' bytes.
+//
+// Called from the USB stack thread, should not block.
+typedef void (*usb_connect_vendor_output_cb)(const uint8_t *buf, uint16_t len);
+
+// Register the vendor HID interface, called by 'usb_connect_init'
+int usb_connect_vendor_init();
+
+// Set 'cb' to answer GET_REPORT requests for feature report 'id'
+int usb_connect_vendor_set_feature_cb(enum usb_connect_vendor_report_id id,
+                                      usb_connect_vendor_feature_cb cb);
+
+// Set 'cb' to handle SET_REPORT requests for output report 'id'
+int usb_connect_vendor_set_output_cb(enum usb_connect_vendor_report_id id,
+                                     usb_connect_vendor_output_cb cb);
+
+// Queue input report 'id' with payload 'buf' of 'len' bytes, shorter
+// payloads are zero padded. Never blocks.
+//
+// Returns -EAGAIN if the queue is full, -ENOTCONN if the interface is not
+// ready.
+int usb_connect_vendor_send(enum usb_connect_vendor_report_id id,
+                            const uint8_t *buf, uint16_t len);
+
+bool usb_connect_vendor_is_ready();
+
+#endif // LIB_USB_CONNECT_VENDOR_H_
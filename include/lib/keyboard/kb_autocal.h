@@ -0,0 +1,51 @@
+#ifndef LIB_KB_AUTOCAL_H_
+#define LIB_KB_AUTOCAL_H_
+
+#include <lib/keyboard/kb_settings.h>
+
+#include <stdint.h>
+
+// Continuous auto-calibration.
+//
+// Resting baseline of every key is tracked with a slow low-pass filter
+// while the key is idle (released, lower half of its travel to the
+// threshold and steady). Thresholds used by the scan loop follow the
+// baseline drift from the calibrated minimum, the settings stay untouched.
+//
+// With CONFIG_KB_AUTOCAL_TEMP the 'die-temp0' sensor feeds a linear
+// temperature coefficient, so the baselines also follow temperature while
+// keys are in use. The filter then tracks what is left (magnet ageing).
+//
+// Every CONFIG_KB_AUTOCAL_PERSIST_INTERVAL_S, calibrations of keys whose
+// baseline settled at least CONFIG_KB_AUTOCAL_PERSIST_DELTA away from the
+// calibrated minimum are shifted by that drift in a single settings
+// commit, written to flash by the coalesced save.
+
+#if CONFIG_KB_AUTOCAL
+
+// Start the temperature sampling and persisting
+int kb_autocal_init();
+
+// Press thresholds for the next kscan poll
+const uint16_t *kb_autocal_thresholds(const kb_settings_t *settings);
+
+// Feed raw 'values' and pressed keys 'curr_down' of all keys, called by the
+// scan loop after every scan producing key events
+void kb_autocal_on_scan(const kb_settings_t *settings, const uint16_t *values,
+                        const uint32_t *curr_down);
+
+#else
+
+static inline const uint16_t *
+kb_autocal_thresholds(const kb_settings_t *settings) {
+    return settings->key_thresholds;
+}
+
+static inline void kb_autocal_on_scan(const kb_settings_t *settings,
+                                      const uint16_t *values,
+                                      const uint32_t *curr_down) {
+}
+
+#endif // CONFIG_KB_AUTOCAL
+
+#endif // LIB_KB_AUTOCAL_H_
@@ -0,0 +1,78 @@
+#ifndef LIB_KB_CALIBRATION_H_
+#define LIB_KB_CALIBRATION_H_
+
+#include <lib/keyboard/kb_settings.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Interactive calibration mode.
+//
+// While running, key events are suppressed and the released (minimum) and
+// bottomed out (maximum) value of every key is captured. Values go through
+// a 3 sample median filter first, so single sample spikes never become an
+// extreme. Once the window of CONFIG_KB_CALIBRATION_WINDOW_MS ends (or the
+// mode is toggled again), keys pressed through at least
+// CONFIG_KB_CALIBRATION_MIN_TRAVEL get the captured extremes, thresholds
+// keep their actuation point. Keys never pressed keep their calibration.
+//
+// On a split master the slave half is calibrated at the same time: it
+// stores its own calibration and sends the captured extremes back, which
+// are written to 'keys_calibration_slave' together with the master ones in
+// a single settings commit.
+
+enum kb_calibration_state {
+    KB_CALIBRATION_IDLE = 0,
+    KB_CALIBRATION_RUNNING,
+    // Window ended, waiting for the slave half results
+    KB_CALIBRATION_FINISHING,
+};
+
+#if CONFIG_KB_CALIBRATION
+
+// Start the calibration window
+//
+// Returns -EBUSY if calibration is already running
+int kb_calibration_start();
+
+// End the calibration window early and apply the results
+//
+// Returns -EALREADY if calibration is not running
+int kb_calibration_finish();
+
+// Drop the calibration without touching the settings
+void kb_calibration_abort();
+
+// Start calibration or finish the running one, for FN keystrokes
+void kb_calibration_toggle();
+
+enum kb_calibration_state kb_calibration_get_state();
+
+// Number of keys (of both halves) calibrated by the last finished run
+uint8_t kb_calibration_get_last_count();
+
+// Feed raw 'values' of all keys, called by the scan loop after every scan
+//
+// Returns true while calibrating, the scan should not produce key events
+bool kb_calibration_on_scan(const uint16_t *values);
+
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+
+// Captured calibration of slave key 'index', called by the split link
+void kb_calibration_on_slave_key(uint8_t index,
+                                 const kb_settings_key_calib_t *calib);
+
+// Slave half finished calibrating 'count' keys, called by the split link
+void kb_calibration_on_slave_done(uint8_t count);
+
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+
+#else
+
+static inline bool kb_calibration_on_scan(const uint16_t *values) {
+    return false;
+}
+
+#endif // CONFIG_KB_CALIBRATION
+
+#endif // LIB_KB_CALIBRATION_H_
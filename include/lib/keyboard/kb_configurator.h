@@ -0,0 +1,100 @@
+#ifndef LIB_KB_CONFIGURATOR_H_
+#define LIB_KB_CONFIGURATOR_H_
+
+#include <lib/connect/usb_connect_vendor.h>
+
+#include <stdint.h>
+
+// Configurator protocol over the vendor HID interface (see
+// usb_connect_vendor.h), used by YKBConfigurator and
+// scripts/kb_configurator.py
+//
+// Every COMMAND output report is answered with one RESPONSE input report:
+//   command:  u8 cmd, u8 tag, arguments
+//   response: u8 cmd, u8 tag, i8 status (0 or negative errno), data
+// 'tag' is chosen by the host and echoed back. Multi-byte fields are little
+// endian.
+//
+// Once enabled with KB_CONF_CMD_STREAM, raw values of every key are sent in
+// STREAM input reports:
+//   u16 frame sequence number, u32 scan uptime (us), u8 first key,
+//   u8 key count, u16 values
+// Frames of more than KB_CONF_STREAM_KEYS_PER_REPORT keys span several
+// reports with the same sequence number. Reports are dropped rather than
+// stalling the scan loop, gaps in the sequence numbers show lost frames.
+
+#define KB_CONF_PROTO_VERSION 1
+
+enum kb_conf_cmd {
+    // -> u8 protocol version, u8 key count, u8 slave key count (0 if none),
+    //    u8 max rules per key, u8 profile, u32 settings generation,
+    //    u8 stream keys per report, u16 total key travel (0.01 mm, 0 if
+    //    travel linearization is disabled)
+    KB_CONF_CMD_INFO = 0x01,
+    // u8 section, u8 first key, u8 key count
+    // -> u8 section, u8 first key, u8 key count, items
+    // Key count is lowered to what fits into a single response
+    KB_CONF_CMD_READ = 0x10,
+    // u8 section, u8 first key, u8 key count, items -> u8 key count
+    // Changes are published at once and written to flash deferred
+    KB_CONF_CMD_WRITE = 0x11,
+    // u8 op (enum kb_conf_calibrate_op) -> see the op
+    KB_CONF_CMD_CALIBRATE = 0x20,
+    // u8 interval (scans per frame, 0 stops)
+    // -> u8 interval used, u8 reports per frame
+    KB_CONF_CMD_STREAM = 0x30,
+};
+
+enum kb_conf_section {
+    // Single item (first key 0, key count 1): u8 mode, u16 polling rate (ms)
+    KB_CONF_SECTION_MAIN = 0,
+    // Per key: u16 minimum, u16 maximum, u16 threshold
+    KB_CONF_SECTION_CALIB,
+    // Per key: u8 rule count, CONFIG_KB_MAX_RULES_PER_KEY times
+    // u16 layer, u8 code (unused rules are zero)
+    KB_CONF_SECTION_KEYMAP,
+    // Slave half ones, split master only
+    KB_CONF_SECTION_CALIB_SLAVE,
+    KB_CONF_SECTION_KEYMAP_SLAVE,
+    // Per key: u16 actuation point (0.01 mm) of the threshold, keys of this
+    // half only, CONFIG_KB_TRAVEL only
+    KB_CONF_SECTION_ACTUATION,
+};
+
+enum kb_conf_calibrate_op {
+    // Take current values as released values of all keys (keys must not be
+    // touched), thresholds keep their actuation point
+    // -> u8 calibrated key count
+    KB_CONF_CALIBRATE_REST = 0,
+    // Calibration mode (see kb_calibration.h), all of them
+    // -> u8 state (enum kb_calibration_state), u8 key count calibrated by
+    //    the last finished run
+    // -ENOTSUP if the calibration mode is disabled
+    KB_CONF_CALIBRATE_START,
+    KB_CONF_CALIBRATE_FINISH,
+    KB_CONF_CALIBRATE_ABORT,
+    KB_CONF_CALIBRATE_STATUS,
+};
+
+// u16 sequence number, u32 uptime, u8 first key, u8 key count
+#define KB_CONF_STREAM_HEADER_SIZE 8
+
+#define KB_CONF_STREAM_KEYS_PER_REPORT                                         \
+    ((USB_CONNECT_VENDOR_REPORT_SIZE - KB_CONF_STREAM_HEADER_SIZE) / 2)
+
+#if CONFIG_KB_CONFIGURATOR
+
+// Register with the vendor HID interface
+int kb_configurator_init();
+
+// Feed raw 'values' of all keys, called by the scan loop after every scan
+void kb_configurator_on_scan(const uint16_t *values);
+
+#else
+
+static inline void kb_configurator_on_scan(const uint16_t *values) {
+}
+
+#endif // CONFIG_KB_CONFIGURATOR
+
+#endif // LIB_KB_CONFIGURATOR_H_
@@ -0,0 +1,59 @@
+#ifndef LIB_KB_DEPTH_H_
+#define LIB_KB_DEPTH_H_
+
+#include <lib/keyboard/kb_settings.h>
+#include <lib/keyboard/kb_travel.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Depth of a fully pressed key
+#define KB_DEPTH_MAX UINT8_MAX
+
+// Key depth (0 - KB_DEPTH_MAX) of raw 'value' within 'calib' range
+static inline uint8_t kb_depth_from_value(const kb_settings_key_calib_t *calib,
+                                          uint16_t value) {
+    if (calib->maximum <= calib->minimum || value <= calib->minimum) {
+        return 0;
+    }
+    if (value >= calib->maximum) {
+        return KB_DEPTH_MAX;
+    }
+    return (uint8_t)(((uint32_t)(value - calib->minimum) * KB_DEPTH_MAX) /
+                     (calib->maximum - calib->minimum));
+}
+
+// Key depth of raw 'value' as percentage (0 - 100) of 'calib' range
+static inline uint8_t kb_depth_percentage(const kb_settings_key_calib_t *calib,
+                                          uint16_t value) {
+    return (uint8_t)((kb_depth_from_value(calib, value) * 100u) /
+                     KB_DEPTH_MAX);
+}
+
+// Depth (0 - KB_DEPTH_MAX) of key 'index' at raw 'value', along its physical
+// travel with CONFIG_KB_TRAVEL
+static inline uint8_t kb_depth_of_key(const kb_settings_t *settings,
+                                      size_t index, uint16_t value) {
+#if CONFIG_KB_TRAVEL
+    uint32_t travel = kb_travel_from_value(&settings->key_travel[index], value);
+    return (uint8_t)((travel * KB_DEPTH_MAX) / KB_TRAVEL_MAX);
+#else
+    return kb_depth_from_value(&settings->keys_calibration[index], value);
+#endif // CONFIG_KB_TRAVEL
+}
+
+// Publish depths of all keys from freshly scanned 'values'.
+//
+// Should be called by the scan loop after every scan, never blocks.
+void kb_depth_publish(const kb_settings_t *settings, const uint16_t *values);
+
+// Copy the latest published depths of all CONFIG_KB_KEY_COUNT keys into
+// 'depths'.
+//
+// Lock-free, meant to be called once per frame by readers such as the
+// backlight. Returns -EAGAIN if the scan loop kept publishing while copying,
+// 'depths' contents are undefined then and the previous snapshot should be
+// used instead.
+int kb_depth_snapshot(uint8_t depths[CONFIG_KB_KEY_COUNT]);
+
+#endif // LIB_KB_DEPTH_H_
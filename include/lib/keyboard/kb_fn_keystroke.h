@@ -7,6 +7,7 @@
 
 #include <lib/connect/bt_connect.h>
 #include <lib/connect/usb_connect.h>
+#include <lib/keyboard/kb_calibration.h>
 #include <lib/keyboard/kb_settings.h>
 #include <lib/led/kb_backlight.h>
 
@@ -59,4 +60,11 @@ struct kb_fn_keystroke {
 #define KB_FN_KEYSTROKE_DEFINE_LIB_KB_BL(name, callback, /* keys... */...)
 #endif // CONFIG_KB_BACKLIGHT
 
+#if CONFIG_KB_CALIBRATION
+#define KB_FN_KEYSTROKE_DEFINE_LIB_KB_CALIB(name, callback, /* keys... */...)  \
+    __KB_FN_KEYSTROKE_DEFINE(name, callback, __VA_ARGS__)
+#else
+#define KB_FN_KEYSTROKE_DEFINE_LIB_KB_CALIB(name, callback, /* keys... */...)
+#endif // CONFIG_KB_CALIBRATION
+
 #endif // KB_FN_KEYSTROKE_H_
@@ -10,6 +10,7 @@ typedef struct {
     uint8_t code;
     uint8_t value; // percentage pressed
     bool pressed;
+    bool remote; // key belongs to the other half of a split keyboard
 } kb_key_t;
 
 #endif // LIB_KB_HANDLE_KEY_H_
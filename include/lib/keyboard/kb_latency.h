@@ -0,0 +1,71 @@
+#ifndef LIB_KB_LATENCY_H_
+#define LIB_KB_LATENCY_H_
+
+#include <zephyr/sys/util.h>
+#include <zephyr/toolchain.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Hot path latency tracer.
+//
+// Trace points store cycle counter timestamps into a RAM ring, which is
+// dumped to the 'ykb,latency' chosen UART and turned into per-stage
+// latency histograms by scripts/kb_latency.py.
+//
+// The sample timestamp is taken on every kscan poll but only stored once
+// a key event is marked during the same poll, so idle polling does not
+// flush the ring.
+//
+// Dump format (little endian):
+//   "YKBL" magic, u8 version, u8 stage count, u16 entry size,
+//   u32 cycles per second, u32 entry count, entries (oldest first)
+
+enum kb_latency_stage {
+    KB_LATENCY_SAMPLE = 0,    // kscan poll started
+    KB_LATENCY_EDGE,          // key press/release detected
+    KB_LATENCY_KEYMAP,        // key translated by the keymap
+    KB_LATENCY_REPORT_BUILD,  // HID report built
+    KB_LATENCY_REPORT_SUBMIT, // HID report handed to USB/BT
+    KB_LATENCY_STAGE_COUNT,
+};
+
+#define KB_LATENCY_MAGIC "YKBL"
+#define KB_LATENCY_VERSION 1
+
+// 'key' of trace points not related to a single key
+#define KB_LATENCY_KEY_NONE 0xff
+
+#define KB_LATENCY_FLAG_PRESS BIT(0)
+
+struct kb_latency_entry {
+    uint32_t cycles;
+    uint8_t stage;
+    uint8_t key;
+    uint8_t flags;
+    uint8_t seq; // kscan poll sequence number the entry belongs to
+} __packed;
+
+#if CONFIG_KB_LATENCY
+
+// Take the sample timestamp, called right before every kscan poll
+void kb_latency_sample();
+
+// Store trace point 'stage' for key 'key'
+void kb_latency_mark(enum kb_latency_stage stage, uint8_t key, uint8_t flags);
+
+// Start watching the dump UART
+int kb_latency_init();
+
+#else
+
+static inline void kb_latency_sample() {
+}
+
+static inline void kb_latency_mark(enum kb_latency_stage stage, uint8_t key,
+                                   uint8_t flags) {
+}
+
+#endif // CONFIG_KB_LATENCY
+
+#endif // LIB_KB_LATENCY_H_
@@ -2,9 +2,13 @@
 #define LIB_KB_SETTINGS_H_
 
 #include <lib/keyboard/kb_mappings.h>
+#include <lib/keyboard/kb_travel.h>
 
+#include <zephyr/sys/util.h>
 #include <zephyr/toolchain.h>
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 enum kb_mode {
@@ -30,12 +34,26 @@ typedef struct {
 
 typedef struct {
 
+    // Profile these settings belong to
+    uint8_t profile;
+
+    // Snapshot generation, see 'kb_settings_generation'
+    uint32_t generation;
+
     kb_settings_main_t main;
 
     kb_settings_key_calib_t keys_calibration[CONFIG_KB_KEY_COUNT];
 
     kb_key_rules_t mappings[CONFIG_KB_KEY_COUNT];
 
+    // Press thresholds precomputed from 'keys_calibration' for the scan loop
+    uint16_t key_thresholds[CONFIG_KB_KEY_COUNT];
+
+#if CONFIG_KB_TRAVEL
+    // Travel lookup precomputed from 'keys_calibration'
+    kb_travel_key_t key_travel[CONFIG_KB_KEY_COUNT];
+#endif // CONFIG_KB_TRAVEL
+
 #if CONFIG_BT_INTER_KB_COMM_MASTER
 
     kb_settings_key_calib_t keys_calibration_slave[CONFIG_KB_KEY_COUNT_SLAVE];
@@ -45,33 +63,95 @@ typedef struct {
 
 } kb_settings_t;
 
-struct kb_settings_image {
-
-    uint16_t version;
-    kb_settings_main_t main;
-    kb_settings_key_calib_t keys_calibration[CONFIG_KB_KEY_COUNT];
-    kb_ruleset_pod_t mappings[CONFIG_KB_KEY_COUNT];
-
-#if CONFIG_BT_INTER_KB_COMM_MASTER
-
-    kb_settings_key_calib_t keys_calibration_slave[CONFIG_KB_KEY_COUNT_SLAVE];
-    kb_ruleset_pod_t mappings_slave[CONFIG_KB_KEY_COUNT_SLAVE];
-
-#endif
-};
-
-// Increment every time kb_settings_image changes
-#define KB_SETTINGS_IMAGE_VERSION 3
+// Independently stored parts of the settings
+#define KB_SETTINGS_PART_MAIN BIT(0)
+#define KB_SETTINGS_PART_CALIB BIT(1)
+#define KB_SETTINGS_PART_KEYMAP BIT(2)
+#define KB_SETTINGS_PART_CALIB_SLAVE BIT(3)
+#define KB_SETTINGS_PART_KEYMAP_SLAVE BIT(4)
+#define KB_SETTINGS_PART_ALL BIT_MASK(5)
 
 int kb_settings_init();
 
-kb_settings_t *kb_settings_get();
-
+// Get published settings snapshot of the active profile.
+//
+// For readers other than the scan loop. The snapshot is not reused until it
+// is released with 'kb_settings_put', even if a newer one is published
+// meanwhile. Never blocks.
+//
+// Snapshots are immutable, use 'kb_settings_edit_begin' to change settings.
+const kb_settings_t *kb_settings_get();
+
+// Release snapshot returned by 'kb_settings_get'
+void kb_settings_put(const kb_settings_t *settings);
+
+// Get published settings snapshot for the next scan.
+//
+// Should be called once at the beginning of every scan by the scan loop.
+// The returned snapshot stays valid until the next call even if a newer one
+// is published meanwhile, so the scan never sees a half-updated
+// configuration. Never blocks.
+const kb_settings_t *kb_settings_acquire();
+
+// Generation of the published snapshot, incremented on every publish
+uint32_t kb_settings_generation();
+
+// Start changing settings of the active profile.
+//
+// Returns a private copy of the published snapshot which can be modified
+// freely, or NULL if no free snapshot is available. Writers are serialized,
+// every successful call should be followed by 'kb_settings_edit_commit' or
+// 'kb_settings_edit_abort' from the same thread.
+kb_settings_t *kb_settings_edit_begin();
+
+// Schedule records holding key 'key_index' of the edited settings to be
+// written to flash on commit.
+//
+// 'parts' is a mask of KB_SETTINGS_PART_CALIB* and/or KB_SETTINGS_PART_KEYMAP*,
+// 'slave' selects the slave half records on split master.
+void kb_settings_edit_mark_key(kb_settings_t *settings, size_t key_index,
+                               bool slave, uint32_t parts);
+
+// Replace rules of key 'key_index' of the edited settings with 'count'
+// 'rules' and schedule the keymap record holding it to be written on commit.
+//
+// 'slave' selects the slave half keymap on split master.
+int kb_settings_edit_set_rules(kb_settings_t *settings, size_t key_index,
+                               bool slave, const kb_map_rule_t *rules,
+                               uint8_t count);
+
+// Publish edited settings as a new snapshot.
+//
+// KB_SETTINGS_PART_* 'parts' are scheduled to be written to flash, the write
+// is deferred and coalesced with other changes, see kb_settings_persist.h
+void kb_settings_edit_commit(kb_settings_t *settings, uint32_t parts);
+
+// Drop edited settings
+void kb_settings_edit_abort(kb_settings_t *settings);
+
+// Threshold for 'calib' moved to the 'minimum' to 'maximum' range, keeping
+// its actuation point: the physical travel with CONFIG_KB_TRAVEL, the
+// relative depth otherwise
+uint16_t kb_settings_calib_rescale_threshold(
+    const kb_settings_key_calib_t *calib, uint16_t minimum, uint16_t maximum);
+
+// Switch to 'profile' (0..CONFIG_KB_SETTINGS_PROFILE_COUNT-1).
+//
+// The next profile is kept preloaded in RAM so switching to it is instant,
+// other profiles are loaded from flash in the background first.
+int kb_settings_profile_select(uint8_t profile);
+
+// Get index of the active profile
+uint8_t kb_settings_profile_get();
+
+// Switch to the next/previous profile
+void kb_settings_profile_next();
+void kb_settings_profile_prev();
+
+// Schedule every part of the active profile to be written to flash.
 void kb_settings_save();
 
-void kb_settings_build_image_from_runtime(struct kb_settings_image *img);
-
-typedef void (*on_settings_update_cb)(kb_settings_t *settings);
+typedef void (*on_settings_update_cb)(const kb_settings_t *settings);
 
 void kb_settings_set_on_update(on_settings_update_cb cb);
 
@@ -0,0 +1,75 @@
+#ifndef LIB_KB_SETTINGS_MIGRATE_H_
+#define LIB_KB_SETTINGS_MIGRATE_H_
+
+#include <zephyr/sys/iterable_sections.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Kind of the stored settings record
+enum kb_settings_rec_kind {
+    KB_SETTINGS_REC_KIND_MAIN = 0,
+    KB_SETTINGS_REC_KIND_CALIB,
+    KB_SETTINGS_REC_KIND_KEYMAP,
+};
+
+// Header in front of every stored settings record.
+//
+// The header describes the payload following it, so an older record can be
+// recognized and upgraded without knowing its layout in advance.
+struct kb_settings_rec_hdr {
+    uint8_t hdr_size; // sizeof(struct kb_settings_rec_hdr)
+    uint8_t kind;     // enum kb_settings_rec_kind
+    uint16_t version; // payload layout version
+    uint16_t size;    // payload size in bytes
+    uint16_t reserved;
+    uint32_t crc; // crc32_ieee of the payload
+};
+
+// Upgrade function for a record payload.
+//
+// Transforms 'payload' of 'size' bytes from version 'from_version' to
+// 'from_version + 1' in place. 'size' is the stored payload size, which may be
+// larger than the current layout. 'buf_size' is the size of the buffer behind
+// 'payload', see CONFIG_KB_SETTINGS_MIGRATION_BUF_SIZE.
+//
+// Returns new payload size or negative value on error.
+typedef int (*kb_settings_migrate_fn)(uint8_t *payload, size_t size,
+                                      size_t buf_size);
+
+struct kb_settings_migration {
+    enum kb_settings_rec_kind kind;
+    uint16_t from_version;
+    kb_settings_migrate_fn migrate;
+};
+
+// Register a migration of 'kind' record payload from version 'from' to
+// 'from + 1'.
+#define KB_SETTINGS_MIGRATION_DEFINE(name, rec_kind, from, fn)                 \
+    static const STRUCT_SECTION_ITERABLE(kb_settings_migration,                \
+                                         __kb_settings_migration_##name) = {   \
+        .kind = rec_kind,                                                      \
+        .from_version = from,                                                  \
+        .migrate = fn,                                                         \
+    }
+
+// Upgrade record payload up to version 'to_version' by chaining registered
+// migrations.
+//
+// On success '*version' and '*size' are updated to the new payload version and
+// size, returns 0. Returns -ENOENT if some step has no registered migration.
+int kb_settings_migrate(enum kb_settings_rec_kind kind, uint16_t *version,
+                        uint16_t to_version, uint8_t *payload, uint16_t *size,
+                        size_t buf_size);
+
+// Account time spent in a migration done outside of 'kb_settings_migrate'
+void kb_settings_migrate_account(uint32_t cycles);
+
+// Time spent in migrations since boot (us)
+uint32_t kb_settings_migrate_time_us();
+
+// Log migration boot time and warn if it exceeded
+// CONFIG_KB_SETTINGS_MIGRATION_BUDGET_MS
+void kb_settings_migrate_report();
+
+#endif // LIB_KB_SETTINGS_MIGRATE_H_
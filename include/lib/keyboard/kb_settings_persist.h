@@ -0,0 +1,52 @@
+#ifndef LIB_KB_SETTINGS_PERSIST_H_
+#define LIB_KB_SETTINGS_PERSIST_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/iterable_sections.h>
+
+#include <stdbool.h>
+
+// Settings section which is written to flash lazily.
+//
+// Sections are marked dirty from any context with
+// 'kb_settings_persist_mark_dirty' and are flushed from the background
+// persistence work queue once no more changes arrived for
+// CONFIG_KB_SETTINGS_PERSIST_DELAY_MS (but no later than
+// CONFIG_KB_SETTINGS_PERSIST_MAX_DELAY_MS after the first change). Changes are
+// lost if power goes away before that.
+struct kb_settings_persist_section {
+    const char *name;
+    // Write section to flash, returns 0 on success
+    int (*store)(void);
+    atomic_t *dirty;
+};
+
+#define KB_SETTINGS_PERSIST_SECTION(sect_name) (&__kb_persist_sect_##sect_name)
+
+#define KB_SETTINGS_PERSIST_SECTION_DEFINE(sect_name, store_fn)                \
+    static atomic_t __kb_persist_dirty_##sect_name = ATOMIC_INIT(0);           \
+    static STRUCT_SECTION_ITERABLE(kb_settings_persist_section,                \
+                                   __kb_persist_sect_##sect_name) = {          \
+        .name = STRINGIFY(sect_name),                                          \
+        .store = store_fn,                                                     \
+        .dirty = &__kb_persist_dirty_##sect_name,                              \
+    }
+
+// Start the persistence work queue. Safe to call more than once.
+int kb_settings_persist_init();
+
+// Mark section as changed and (re)arm the delayed flush
+void kb_settings_persist_mark_dirty(
+    const struct kb_settings_persist_section *section);
+
+// Run 'work' on the persistence work queue after 'delay'.
+//
+// Used for other flash bound jobs so they are serialized with the writes.
+void kb_settings_persist_submit(struct k_work_delayable *work,
+                                k_timeout_t delay);
+
+// Returns true if any section is waiting to be written
+bool kb_settings_persist_pending();
+
+#endif // LIB_KB_SETTINGS_PERSIST_H_
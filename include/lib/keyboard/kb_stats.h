@@ -0,0 +1,75 @@
+#ifndef LIB_KB_STATS_H_
+#define LIB_KB_STATS_H_
+
+#include <zephyr/kernel.h>
+
+#include <stdint.h>
+
+// Scan loop statistics.
+//
+// The scan loop records the interval between consecutive kscan polls and
+// the duration of every scan (poll until the HID report is handed over)
+// into histograms. Together with thread CPU load they are available through
+// the 'kb_stats' shell command and the vendor HID stats feature report.
+//
+// Stats feature report payload (little endian):
+//   u8 version, u8 reserved,
+//   u16 CPU load, u16 kb_thread load, u16 kb_bl_thread load (permille),
+//   interval summary, duration summary (u32 count, min, avg, max, p99 us)
+
+#define KB_STATS_REPORT_VERSION 1
+
+enum kb_stats_hist_id {
+    KB_STATS_INTERVAL = 0, // start of one poll to start of the next one
+    KB_STATS_DURATION,     // start of a poll to the end of its processing
+    KB_STATS_HIST_COUNT,
+};
+
+struct kb_stats_summary {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t avg_us;
+    uint32_t max_us;
+    uint32_t p99_us; // upper bound of the p99 histogram bucket
+};
+
+#if CONFIG_KB_STATS
+
+// Called by the scan loop right before every kscan poll
+void kb_stats_scan_begin();
+
+// Called by the scan loop once the poll results are processed
+void kb_stats_scan_end();
+
+int kb_stats_init();
+
+// Clear scan interval and duration histograms
+void kb_stats_reset();
+
+void kb_stats_summary_get(enum kb_stats_hist_id id,
+                          struct kb_stats_summary *summary);
+
+// Copy histogram 'id' into 'buckets', the last bucket collects everything
+// above the histogram range
+//
+// Returns bucket width in us
+uint32_t kb_stats_hist_get(enum kb_stats_hist_id id,
+                           uint32_t buckets[CONFIG_KB_STATS_HIST_BUCKETS]);
+
+// CPU load of 'thread' since boot in permille
+uint16_t kb_stats_thread_load(k_tid_t thread);
+
+// Non-idle CPU load since boot in permille
+uint16_t kb_stats_cpu_load();
+
+#else
+
+static inline void kb_stats_scan_begin() {
+}
+
+static inline void kb_stats_scan_end() {
+}
+
+#endif // CONFIG_KB_STATS
+
+#endif // LIB_KB_STATS_H_
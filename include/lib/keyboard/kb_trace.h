@@ -0,0 +1,106 @@
+#ifndef LIB_KB_TRACE_H_
+#define LIB_KB_TRACE_H_
+
+#include <zephyr/device.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Raw key value trace format.
+//
+// Header:
+//   "YKBT" magic, u8 version, u8 reserved, u16 key count (LE)
+//
+// Frames, one per kscan poll:
+//   time since the previous frame in us (unsigned LEB128),
+//   bitmask of keys whose value changed (key count / 8 bytes, rounded up),
+//   u16 value (LE) for every key set in the bitmask, in key order
+//
+// The first frame after the header (or after dropped frames) has every
+// bit of the bitmask set.
+
+#define KB_TRACE_MAGIC "YKBT"
+#define KB_TRACE_VERSION 1
+
+#define KB_TRACE_MAX_KEYS 256
+
+#define KB_TRACE_HEADER_SIZE 8
+
+#define KB_TRACE_MASK_SIZE(key_count) (((key_count) + 7) / 8)
+
+// Maximum encoded frame size
+#define KB_TRACE_FRAME_MAX_SIZE(key_count)                                     \
+    (5 + KB_TRACE_MASK_SIZE(key_count) + 2 * (key_count))
+
+struct kb_trace_encoder {
+    uint16_t key_count;
+    bool keyframe;
+    uint16_t prev[KB_TRACE_MAX_KEYS];
+};
+
+struct kb_trace_decoder {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+    uint16_t key_count;
+    uint32_t time_us;
+    uint16_t values[KB_TRACE_MAX_KEYS];
+};
+
+// Write trace header for 'key_count' keys into 'buf' and reset 'enc'
+//
+// Returns the amount of bytes written or negative error code
+int kb_trace_encoder_init(struct kb_trace_encoder *enc, uint16_t key_count,
+                          uint8_t *buf, size_t len);
+
+// Encode frame with 'values' sampled 'dt_us' after the previous one
+//
+// Returns the amount of bytes written or negative error code.
+// Nothing is written and the next frame becomes a keyframe if 'buf'
+// is too small.
+int kb_trace_encode(struct kb_trace_encoder *enc, uint32_t dt_us,
+                    const uint16_t *values, uint8_t *buf, size_t len);
+
+// Make the next encoded frame a keyframe, e.g. after dropping frames
+static inline void kb_trace_encoder_resync(struct kb_trace_encoder *enc) {
+    enc->keyframe = true;
+}
+
+// Parse trace header of 'data'
+//
+// Returns 0 on success or negative error code
+int kb_trace_decoder_init(struct kb_trace_decoder *dec, const uint8_t *data,
+                          size_t len);
+
+// Decode the next frame, 'dec->values' and 'dec->time_us' (time since
+// recording started) are updated
+//
+// Returns 1 if a frame was decoded, 0 at the end of the trace or
+// negative error code on malformed data
+int kb_trace_decode(struct kb_trace_decoder *dec);
+
+#if CONFIG_KB_TRACE_RECORD
+
+// Set up trace streaming to the 'ykb,trace' chosen UART
+//
+// Recording starts once the host opens the port (DTR is set), or right
+// away if the UART has no DTR line.
+int kb_trace_record_init();
+
+// Record a frame of raw key values, called on every kscan poll
+void kb_trace_record(const uint16_t *values);
+
+#endif // CONFIG_KB_TRACE_RECORD
+
+#if CONFIG_KB_TRACE_REPLAY
+
+// Start replaying the built-in trace through the emulated 'kscan'
+int kb_trace_replay_start(const struct device *kscan);
+
+// Report HID report produced during replay
+void kb_trace_replay_on_report(const uint8_t *report, uint8_t report_size);
+
+#endif // CONFIG_KB_TRACE_REPLAY
+
+#endif // LIB_KB_TRACE_H_
@@ -0,0 +1,75 @@
+#ifndef LIB_KB_TRAVEL_H_
+#define LIB_KB_TRAVEL_H_
+
+#include <zephyr/sys/util.h>
+
+#include <stdint.h>
+
+// Key travel in physical units (0.01 mm).
+//
+// Hall sensor output is far from linear in key travel. The response of the
+// selected switch profile (CONFIG_KB_TRAVEL_PROFILE_*) is stored as a LUT
+// of travels at KB_TRAVEL_LUT_SIZE + 1 evenly spaced sensor outputs
+// between released and bottomed out (see scripts/kb_travel_lut.py). Every
+// key maps its calibrated range onto the LUT with a precomputed scale, so a
+// raw sample converts with one multiply, one table lookup and a linear
+// interpolation.
+
+#define KB_TRAVEL_LUT_BITS 8
+#define KB_TRAVEL_LUT_SIZE BIT(KB_TRAVEL_LUT_BITS)
+
+// Per key LUT mapping, see 'kb_travel_key_init'
+typedef struct {
+    uint16_t minimum;
+    uint16_t maximum;
+    uint32_t scale; // LUT segments per raw count, Q16
+} kb_travel_key_t;
+
+#if CONFIG_KB_TRAVEL
+
+// Travel of a bottomed out key
+#define KB_TRAVEL_MAX CONFIG_KB_TRAVEL_TOTAL
+
+// Travel of the default key press thresholds
+#if CONFIG_KB_TRAVEL_DEFAULT_ACTUATION
+#define KB_TRAVEL_DEFAULT_ACTUATION CONFIG_KB_TRAVEL_DEFAULT_ACTUATION
+#else
+#define KB_TRAVEL_DEFAULT_ACTUATION                                            \
+    (CONFIG_KB_SETTINGS_DEFAULT_THRESHOLD * KB_TRAVEL_MAX / 100)
+#endif // CONFIG_KB_TRAVEL_DEFAULT_ACTUATION
+
+extern const uint16_t kb_travel_lut[KB_TRAVEL_LUT_SIZE + 1];
+
+// Set up 'key' mapping of the 'minimum' (released) to 'maximum' (bottomed
+// out) raw range
+void kb_travel_key_init(kb_travel_key_t *key, uint16_t minimum,
+                        uint16_t maximum);
+
+// Travel (0 - KB_TRAVEL_MAX) of raw 'value'
+static inline uint16_t kb_travel_from_value(const kb_travel_key_t *key,
+                                            uint16_t value) {
+    if (value <= key->minimum) {
+        return 0;
+    }
+    if (value >= key->maximum) {
+        return KB_TRAVEL_MAX;
+    }
+
+    // LUT position with 8 fractional bits
+    uint32_t pos = ((uint32_t)(value - key->minimum) * key->scale) >> 8;
+    uint32_t i = MIN(pos >> 8, KB_TRAVEL_LUT_SIZE - 1);
+    uint32_t frac = pos - (i << 8);
+    uint32_t lo = kb_travel_lut[i];
+    uint32_t hi = kb_travel_lut[i + 1];
+
+    return (uint16_t)(lo + (((hi - lo) * frac) >> 8));
+}
+
+// Raw value at 'travel' within the 'minimum' to 'maximum' raw range, the
+// inverse of 'kb_travel_from_value'. Not meant for the scan loop.
+uint16_t kb_travel_to_value(uint16_t minimum, uint16_t maximum,
+                            uint16_t travel);
+
+#endif // CONFIG_KB_TRAVEL
+
+#endif // LIB_KB_TRAVEL_H_
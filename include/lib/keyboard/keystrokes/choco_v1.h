@@ -43,4 +43,21 @@ KB_FN_KEYSTROKE_DEFINE_LIB_KB_BL(bl_sb_max_right,
                                  kb_backlight_set_brightness_max, KEY_P);
 KB_FN_KEYSTROKE_DEFINE_LIB_KB_BL(bl_toggle_right, kb_backlight_toggle, KEY_L);
 
+// Settings profiles
+//
+KB_FN_KEYSTROKE_DEFINE_LIB_KB_SETTINGS(prof_n_left, kb_settings_profile_next,
+                                       KEY_C);
+KB_FN_KEYSTROKE_DEFINE_LIB_KB_SETTINGS(prof_p_left, kb_settings_profile_prev,
+                                       KEY_X);
+KB_FN_KEYSTROKE_DEFINE_LIB_KB_SETTINGS(prof_n_right, kb_settings_profile_next,
+                                       34); // ,
+KB_FN_KEYSTROKE_DEFINE_LIB_KB_SETTINGS(prof_p_right, kb_settings_profile_prev,
+                                       33); // K
+
+// Calibration mode, press again to finish early
+//
+KB_FN_KEYSTROKE_DEFINE_LIB_KB_CALIB(calib_left, kb_calibration_toggle, KEY_G);
+KB_FN_KEYSTROKE_DEFINE_LIB_KB_CALIB(calib_right, kb_calibration_toggle,
+                                    37); // .
+
 #endif // CHOCO_V1_KEYSTROKES_H
@@ -48,4 +48,21 @@ KB_FN_KEYSTROKE_DEFINE_LIB_KB_BL(bl_br_max_right,
 KB_FN_KEYSTROKE_DEFINE_LIB_KB_BL(bl_toggle_right, kb_backlight_toggle,
                                  KEY_SLASH_QUESTIONMARK);
 
+// Settings profiles
+//
+KB_FN_KEYSTROKE_DEFINE_LIB_KB_SETTINGS(prof_n_left, kb_settings_profile_next,
+                                       KEY_C);
+KB_FN_KEYSTROKE_DEFINE_LIB_KB_SETTINGS(prof_p_left, kb_settings_profile_prev,
+                                       KEY_X);
+KB_FN_KEYSTROKE_DEFINE_LIB_KB_SETTINGS(prof_n_right, kb_settings_profile_next,
+                                       KEY_COMMA_LESSTHAN);
+KB_FN_KEYSTROKE_DEFINE_LIB_KB_SETTINGS(prof_p_right, kb_settings_profile_prev,
+                                       KEY_K);
+
+// Calibration mode, press again to finish early
+//
+KB_FN_KEYSTROKE_DEFINE_LIB_KB_CALIB(calib_left, kb_calibration_toggle, KEY_G);
+KB_FN_KEYSTROKE_DEFINE_LIB_KB_CALIB(calib_right, kb_calibration_toggle,
+                                    KEY_DOT_GREATERTHAN);
+
 #endif // DACTYL_V1_KEYSTROKES_H
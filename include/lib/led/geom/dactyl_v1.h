@@ -20,6 +20,9 @@ LEDS_POSITIONS_DEFINE_RIGHT(POS(-9.5, -3.5), POS(-9.5, -1.7), POS(-9.5, 0.2),
                             POS(-1.9, 0), POS(0, 0), POS(0, -1.9),
                             POS(0, -3.8));
 
+// Right half is the left one mirrored, thumb keys one key apart
+LEDS_SPLIT_PLACEMENT_DEFINE(27.5, 0, 1, -1);
+
 KEY_IDX_TO_LED_IDX_MAP_DEFINE_BOTH(2, 1, 0, 6, 7, 8, 9, 3, 4, 5, 12, 11, 10, 13,
                                    14, 15, 18, 17, 16, 19, 20, 21);
 
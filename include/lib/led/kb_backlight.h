@@ -4,6 +4,7 @@
 #include <lib/keyboard/kb_key.h>
 
 #include <zephyr/drivers/led_strip.h>
+#include <zephyr/kernel.h>
 
 enum kb_backlight_type {
     KB_BACKLIGHT_NONE = -1,
@@ -17,6 +18,8 @@ void kb_backlight_prev_mode();
 
 void kb_backlight_set_brightness(uint8_t brightness);
 
+void kb_backlight_set_speed(float speed);
+
 static inline void kb_backlight_set_brightness_min() {
     kb_backlight_set_brightness(1);
 }
@@ -38,7 +41,36 @@ void kb_backlight_turn_on();
 void kb_backlight_turn_off();
 
 void kb_backlight_on_event(kb_key_t *key);
-void kb_backlight_handle();
+
+// Request the on/off state, mode, brightness and speed, e.g. received from
+// the master half. Applied by the backlight thread, only fields differing
+// from the current state are changed. Safe to call from any thread.
+void kb_backlight_request_state(bool on, size_t mode_idx, uint8_t brightness,
+                                float speed);
+
+// Backlight animation clock (ms).
+//
+// Modes should derive their animation phase from it rather than count
+// frames, on split keyboards it is kept aligned between the halves.
+uint32_t kb_backlight_clock_ms();
+
+// Align the animation clock with 'clock_ms' received from the master half
+void kb_backlight_clock_sync(uint32_t clock_ms);
+
+typedef void (*kb_backlight_on_update_cb)();
+
+// Set callback invoked when mode, brightness, speed or on/off state changes
+void kb_backlight_set_on_update(kb_backlight_on_update_cb cb);
+
+// Render and send the next frame if it is due.
+//
+// Returns time until the next frame is due, K_FOREVER if the backlight is
+// off or the current mode is not animating.
+k_timeout_t kb_backlight_handle();
+
+// Sleep for 'timeout' or until something changes the backlight
+// (key event, mode or brightness change, etc.)
+void kb_backlight_wait(k_timeout_t timeout);
 
 static inline enum kb_backlight_type kb_backlight_get_type() {
 #if CONFIG_KB_BACKLIGHT_DEVICE_LED
@@ -18,6 +18,7 @@ typedef struct {
 #define KB_BL_SETTINGS_IMAGE_VERSION 1
 
 void kb_backlight_settings_init(void);
+// Schedule backlight state to be written to flash (deferred, coalesced)
 void kb_bl_settings_save(void);
 
 void kb_backlight_settings_build_image_from_runtime(backlight_state_img *img);
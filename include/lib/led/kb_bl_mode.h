@@ -15,7 +15,12 @@
 struct kb_bl_mode {
     void (*init)(size_t len);
     void (*deinit)();
-    void (*apply)(uint32_t dt_ms, float speed, struct led_rgb *frame);
+    // Render next frame into 'frame'.
+    //
+    // Returns true if the mode is animating, i.e. the next frame may differ
+    // even without new key events. Otherwise the backlight sleeps until the
+    // next event.
+    bool (*apply)(uint32_t dt_ms, float speed, struct led_rgb *frame);
     void (*on_event)(kb_key_t *key);
     const char *name;
 };
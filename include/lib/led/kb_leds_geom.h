@@ -3,6 +3,8 @@
 
 #include <lib/keyboard/kb_mappings.h>
 
+#include <zephyr/toolchain.h>
+
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -34,35 +36,117 @@ static inline int32_t kb_leds_geom_sqdist_fp(kb_fp16 ax, kb_fp16 ay, kb_fp16 bx,
     return dx * dx + dy * dy;
 }
 
+// Neighbor of an LED, see 'kb_leds_geom_neighbors'
+struct kb_leds_neighbor {
+    int32_t d2;   // squared distance (Q16.16)
+    kb_fp16 dist; // distance (Q8.8)
+    uint8_t led;  // neighbor LED index
+    uint8_t ring; // dist / CONFIG_KB_LEDS_GEOM_RING_WIDTH
+};
+
+// Precompute neighbor tables from the board LEDs geometry
+int kb_leds_geom_init();
+
+// Get neighbors of 'led' within CONFIG_KB_LEDS_GEOM_RADIUS, 'led' itself
+// included, sorted by distance (so by ring as well).
+//
+// Lists are capped at CONFIG_KB_LEDS_GEOM_MAX_NEIGHBORS nearest LEDs.
+// Stores neighbor count into '*count', returns NULL if 'led' is out of range.
+const struct kb_leds_neighbor *kb_leds_geom_neighbors(uint8_t led,
+                                                      size_t *count);
+
 #define LEDS_POSITIONS_LEFT left_positions
 #define LEDS_POSITIONS_RIGHT right_positions
 #define KEY_IDX_TO_LED_IDX_MAP_LEFT key_idx_to_led_idx_map_left
 #define KEY_IDX_TO_LED_IDX_MAP_RIGHT key_idx_to_led_idx_map_right
 
-#if CONFIG_YKB_RIGHT
-#define LEDS_POSITIONS_DEFINE_LEFT(...)
+// Placement of the right half in the left half coordinates, see
+// 'LEDS_SPLIT_PLACEMENT_DEFINE'
+struct kb_leds_split_placement {
+    struct kb_leds_position origin;
+    int8_t scale_x; // 1 or -1
+    int8_t scale_y; // 1 or -1
+};
+
+// Position of the right half LED 'pos' in the left half coordinates
+static inline struct kb_leds_position
+kb_leds_geom_right_to_left(const struct kb_leds_split_placement *placement,
+                           struct kb_leds_position pos) {
+    return (struct kb_leds_position){
+        .x = placement->origin.x + placement->scale_x * pos.x,
+        .y = placement->origin.y + placement->scale_y * pos.y,
+    };
+}
+
+// Position of the left half LED 'pos' in the right half coordinates
+static inline struct kb_leds_position
+kb_leds_geom_left_to_right(const struct kb_leds_split_placement *placement,
+                           struct kb_leds_position pos) {
+    return (struct kb_leds_position){
+        .x = placement->scale_x * (pos.x - placement->origin.x),
+        .y = placement->scale_y * (pos.y - placement->origin.y),
+    };
+}
+
+#if CONFIG_YKB_SPLIT
+
+// Tables of both halves are defined, the other half ones place its key
+// events in our coordinates
+
+#define LEDS_POSITIONS_DEFINE_LEFT(...)                                        \
+    static struct kb_leds_position __maybe_unused                              \
+        LEDS_POSITIONS_LEFT[CONFIG_KB_KEY_COUNT_LEFT * 2] = {__VA_ARGS__}
 #define LEDS_POSITIONS_DEFINE_RIGHT(...)                                       \
-    static struct kb_leds_position                                             \
-        LEDS_POSITIONS_RIGHT[CONFIG_KB_KEY_COUNT * 2] = {__VA_ARGS__}
-#define KEY_IDX_TO_LED_IDX_MAP_DEFINE_LEFT(...)
+    static struct kb_leds_position __maybe_unused                              \
+        LEDS_POSITIONS_RIGHT[CONFIG_KB_KEY_COUNT_RIGHT * 2] = {__VA_ARGS__}
+#define KEY_IDX_TO_LED_IDX_MAP_DEFINE_LEFT(...)                                \
+    static uint8_t __maybe_unused                                              \
+        KEY_IDX_TO_LED_IDX_MAP_LEFT[CONFIG_KB_KEY_COUNT_LEFT] = {__VA_ARGS__}
 #define KEY_IDX_TO_LED_IDX_MAP_DEFINE_RIGHT(...)                               \
-    static uint8_t KEY_IDX_TO_LED_IDX_MAP_RIGHT[CONFIG_KB_KEY_COUNT] = {       \
-        __VA_ARGS__}
+    static uint8_t __maybe_unused                                              \
+        KEY_IDX_TO_LED_IDX_MAP_RIGHT[CONFIG_KB_KEY_COUNT_RIGHT] = {            \
+            __VA_ARGS__}
+
+// Place the right half LEDs at ('origin_x' + 'sx' * x, 'origin_y' + 'sy' * y)
+// of the left half coordinates, with halves next to each other.
+// CONFIG_KB_LEDS_GEOM_SPLIT_GAP is added along x.
+#define LEDS_SPLIT_PLACEMENT_DEFINE(origin_x, origin_y, sx, sy)                \
+    static const struct kb_leds_split_placement __maybe_unused                 \
+        leds_split_placement = {                                               \
+            .origin = {.x = Q((origin_x) + CONFIG_KB_LEDS_GEOM_SPLIT_GAP),     \
+                       .y = Q(origin_y)},                                      \
+            .scale_x = (sx),                                                   \
+            .scale_y = (sy),                                                   \
+    }
+
+#else
+
+#define LEDS_POSITIONS_DEFINE_LEFT(...)
+#define LEDS_POSITIONS_DEFINE_RIGHT(...)
+#define KEY_IDX_TO_LED_IDX_MAP_DEFINE_LEFT(...)
+#define KEY_IDX_TO_LED_IDX_MAP_DEFINE_RIGHT(...)
+#define LEDS_SPLIT_PLACEMENT_DEFINE(origin_x, origin_y, sx, sy)
+
+#endif // CONFIG_YKB_SPLIT
+
+#if CONFIG_YKB_RIGHT
 #define LEDS_POSITIONS LEDS_POSITIONS_RIGHT
 #define KEY_IDX_TO_LED_IDX_MAP KEY_IDX_TO_LED_IDX_MAP_RIGHT
+#define LEDS_POSITIONS_REMOTE LEDS_POSITIONS_LEFT
+#define KEY_IDX_TO_LED_IDX_MAP_REMOTE KEY_IDX_TO_LED_IDX_MAP_LEFT
+// Other half LED position in our coordinates
+#define LEDS_POSITION_FROM_REMOTE(pos)                                         \
+    kb_leds_geom_left_to_right(&leds_split_placement, pos)
 #endif // CONFIG_YKB_RIGHT
 
 #if CONFIG_YKB_LEFT
-#define LEDS_POSITIONS_DEFINE_LEFT(...)                                        \
-    static struct kb_leds_position                                             \
-        LEDS_POSITIONS_LEFT[CONFIG_KB_KEY_COUNT * 2] = {__VA_ARGS__}
-#define LEDS_POSITIONS_DEFINE_RIGHT(...)
-#define KEY_IDX_TO_LED_IDX_MAP_DEFINE_LEFT(...)                                \
-    static uint8_t KEY_IDX_TO_LED_IDX_MAP_LEFT[CONFIG_KB_KEY_COUNT] = {        \
-        __VA_ARGS__}
-#define KEY_IDX_TO_LED_IDX_MAP_DEFINE_RIGHT(...)
 #define LEDS_POSITIONS LEDS_POSITIONS_LEFT
 #define KEY_IDX_TO_LED_IDX_MAP KEY_IDX_TO_LED_IDX_MAP_LEFT
+#define LEDS_POSITIONS_REMOTE LEDS_POSITIONS_RIGHT
+#define KEY_IDX_TO_LED_IDX_MAP_REMOTE KEY_IDX_TO_LED_IDX_MAP_RIGHT
+// Other half LED position in our coordinates
+#define LEDS_POSITION_FROM_REMOTE(pos)                                         \
+    kb_leds_geom_right_to_left(&leds_split_placement, pos)
 #endif // CONFIG_YKB_LEFT
 
 #define LEDS_POSITIONS_DEFINE_BOTH(...)                                        \
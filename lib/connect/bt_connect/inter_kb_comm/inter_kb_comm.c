@@ -1,8 +1,20 @@
 #include "inter_kb_comm.h"
 
+#include <lib/keyboard/kb_calibration.h>
+#include <lib/keyboard/kb_key.h>
+#include <lib/keyboard/kb_settings.h>
+#include <lib/led/kb_backlight.h>
+
 #include <zephyr/bluetooth/uuid.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/printk.h>
 
 #include <stdint.h>
+#include <string.h>
+
+LOG_MODULE_DECLARE(bt_connect, CONFIG_BT_CONNECT_LOG_LEVEL);
 
 const uint8_t ykb_svc_uuid_le[16] = {0x23, 0xd1, 0xbc, 0xea, 0x5f, 0x78,
                                      0x23, 0x15, 0xde, 0xef, 0x12, 0x12,
@@ -15,3 +27,217 @@ struct bt_uuid_128 YKB_SPLIT_SVC_UUID =
 struct bt_uuid_128 YKB_KEYS_CHRC_UUID =
     BT_UUID_INIT_128(0x23, 0xd1, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15, 0xde, 0xef,
                      0x12, 0x12, 0xab, 0xcd, 0x00, 0x02);
+
+struct bt_uuid_128 YKB_CTRL_CHRC_UUID =
+    BT_UUID_INIT_128(0x23, 0xd1, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15, 0xde, 0xef,
+                     0x12, 0x12, 0xab, 0xcd, 0x00, 0x03);
+
+#if CONFIG_BT_INTER_KB_COMM_PROBE
+
+void inter_kb_comm_probe(const char *event, const void *data, size_t len) {
+    const uint8_t *bytes = data;
+    char hex[2 * CONFIG_INTER_KB_COMM_PROTO_MAX_LEN + 1] = "";
+
+    len = MIN(len, CONFIG_INTER_KB_COMM_PROTO_MAX_LEN);
+    for (size_t i = 0; i < len; ++i) {
+        snprintk(&hex[2 * i], 3, "%02x", bytes[i]);
+    }
+
+    // Single printk, so lines of both threads do not interleave
+    printk("ikb %s %u %s\n", event,
+           (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks()), hex);
+}
+
+#endif // CONFIG_BT_INTER_KB_COMM_PROBE
+
+#if CONFIG_KB_BACKLIGHT
+
+static void inter_kb_comm_handle_bl_state(
+    const struct inter_kb_proto_bl_state *state) {
+    // Modes are (de)initialized by the backlight thread, not from RX
+    kb_backlight_request_state(state->on, state->mode_idx, state->brightness,
+                               (float)state->mode_speed / 100);
+}
+
+bool inter_kb_comm_handle_bl(const struct inter_kb_proto *packet, int len) {
+    switch (packet->data_type) {
+    case INTER_KB_PROTO_DATA_TYPE_BL_STATE: {
+        struct inter_kb_proto_bl_state state;
+        if (len != sizeof(state)) {
+            break;
+        }
+        memcpy(&state, packet->data, sizeof(state));
+        inter_kb_comm_handle_bl_state(&state);
+        return true;
+    }
+    case INTER_KB_PROTO_DATA_TYPE_BL_SYNC: {
+        struct inter_kb_proto_bl_sync sync;
+        if (len != sizeof(sync)) {
+            break;
+        }
+        memcpy(&sync, packet->data, sizeof(sync));
+        kb_backlight_clock_sync(sync.clock_ms);
+        return true;
+    }
+    case INTER_KB_PROTO_DATA_TYPE_BL_EVENT: {
+        struct inter_kb_proto_bl_event event;
+        if (len != sizeof(event)) {
+            break;
+        }
+        memcpy(&event, packet->data, sizeof(event));
+        kb_key_t key = {
+            .index = event.index,
+            .value = event.value,
+            .pressed = event.pressed,
+            .remote = true,
+        };
+        kb_backlight_on_event(&key);
+        return true;
+    }
+    default:
+        return false;
+    }
+
+    LOG_ERR("Bad IKBP backlight packet (type %d, len %d)", packet->data_type,
+            len);
+    return true;
+}
+
+#else
+
+bool inter_kb_comm_handle_bl(const struct inter_kb_proto *packet, int len) {
+    switch (packet->data_type) {
+    case INTER_KB_PROTO_DATA_TYPE_BL_STATE:
+    case INTER_KB_PROTO_DATA_TYPE_BL_SYNC:
+    case INTER_KB_PROTO_DATA_TYPE_BL_EVENT:
+        // No backlight on this half
+        return true;
+    default:
+        return false;
+    }
+}
+
+#endif // CONFIG_KB_BACKLIGHT
+
+#if CONFIG_BT_INTER_KB_COMM_SLAVE
+
+// Main settings received from the master, applied from the system work queue
+// as editing settings may wait for a flash write
+static struct inter_kb_proto_kb_settings received_kb_settings;
+static struct k_spinlock received_kb_settings_lock;
+
+static void inter_kb_comm_kb_settings_work_handler(struct k_work *work) {
+    k_spinlock_key_t key = k_spin_lock(&received_kb_settings_lock);
+    struct inter_kb_proto_kb_settings data = received_kb_settings;
+    k_spin_unlock(&received_kb_settings_lock, key);
+
+    const kb_settings_t *settings = kb_settings_get();
+    bool same = settings->main.mode == data.mode &&
+                settings->main.key_polling_rate == data.key_polling_rate;
+    kb_settings_put(settings);
+    if (same) {
+        return;
+    }
+
+    kb_settings_t *edit = kb_settings_edit_begin();
+    if (!edit) {
+        LOG_WRN("Unable to apply master keyboard settings");
+        return;
+    }
+    edit->main.mode = data.mode;
+    edit->main.key_polling_rate = data.key_polling_rate;
+    kb_settings_edit_commit(edit, KB_SETTINGS_PART_MAIN);
+
+    LOG_INF("Keyboard settings of the master applied (mode %u, polling "
+            "rate %u)",
+            data.mode, data.key_polling_rate);
+}
+
+static K_WORK_DEFINE(kb_settings_work, inter_kb_comm_kb_settings_work_handler);
+
+#endif // CONFIG_BT_INTER_KB_COMM_SLAVE
+
+bool inter_kb_comm_handle_settings(const struct inter_kb_proto *packet,
+                                   int len) {
+    if (packet->data_type != INTER_KB_PROTO_DATA_TYPE_KB_SETTINGS) {
+        return false;
+    }
+
+    struct inter_kb_proto_kb_settings data;
+    if (len != sizeof(data)) {
+        LOG_ERR("Bad IKBP keyboard settings packet (len %d)", len);
+        return true;
+    }
+    memcpy(&data, packet->data, sizeof(data));
+
+#if CONFIG_BT_INTER_KB_COMM_SLAVE
+    if (data.mode > KB_MODE_RACE || data.key_polling_rate == 0) {
+        LOG_WRN("Bad keyboard settings from the master (mode %u, polling "
+                "rate %u)",
+                data.mode, data.key_polling_rate);
+        return true;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&received_kb_settings_lock);
+    received_kb_settings = data;
+    k_spin_unlock(&received_kb_settings_lock, key);
+
+    k_work_submit(&kb_settings_work);
+#else
+    LOG_WRN("Unexpected IKBP keyboard settings packet");
+#endif // CONFIG_BT_INTER_KB_COMM_SLAVE
+
+    return true;
+}
+
+bool inter_kb_comm_handle_calib(const struct inter_kb_proto *packet, int len) {
+    if (packet->data_type != INTER_KB_PROTO_DATA_TYPE_CALIB) {
+        return false;
+    }
+
+    struct inter_kb_proto_calib calib;
+    if (len != sizeof(calib)) {
+        LOG_ERR("Bad IKBP calibration packet (len %d)", len);
+        return true;
+    }
+    memcpy(&calib, packet->data, sizeof(calib));
+
+#if CONFIG_KB_CALIBRATION
+    switch (calib.op) {
+#if CONFIG_BT_INTER_KB_COMM_SLAVE
+    case INTER_KB_PROTO_CALIB_START:
+        kb_calibration_start();
+        return true;
+    case INTER_KB_PROTO_CALIB_FINISH:
+        kb_calibration_finish();
+        return true;
+    case INTER_KB_PROTO_CALIB_ABORT:
+        kb_calibration_abort();
+        return true;
+#endif // CONFIG_BT_INTER_KB_COMM_SLAVE
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+    case INTER_KB_PROTO_CALIB_KEY: {
+        kb_settings_key_calib_t key = {
+            .minimum = calib.minimum,
+            .maximum = calib.maximum,
+            .threshold = calib.threshold,
+        };
+        kb_calibration_on_slave_key(calib.index, &key);
+        return true;
+    }
+    case INTER_KB_PROTO_CALIB_DONE:
+        kb_calibration_on_slave_done(calib.index);
+        return true;
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+    default:
+        break;
+    }
+
+    LOG_WRN("Unexpected IKBP calibration op %d", calib.op);
+#else
+    // No calibration mode on this half
+    ARG_UNUSED(calib);
+#endif // CONFIG_KB_CALIBRATION
+
+    return true;
+}
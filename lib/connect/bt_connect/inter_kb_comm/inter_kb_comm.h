@@ -1,11 +1,50 @@
 #ifndef BT_CONNECT_INTER_KB_COMM_H_
 #define BT_CONNECT_INTER_KB_COMM_H_
 
+#include "inter_kb_proto.h"
+
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 extern const uint8_t ykb_svc_uuid_le[16];
 
 extern struct bt_uuid_128 YKB_SPLIT_SVC_UUID;
 extern struct bt_uuid_128 YKB_KEYS_CHRC_UUID;
+// Written by the master to send data to the slave
+extern struct bt_uuid_128 YKB_CTRL_CHRC_UUID;
+
+// Handle backlight related 'packet' with 'len' bytes of data coming from
+// the other half
+//
+// Returns false if 'packet' is not backlight related
+bool inter_kb_comm_handle_bl(const struct inter_kb_proto *packet, int len);
+
+// Handle main keyboard settings 'packet' with 'len' bytes of data coming from
+// the master half
+//
+// Returns false if 'packet' is not a keyboard settings one
+bool inter_kb_comm_handle_settings(const struct inter_kb_proto *packet,
+                                   int len);
+
+// Handle calibration mode related 'packet' with 'len' bytes of data coming
+// from the other half
+//
+// Returns false if 'packet' is not calibration related
+bool inter_kb_comm_handle_calib(const struct inter_kb_proto *packet, int len);
+
+#if CONFIG_BT_INTER_KB_COMM_PROBE
+
+// Print split link probe line "ikb <event> <uptime us> [<data as hex>]",
+// parsed by tests/bsim/split_link
+void inter_kb_comm_probe(const char *event, const void *data, size_t len);
+
+#else
+
+static inline void inter_kb_comm_probe(const char *event, const void *data,
+                                       size_t len) {
+}
+
+#endif // CONFIG_BT_INTER_KB_COMM_PROBE
 
 #endif // BT_CONNECT_INTER_KB_COMM_H_
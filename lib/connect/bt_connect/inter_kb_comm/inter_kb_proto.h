@@ -14,12 +14,61 @@
 #define INTER_KB_PROTO_DATA_TYPE_KEYS 1
 #define INTER_KB_PROTO_DATA_TYPE_KB_SETTINGS 2
 #define INTER_KB_PROTO_DATA_TYPE_BL_STATE 3
+#define INTER_KB_PROTO_DATA_TYPE_BL_SYNC 4
+#define INTER_KB_PROTO_DATA_TYPE_BL_EVENT 5
+#define INTER_KB_PROTO_DATA_TYPE_CALIB 6
 // TODO more
 
 #define IS_INTER_KB_PROTO_DATA_TYPE(X)                                         \
     (X == INTER_KB_PROTO_DATA_TYPE_KEYS ||                                     \
      X == INTER_KB_PROTO_DATA_TYPE_KB_SETTINGS ||                              \
-     X == INTER_KB_PROTO_DATA_TYPE_BL_STATE)
+     X == INTER_KB_PROTO_DATA_TYPE_BL_STATE ||                                 \
+     X == INTER_KB_PROTO_DATA_TYPE_BL_SYNC ||                                  \
+     X == INTER_KB_PROTO_DATA_TYPE_BL_EVENT ||                                 \
+     X == INTER_KB_PROTO_DATA_TYPE_CALIB)
+
+// INTER_KB_PROTO_DATA_TYPE_KB_SETTINGS data (master -> slave)
+struct inter_kb_proto_kb_settings {
+    uint8_t mode; // enum kb_mode
+    uint16_t key_polling_rate;
+} __packed;
+
+// INTER_KB_PROTO_DATA_TYPE_BL_STATE data (master -> slave)
+struct inter_kb_proto_bl_state {
+    uint16_t mode_idx;
+    uint16_t mode_speed; // speed * 100
+    uint8_t brightness;
+    uint8_t on;
+} __packed;
+
+// INTER_KB_PROTO_DATA_TYPE_BL_SYNC data (master -> slave)
+struct inter_kb_proto_bl_sync {
+    uint32_t clock_ms; // master backlight animation clock
+} __packed;
+
+// INTER_KB_PROTO_DATA_TYPE_BL_EVENT data (both ways)
+struct inter_kb_proto_bl_event {
+    uint8_t index;
+    uint8_t value;
+    uint8_t pressed;
+} __packed;
+
+// INTER_KB_PROTO_DATA_TYPE_CALIB ops
+#define INTER_KB_PROTO_CALIB_START 0  // master -> slave
+#define INTER_KB_PROTO_CALIB_FINISH 1 // master -> slave
+#define INTER_KB_PROTO_CALIB_ABORT 2  // master -> slave
+#define INTER_KB_PROTO_CALIB_KEY 3    // slave -> master, calibrated key
+#define INTER_KB_PROTO_CALIB_DONE 4   // slave -> master, all keys sent
+
+// INTER_KB_PROTO_DATA_TYPE_CALIB data (both ways)
+struct inter_kb_proto_calib {
+    uint8_t op;
+    uint8_t index; // KEY: slave key index, DONE: calibrated key count
+    // KEY only
+    uint16_t minimum;
+    uint16_t maximum;
+    uint16_t threshold;
+} __packed;
 
 // To use both ways master->slave & slave->master
 struct inter_kb_proto {
@@ -3,6 +3,7 @@
 #include "inter_kb_comm.h"
 #include "inter_kb_proto.h"
 
+#include <lib/led/kb_backlight.h>
 #include <lib/led/kb_backlight_settings.h>
 
 #include <lib/keyboard/kb_handle.h>
@@ -16,6 +17,8 @@
 
 #include <zephyr/logging/log.h>
 
+#include <string.h>
+
 LOG_MODULE_DECLARE(bt_connect, CONFIG_BT_CONNECT_LOG_LEVEL);
 
 static const struct bt_data ad[] = {
@@ -64,6 +67,58 @@ static uint32_t incoming_keys[KB_BITMAP_WORDS_SLAVE];
 
 static uint16_t ykb_start_handle, ykb_end_handle;
 static uint16_t ykb_value_handle, ykb_ccc_handle;
+static uint16_t ykb_ctrl_handle;
+
+static int ykb_master_send(uint8_t data_type, void *payload, size_t len) {
+    if (!ykb_slave_conn || !ykb_ctrl_handle) {
+        return -ENOTCONN;
+    }
+    struct inter_kb_proto data;
+    int res = inter_kb_proto_new(data_type, payload, len, &data);
+    if (res <= 0) {
+        LOG_ERR("Unable to create IKBP packet: %d", res);
+        return -EINVAL;
+    }
+
+    int rc = bt_gatt_write_without_response(ykb_slave_conn, ykb_ctrl_handle,
+                                            &data, res, false);
+    if (rc) {
+        LOG_ERR("bt_gatt_write_without_response rc=%d", rc);
+    }
+    return rc;
+}
+
+static void ykb_bl_sync_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(ykb_bl_sync_work, ykb_bl_sync_work_handler);
+
+static void ykb_bl_sync_work_handler(struct k_work *work) {
+#if CONFIG_KB_BACKLIGHT
+    if (!ykb_slave_conn || !ykb_ctrl_handle) {
+        return;
+    }
+    struct inter_kb_proto_bl_sync sync = {
+        .clock_ms = kb_backlight_clock_ms(),
+    };
+    ykb_master_send(INTER_KB_PROTO_DATA_TYPE_BL_SYNC, &sync, sizeof(sync));
+    k_work_reschedule(&ykb_bl_sync_work,
+                      K_MSEC(CONFIG_BT_INTER_KB_COMM_BL_SYNC_INTERVAL_MS));
+#endif // CONFIG_KB_BACKLIGHT
+}
+
+#if CONFIG_BT_INTER_KB_COMM_PROBE_DROP_AT_MS > 0
+
+static void ykb_drop_work_handler(struct k_work *work) {
+    if (!ykb_slave_conn) {
+        LOG_WRN("No peer link to drop");
+        return;
+    }
+    inter_kb_comm_probe("drop", NULL, 0);
+    bt_conn_disconnect(ykb_slave_conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+}
+
+static K_WORK_DELAYABLE_DEFINE(ykb_drop_work, ykb_drop_work_handler);
+
+#endif // CONFIG_BT_INTER_KB_COMM_PROBE_DROP_AT_MS > 0
 
 static uint8_t ykb_notify_cb(struct bt_conn *conn,
                              struct bt_gatt_subscribe_params *params,
@@ -89,7 +144,9 @@ static uint8_t ykb_notify_cb(struct bt_conn *conn,
     if (packet.data_type == INTER_KB_PROTO_DATA_TYPE_KEYS) {
         // TODO: mutex or sem
         memcpy(incoming_keys, packet.data, MIN(res, sizeof(incoming_keys)));
-    } else {
+        inter_kb_comm_probe("rx", packet.data, res);
+    } else if (!inter_kb_comm_handle_bl(&packet, res) &&
+               !inter_kb_comm_handle_calib(&packet, res)) {
         LOG_WRN("Unsupported IKBP packet data type %d", packet.data_type);
         return BT_GATT_ITER_CONTINUE;
     }
@@ -120,6 +177,18 @@ static uint8_t ykb_discover_func(struct bt_conn *conn,
     }
     case BT_GATT_DISCOVER_CHARACTERISTIC: {
         const struct bt_gatt_chrc *chrc = attr->user_data;
+        if (!bt_uuid_cmp(chrc->uuid, &YKB_CTRL_CHRC_UUID.uuid)) {
+            ykb_ctrl_handle = chrc->value_handle;
+            LOG_INF("Peer control characteristic found (val=%u)",
+                    ykb_ctrl_handle);
+            inter_kb_comm_probe("ready", NULL, 0);
+            // Bring the slave settings and backlight in line with ours
+            sent_kb_settings_valid = false;
+            bt_connect_send_master_kb_settings();
+            bt_connect_send_master_bl_state();
+            k_work_reschedule(&ykb_bl_sync_work, K_NO_WAIT);
+            return BT_GATT_ITER_STOP;
+        }
         ykb_value_handle = chrc->value_handle;
 
         disc_params.uuid = BT_UUID_GATT_CCC;
@@ -141,6 +210,12 @@ static uint8_t ykb_discover_func(struct bt_conn *conn,
         int rc = bt_gatt_subscribe(conn, &sub_params);
         LOG_INF("bt_gatt_subscribe rc=%d (val=%u, ccc=%u)", rc,
                 ykb_value_handle, ykb_ccc_handle);
+
+        disc_params.uuid = &YKB_CTRL_CHRC_UUID.uuid;
+        disc_params.start_handle = ykb_start_handle;
+        disc_params.end_handle = ykb_end_handle;
+        disc_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+        bt_gatt_discover(conn, &disc_params);
         return BT_GATT_ITER_STOP;
     }
     default:
@@ -243,6 +318,7 @@ static void ykb_master_connected(struct bt_conn *conn, uint8_t err) {
     }
 
     LOG_INF("Peer connected");
+    inter_kb_comm_probe("up", NULL, 0);
 
     ykb_start_discovery(conn);
 }
@@ -260,7 +336,10 @@ static void ykb_master_disconnected(struct bt_conn *conn, uint8_t reason) {
         bt_conn_unref(ykb_slave_conn);
 
         LOG_INF("Peer disconnected");
+        inter_kb_comm_probe("down", &reason, sizeof(reason));
         ykb_slave_conn = NULL;
+        ykb_ctrl_handle = 0;
+        k_work_cancel_delayable(&ykb_bl_sync_work);
         slave_was_disconnected = true;
         return;
     }
@@ -320,6 +399,11 @@ BT_CONN_CB_DEFINE(ykb_peer_cb) = {
 void ykb_master_link_start() {
     int err = bt_le_scan_start(BT_LE_SCAN_ACTIVE, ykb_device_found);
     LOG_INF("Scan start with code: %d", err);
+
+#if CONFIG_BT_INTER_KB_COMM_PROBE_DROP_AT_MS > 0
+    k_work_schedule(&ykb_drop_work,
+                    K_TIMEOUT_ABS_MS(CONFIG_BT_INTER_KB_COMM_PROBE_DROP_AT_MS));
+#endif // CONFIG_BT_INTER_KB_COMM_PROBE_DROP_AT_MS > 0
 }
 
 void ykb_master_link_stop() {
@@ -335,40 +419,63 @@ int bt_connect_get_slave_keys(uint32_t *bm, size_t bm_byte_size) {
     return 0;
 }
 
+// Main settings the slave has, valid while 'sent_kb_settings_valid'
+static struct inter_kb_proto_kb_settings sent_kb_settings;
+static bool sent_kb_settings_valid = false;
+
 void bt_connect_send_master_kb_settings() {
-    struct kb_settings_image img;
-    kb_settings_build_image_from_runtime(&img);
-    struct inter_kb_proto data;
-    int res = inter_kb_proto_new(INTER_KB_PROTO_DATA_TYPE_KB_SETTINGS, &img,
-                                 sizeof(img), &data);
-    if (res <= 0) {
-        LOG_ERR("Unable to create IKBP packet: %d", res);
+    // Only the main settings record is shared with the slave
+    const kb_settings_t *settings = kb_settings_get();
+    struct inter_kb_proto_kb_settings data = {
+        .mode = settings->main.mode,
+        .key_polling_rate = settings->main.key_polling_rate,
+    };
+    kb_settings_put(settings);
+
+    // Most commits (calibration, keymap) do not touch the main settings
+    if (sent_kb_settings_valid &&
+        !memcmp(&data, &sent_kb_settings, sizeof(data))) {
         return;
     }
-
-    struct bt_gatt_write_params params = {
-        .data = &data,
-        .handle = 2,
-        .length = res,
-    };
-    bt_gatt_write(ykb_slave_conn, &params);
+    if (!ykb_master_send(INTER_KB_PROTO_DATA_TYPE_KB_SETTINGS, &data,
+                         sizeof(data))) {
+        sent_kb_settings = data;
+        sent_kb_settings_valid = true;
+    }
 }
 
 void bt_connect_send_master_bl_state() {
+#if CONFIG_KB_BACKLIGHT
     backlight_state_img img;
     kb_backlight_settings_build_image_from_runtime(&img);
-    struct inter_kb_proto data;
-    int res = inter_kb_proto_new(INTER_KB_PROTO_DATA_TYPE_BL_STATE, &img,
-                                 sizeof(img), &data);
-    if (res <= 0) {
-        LOG_ERR("Unable to create IKBP packet: %d", res);
-        return;
-    }
+    // backlight_state_img does not fit into a single IKBP packet
+    struct inter_kb_proto_bl_state state = {
+        .mode_idx = img.mode_idx,
+        .mode_speed = (uint16_t)(img.mode_speed * 100),
+        .brightness = img.brightness,
+        .on = img.on,
+    };
+    ykb_master_send(INTER_KB_PROTO_DATA_TYPE_BL_STATE, &state, sizeof(state));
+#endif // CONFIG_KB_BACKLIGHT
+}
+
+void bt_connect_send_bl_event(const kb_key_t *key) {
+    struct inter_kb_proto_bl_event event = {
+        .index = key->index,
+        .value = key->value,
+        .pressed = key->pressed,
+    };
+    ykb_master_send(INTER_KB_PROTO_DATA_TYPE_BL_EVENT, &event, sizeof(event));
+}
+
+BUILD_ASSERT(BT_CONNECT_CALIB_START == INTER_KB_PROTO_CALIB_START &&
+             BT_CONNECT_CALIB_FINISH == INTER_KB_PROTO_CALIB_FINISH &&
+             BT_CONNECT_CALIB_ABORT == INTER_KB_PROTO_CALIB_ABORT);
 
-    struct bt_gatt_write_params params = {
-        .data = &data,
-        .handle = 2,
-        .length = res,
+int bt_connect_send_master_calib(enum bt_connect_calib_op op) {
+    struct inter_kb_proto_calib calib = {
+        .op = op,
     };
-    bt_gatt_write(ykb_slave_conn, &params);
+    return ykb_master_send(INTER_KB_PROTO_DATA_TYPE_CALIB, &calib,
+                           sizeof(calib));
 }
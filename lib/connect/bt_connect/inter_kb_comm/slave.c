@@ -3,6 +3,9 @@
 #include "inter_kb_comm.h"
 #include "inter_kb_proto.h"
 
+#include <lib/connect/bt_connect.h>
+#include <lib/keyboard/kb_key.h>
+
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/gatt.h>
@@ -36,11 +39,42 @@ static void ykb_ccc_cfg_changed(const struct bt_gatt_attr *attr,
     ykb_ccc_enabled = (value == BT_GATT_CCC_NOTIFY);
 }
 
+static ssize_t ykb_ctrl_write(struct bt_conn *conn,
+                              const struct bt_gatt_attr *attr,
+                              const void *buf, uint16_t len, uint16_t offset,
+                              uint8_t flags) {
+    if (offset) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+    if (len > sizeof(struct inter_kb_proto)) {
+        LOG_ERR("Incoming BLE packet too big");
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    struct inter_kb_proto packet = {0};
+    int res = inter_kb_proto_parse((uint8_t *)buf, len, &packet);
+    if (res <= 0) {
+        LOG_ERR("Unable to parse IKBP packet (err %d)", res);
+        return len;
+    }
+
+    if (!inter_kb_comm_handle_bl(&packet, res) &&
+        !inter_kb_comm_handle_settings(&packet, res) &&
+        !inter_kb_comm_handle_calib(&packet, res)) {
+        LOG_WRN("Unsupported IKBP packet data type %d", packet.data_type);
+    }
+
+    return len;
+}
+
 BT_GATT_SERVICE_DEFINE(
     ykb_split_svc, BT_GATT_PRIMARY_SERVICE(&YKB_SPLIT_SVC_UUID),
     BT_GATT_CHARACTERISTIC(&YKB_KEYS_CHRC_UUID.uuid, BT_GATT_CHRC_NOTIFY,
                            BT_GATT_PERM_NONE, NULL, NULL, NULL),
-    BT_GATT_CCC(ykb_ccc_cfg_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE));
+    BT_GATT_CCC(ykb_ccc_cfg_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+    BT_GATT_CHARACTERISTIC(&YKB_CTRL_CHRC_UUID.uuid,
+                           BT_GATT_CHRC_WRITE_WITHOUT_RESP, BT_GATT_PERM_WRITE,
+                           NULL, ykb_ctrl_write, NULL));
 
 static void ykb_peer_connected(struct bt_conn *conn, uint8_t err) {
 
@@ -73,23 +107,58 @@ bool ykb_slave_is_connected() {
 
 static const struct bt_gatt_attr *ykb_val = &ykb_split_svc.attrs[2]; // value
 
-void bt_connect_send_slave_keys(uint32_t *bm, size_t bm_len) {
+static int ykb_slave_send(uint8_t data_type, void *payload, size_t len) {
     if (!ykb_master_conn) {
-        return;
+        return -ENOTCONN;
     }
     if (!bt_gatt_is_subscribed(ykb_master_conn, ykb_val, BT_GATT_CCC_NOTIFY)) {
-        return;
+        return -ENOTCONN;
     }
     struct inter_kb_proto data;
-    int res =
-        inter_kb_proto_new(INTER_KB_PROTO_DATA_TYPE_KEYS, bm, bm_len, &data);
+    int res = inter_kb_proto_new(data_type, payload, len, &data);
     if (res <= 0) {
         LOG_ERR("Unable to pack IKBP (err %d)", res);
-        return;
+        return -EINVAL;
     }
 
     int rc = bt_gatt_notify(ykb_master_conn, ykb_val, &data, res);
     if (rc) {
         LOG_ERR("bt_gatt_notify rc=%d", rc);
     }
+    return rc;
+}
+
+void bt_connect_send_slave_keys(uint32_t *bm, size_t bm_len) {
+    int rc = ykb_slave_send(INTER_KB_PROTO_DATA_TYPE_KEYS, bm, bm_len);
+    // Bitmaps that did not make it out are counted as lost by the probe
+    inter_kb_comm_probe(rc ? "txerr" : "tx", bm, bm_len);
+}
+
+void bt_connect_send_bl_event(const kb_key_t *key) {
+    struct inter_kb_proto_bl_event event = {
+        .index = key->index,
+        .value = key->value,
+        .pressed = key->pressed,
+    };
+    ykb_slave_send(INTER_KB_PROTO_DATA_TYPE_BL_EVENT, &event, sizeof(event));
+}
+
+int bt_connect_send_slave_calib_key(uint8_t index,
+                                    const kb_settings_key_calib_t *calib) {
+    struct inter_kb_proto_calib data = {
+        .op = INTER_KB_PROTO_CALIB_KEY,
+        .index = index,
+        .minimum = calib->minimum,
+        .maximum = calib->maximum,
+        .threshold = calib->threshold,
+    };
+    return ykb_slave_send(INTER_KB_PROTO_DATA_TYPE_CALIB, &data, sizeof(data));
+}
+
+int bt_connect_send_slave_calib_done(uint8_t count) {
+    struct inter_kb_proto_calib data = {
+        .op = INTER_KB_PROTO_CALIB_DONE,
+        .index = count,
+    };
+    return ykb_slave_send(INTER_KB_PROTO_DATA_TYPE_CALIB, &data, sizeof(data));
 }
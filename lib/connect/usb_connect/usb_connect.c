@@ -1,4 +1,5 @@
 #include <lib/connect/usb_connect.h>
+#include <lib/connect/usb_connect_vendor.h>
 
 #include "usbd_init.h"
 
@@ -11,6 +12,7 @@ static const uint8_t hid_report_desc[] = HID_KEYBOARD_REPORT_DESC();
 
 static uint32_t kb_duration;
 static bool kb_ready;
+static bool vbus_present;
 
 static struct usbd_context *usbd;
 static const struct device *hid_dev;
@@ -82,12 +84,14 @@ static void msg_cb(struct usbd_context *const usbd_ctx,
 
     if (usbd_can_detect_vbus(usbd_ctx)) {
         if (msg->type == USBD_MSG_VBUS_READY) {
+            vbus_present = true;
             if (usbd_enable(usbd_ctx)) {
                 LOG_ERR("Failed to enable device support");
             }
         }
 
         if (msg->type == USBD_MSG_VBUS_REMOVED) {
+            vbus_present = false;
             if (usbd_disable(usbd_ctx)) {
                 LOG_ERR("Failed to disable device support");
             }
@@ -98,7 +102,7 @@ static void msg_cb(struct usbd_context *const usbd_ctx,
 int usb_connect_init() {
     int ret;
 
-    hid_dev = DEVICE_DT_GET_ONE(zephyr_hid_device);
+    hid_dev = DEVICE_DT_GET(DT_NODELABEL(hid_dev_0));
     if (!device_is_ready(hid_dev)) {
         return -EIO;
     }
@@ -109,6 +113,13 @@ int usb_connect_init() {
         return ret;
     }
 
+#if CONFIG_USB_CONNECT_VENDOR
+    ret = usb_connect_vendor_init();
+    if (ret != 0) {
+        return ret;
+    }
+#endif // CONFIG_USB_CONNECT_VENDOR
+
     usbd = usbd_init_device(msg_cb);
     if (usbd == NULL) {
         return -ENODEV;
@@ -145,6 +156,13 @@ bool usb_connect_is_ready() {
     return kb_ready;
 }
 
+bool usb_connect_is_powered() {
+    if (usbd && usbd_can_detect_vbus(usbd)) {
+        return vbus_present;
+    }
+    return kb_ready;
+}
+
 uint32_t usb_connect_duration() {
     return kb_duration;
 }
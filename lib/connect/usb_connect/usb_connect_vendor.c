@@ -0,0 +1,198 @@
+#include <lib/connect/usb_connect_vendor.h>
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/usb/class/hid.h>
+#include <zephyr/usb/class/usbd_hid.h>
+
+#include <errno.h>
+#include <string.h>
+
+LOG_MODULE_DECLARE(usb_connect, CONFIG_USB_CONNECT_LOG_LEVEL);
+
+static const uint8_t vendor_report_desc[] = {
+    // Usage Page (Vendor Defined 0xFF60)
+    0x06, 0x60, 0xFF,
+    HID_USAGE(0x61),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+        HID_LOGICAL_MIN8(0x00),
+        HID_LOGICAL_MAX16(0xFF, 0x00),
+        HID_REPORT_SIZE(8),
+
+        HID_REPORT_ID(USB_CONNECT_VENDOR_REPORT_STATS),
+        HID_USAGE(0x62),
+        HID_REPORT_COUNT(USB_CONNECT_VENDOR_REPORT_SIZE),
+        HID_FEATURE(0x02),
+
+        HID_REPORT_ID(USB_CONNECT_VENDOR_REPORT_COMMAND),
+        HID_USAGE(0x63),
+        HID_REPORT_COUNT(USB_CONNECT_VENDOR_REPORT_SIZE),
+        HID_OUTPUT(0x02),
+
+        HID_REPORT_ID(USB_CONNECT_VENDOR_REPORT_RESPONSE),
+        HID_USAGE(0x64),
+        HID_REPORT_COUNT(USB_CONNECT_VENDOR_REPORT_SIZE),
+        HID_INPUT(0x02),
+
+        HID_REPORT_ID(USB_CONNECT_VENDOR_REPORT_STREAM),
+        HID_USAGE(0x65),
+        HID_REPORT_COUNT(USB_CONNECT_VENDOR_REPORT_SIZE),
+        HID_INPUT(0x02),
+    HID_END_COLLECTION,
+};
+
+#define REPORT_LEN (USB_CONNECT_VENDOR_REPORT_SIZE + 1)
+
+static const struct device *vendor_dev;
+static bool vendor_ready;
+
+static usb_connect_vendor_feature_cb
+    feature_cbs[USB_CONNECT_VENDOR_REPORT_COUNT];
+static usb_connect_vendor_output_cb output_cbs[USB_CONNECT_VENDOR_REPORT_COUNT];
+
+// Input reports waiting for the IN endpoint
+K_MSGQ_DEFINE(tx_queue, REPORT_LEN, CONFIG_USB_CONNECT_VENDOR_TX_QUEUE_SIZE,
+              1);
+
+// Report being transferred, owned by the stack while 'tx_busy' is set
+static uint8_t tx_report[REPORT_LEN];
+static atomic_t tx_busy = ATOMIC_INIT(0);
+
+static void vendor_tx_kick() {
+    if (atomic_set(&tx_busy, 1)) {
+        return;
+    }
+    while (!vendor_ready || k_msgq_get(&tx_queue, tx_report, K_NO_WAIT)) {
+        atomic_clear(&tx_busy);
+        // A report queued before the clear saw us busy and left it to us
+        if (!vendor_ready || !k_msgq_num_used_get(&tx_queue) ||
+            atomic_set(&tx_busy, 1)) {
+            return;
+        }
+    }
+
+    int ret = hid_device_submit_report(vendor_dev, REPORT_LEN, tx_report);
+    if (ret) {
+        LOG_WRN("Vendor report ID %u submit error, %d", tx_report[0], ret);
+        atomic_clear(&tx_busy);
+    }
+}
+
+static void vendor_input_report_done(const struct device *dev,
+                                     const uint8_t *const report) {
+    atomic_clear(&tx_busy);
+    vendor_tx_kick();
+}
+
+static void vendor_iface_ready(const struct device *dev, const bool ready) {
+    LOG_INF("HID device %s interface is %s", dev->name,
+            ready ? "ready" : "not ready");
+    vendor_ready = ready;
+    if (!ready) {
+        // Reports queued for the previous host are stale
+        k_msgq_purge(&tx_queue);
+    }
+}
+
+static int vendor_get_report(const struct device *dev, const uint8_t type,
+                             const uint8_t id, const uint16_t len,
+                             uint8_t *const buf) {
+    if (type != HID_REPORT_TYPE_FEATURE || id == 0 ||
+        id >= USB_CONNECT_VENDOR_REPORT_COUNT || !feature_cbs[id]) {
+        LOG_WRN("Unsupported vendor report, Type %u ID %u", type, id);
+        return -ENOTSUP;
+    }
+    if (len < USB_CONNECT_VENDOR_REPORT_SIZE + 1) {
+        return -ENOMEM;
+    }
+
+    buf[0] = id;
+    memset(&buf[1], 0, USB_CONNECT_VENDOR_REPORT_SIZE);
+    feature_cbs[id](&buf[1], USB_CONNECT_VENDOR_REPORT_SIZE);
+
+    return USB_CONNECT_VENDOR_REPORT_SIZE + 1;
+}
+
+static int vendor_set_report(const struct device *dev, const uint8_t type,
+                             const uint8_t id, const uint16_t len,
+                             const uint8_t *const buf) {
+    if (type != HID_REPORT_TYPE_OUTPUT || id == 0 ||
+        id >= USB_CONNECT_VENDOR_REPORT_COUNT || !output_cbs[id]) {
+        LOG_WRN("Unsupported vendor report, Type %u ID %u", type, id);
+        return -ENOTSUP;
+    }
+    // Report ID is the first byte of 'buf'
+    if (len < 1) {
+        return -EINVAL;
+    }
+
+    output_cbs[id](&buf[1], len - 1);
+
+    return 0;
+}
+
+static struct hid_device_ops vendor_ops = {
+    .iface_ready = vendor_iface_ready,
+    .get_report = vendor_get_report,
+    .set_report = vendor_set_report,
+    .input_report_done = vendor_input_report_done,
+};
+
+int usb_connect_vendor_init() {
+    vendor_dev = DEVICE_DT_GET(DT_NODELABEL(hid_vendor));
+    if (!device_is_ready(vendor_dev)) {
+        return -EIO;
+    }
+
+    return hid_device_register(vendor_dev, vendor_report_desc,
+                               sizeof(vendor_report_desc), &vendor_ops);
+}
+
+int usb_connect_vendor_set_feature_cb(enum usb_connect_vendor_report_id id,
+                                      usb_connect_vendor_feature_cb cb) {
+    if (id == 0 || id >= USB_CONNECT_VENDOR_REPORT_COUNT) {
+        return -EINVAL;
+    }
+
+    feature_cbs[id] = cb;
+
+    return 0;
+}
+
+int usb_connect_vendor_set_output_cb(enum usb_connect_vendor_report_id id,
+                                     usb_connect_vendor_output_cb cb) {
+    if (id == 0 || id >= USB_CONNECT_VENDOR_REPORT_COUNT) {
+        return -EINVAL;
+    }
+
+    output_cbs[id] = cb;
+
+    return 0;
+}
+
+int usb_connect_vendor_send(enum usb_connect_vendor_report_id id,
+                            const uint8_t *buf, uint16_t len) {
+    if (id == 0 || id >= USB_CONNECT_VENDOR_REPORT_COUNT ||
+        len > USB_CONNECT_VENDOR_REPORT_SIZE) {
+        return -EINVAL;
+    }
+    if (!vendor_ready) {
+        return -ENOTCONN;
+    }
+
+    uint8_t report[REPORT_LEN] = {id};
+    memcpy(&report[1], buf, len);
+    if (k_msgq_put(&tx_queue, report, K_NO_WAIT)) {
+        return -EAGAIN;
+    }
+
+    vendor_tx_kick();
+
+    return 0;
+}
+
+bool usb_connect_vendor_is_ready() {
+    return vendor_ready;
+}
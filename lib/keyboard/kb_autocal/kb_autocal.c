@@ -0,0 +1,241 @@
+#include <lib/keyboard/kb_autocal.h>
+
+#include <lib/keyboard/kb_handle.h>
+#include <lib/keyboard/kb_settings.h>
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+LOG_MODULE_REGISTER(kb_autocal, CONFIG_KB_AUTOCAL_LOG_LEVEL);
+
+// Baselines are Q16 fixed point
+#define KB_AUTOCAL_FRAC_BITS 16
+
+// Idle updates after which a baseline counts as settled, a few filter time
+// constants
+#define KB_AUTOCAL_SETTLED_UPDATES (4u << CONFIG_KB_AUTOCAL_SHIFT)
+
+struct kb_autocal_key {
+    // Resting value at the reference temperature. Written by the scan loop
+    // only, 32-bit reads by the persist work are atomic.
+    int32_t baseline;
+    // Calibrated minimum the baseline was synced to
+    uint16_t minimum;
+    // Value seen by the previous update
+    uint16_t prev;
+    // Idle updates since the last persist check (saturating)
+    atomic_t idle;
+};
+
+static struct kb_autocal_key keys[CONFIG_KB_KEY_COUNT];
+
+// Thresholds for the next poll, owned by the scan loop
+static uint16_t thresholds[CONFIG_KB_KEY_COUNT];
+static uint32_t thresholds_generation;
+static bool thresholds_valid = false;
+
+static uint32_t scan_count;
+
+// Baseline offset of the current temperature (raw units)
+static atomic_t temp_offset = ATOMIC_INIT(0);
+
+static inline int32_t kb_autocal_baseline(const struct kb_autocal_key *k) {
+    return k->baseline >> KB_AUTOCAL_FRAC_BITS;
+}
+
+// Drift of the baseline at the current temperature from the calibrated
+// minimum
+static inline int32_t kb_autocal_drift(const struct kb_autocal_key *k) {
+    int32_t drift =
+        kb_autocal_baseline(k) + (int32_t)atomic_get(&temp_offset) - k->minimum;
+    return CLAMP(drift, -CONFIG_KB_AUTOCAL_MAX_DRIFT,
+                 CONFIG_KB_AUTOCAL_MAX_DRIFT);
+}
+
+// Restart tracking of keys whose calibration changed (calibration, profile
+// switch, persisted drift)
+static void kb_autocal_sync(const kb_settings_t *settings) {
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
+        struct kb_autocal_key *k = &keys[i];
+        uint16_t minimum = settings->keys_calibration[i].minimum;
+        if (thresholds_valid && k->minimum == minimum) {
+            continue;
+        }
+        k->minimum = minimum;
+        k->prev = minimum;
+        k->baseline = (int32_t)minimum << KB_AUTOCAL_FRAC_BITS;
+        atomic_set(&k->idle, 0);
+    }
+}
+
+static void kb_autocal_update_thresholds(const kb_settings_t *settings) {
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
+        int32_t threshold =
+            settings->key_thresholds[i] + kb_autocal_drift(&keys[i]);
+        thresholds[i] = CLAMP(threshold, 1, UINT16_MAX);
+    }
+    thresholds_generation = settings->generation;
+    thresholds_valid = true;
+}
+
+const uint16_t *kb_autocal_thresholds(const kb_settings_t *settings) {
+    if (!thresholds_valid || thresholds_generation != settings->generation) {
+        kb_autocal_sync(settings);
+        kb_autocal_update_thresholds(settings);
+    }
+    return thresholds;
+}
+
+void kb_autocal_on_scan(const kb_settings_t *settings, const uint16_t *values,
+                        const uint32_t *curr_down) {
+    if (++scan_count < CONFIG_KB_AUTOCAL_INTERVAL) {
+        return;
+    }
+    scan_count = 0;
+
+    int32_t offset = (int32_t)atomic_get(&temp_offset);
+
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
+        struct kb_autocal_key *k = &keys[i];
+        uint16_t value = values[i];
+        uint16_t prev = k->prev;
+        k->prev = value;
+
+        if (curr_down[i / KB_WORD_BITS] & BIT(i % KB_WORD_BITS)) {
+            continue;
+        }
+
+        // Idle: steady and in the lower half of the travel to the threshold
+        int32_t baseline = kb_autocal_baseline(k) + offset;
+        int32_t half = (thresholds[i] - baseline) / 2;
+        if (abs((int32_t)value - prev) > CONFIG_KB_AUTOCAL_IDLE_BAND ||
+            (int32_t)value - baseline > MAX(half, 0)) {
+            continue;
+        }
+
+        // Back to the reference temperature
+        int32_t target = ((int32_t)value - offset) << KB_AUTOCAL_FRAC_BITS;
+        k->baseline += (target - k->baseline) >> CONFIG_KB_AUTOCAL_SHIFT;
+
+        if (atomic_get(&k->idle) < KB_AUTOCAL_SETTLED_UPDATES) {
+            atomic_inc(&k->idle);
+        }
+    }
+
+    kb_autocal_update_thresholds(settings);
+}
+
+static void kb_autocal_persist_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(persist_work, kb_autocal_persist_work_handler);
+
+static void kb_autocal_persist_work_handler(struct k_work *work) {
+    k_work_reschedule(&persist_work,
+                      K_SECONDS(CONFIG_KB_AUTOCAL_PERSIST_INTERVAL_S));
+
+    kb_settings_t *settings = kb_settings_edit_begin();
+    if (!settings) {
+        LOG_WRN("Unable to edit settings, drift not persisted");
+        return;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
+        struct kb_autocal_key *k = &keys[i];
+        kb_settings_key_calib_t *calib = &settings->keys_calibration[i];
+
+        bool settled = atomic_set(&k->idle, 0) >= KB_AUTOCAL_SETTLED_UPDATES;
+        // Drift at the reference temperature
+        int32_t drift = kb_autocal_baseline(k) - calib->minimum;
+        drift = CLAMP(drift, -CONFIG_KB_AUTOCAL_MAX_DRIFT,
+                      CONFIG_KB_AUTOCAL_MAX_DRIFT);
+        if (!settled || k->minimum != calib->minimum ||
+            abs(drift) < CONFIG_KB_AUTOCAL_PERSIST_DELTA) {
+            continue;
+        }
+        if (calib->minimum + drift < 0 ||
+            calib->maximum + drift > UINT16_MAX) {
+            continue;
+        }
+
+        // The whole curve moves with the resting value
+        calib->minimum += drift;
+        calib->maximum += drift;
+        calib->threshold += drift;
+        kb_settings_edit_mark_key(settings, i, false, KB_SETTINGS_PART_CALIB);
+        count++;
+    }
+
+    if (!count) {
+        kb_settings_edit_abort(settings);
+        return;
+    }
+
+    // The scan loop resyncs the moved keys from the new minimum
+    kb_settings_edit_commit(settings, 0);
+    LOG_INF("Persisted baseline drift of %u keys", (unsigned)count);
+}
+
+#if CONFIG_KB_AUTOCAL_TEMP
+
+static const struct device *const temp_dev =
+    DEVICE_DT_GET(DT_ALIAS(die_temp0));
+
+// Reference temperature (0.01 C) the baselines are kept at
+static int32_t temp_ref;
+static bool temp_ref_valid = false;
+
+static void kb_autocal_temp_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(temp_work, kb_autocal_temp_work_handler);
+
+static void kb_autocal_temp_work_handler(struct k_work *work) {
+    k_work_reschedule(&temp_work, K_MSEC(CONFIG_KB_AUTOCAL_TEMP_INTERVAL_MS));
+
+    struct sensor_value val;
+    int ret = sensor_sample_fetch(temp_dev);
+    if (!ret) {
+        ret = sensor_channel_get(temp_dev, SENSOR_CHAN_DIE_TEMP, &val);
+    }
+    if (ret) {
+        LOG_WRN("Unable to read die temperature (err %d)", ret);
+        return;
+    }
+
+    int32_t temp = val.val1 * 100 + val.val2 / 10000;
+    if (!temp_ref_valid) {
+        // Calibrations are assumed to match the boot temperature
+        temp_ref = temp;
+        temp_ref_valid = true;
+    }
+
+    int32_t offset =
+        (temp - temp_ref) * CONFIG_KB_AUTOCAL_TEMP_COEFF / (100 * 100);
+    if (atomic_set(&temp_offset, offset) != offset) {
+        LOG_DBG("Temperature %d.%02d C, baseline offset %d", temp / 100,
+                abs(temp % 100), offset);
+    }
+}
+
+#endif // CONFIG_KB_AUTOCAL_TEMP
+
+int kb_autocal_init() {
+#if CONFIG_KB_AUTOCAL_TEMP
+    if (!device_is_ready(temp_dev)) {
+        LOG_ERR("Die temperature sensor is not ready");
+        return -ENODEV;
+    }
+    k_work_schedule(&temp_work, K_NO_WAIT);
+#endif // CONFIG_KB_AUTOCAL_TEMP
+
+    k_work_schedule(&persist_work,
+                    K_SECONDS(CONFIG_KB_AUTOCAL_PERSIST_INTERVAL_S));
+    return 0;
+}
@@ -0,0 +1,329 @@
+#include <lib/keyboard/kb_calibration.h>
+
+#include <lib/connect/bt_connect.h>
+#include <lib/keyboard/kb_settings.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(kb_calibration, CONFIG_KB_CALIBRATION_LOG_LEVEL);
+
+// Delay before retrying to send results the link had no buffers for
+#define KB_CALIBRATION_SEND_RETRY_MS 5
+
+struct kb_calibration_key {
+    uint16_t history[2]; // Previous two raw values for the median filter
+    uint16_t minimum;
+    uint16_t maximum;
+};
+
+static struct kb_calibration_key keys[CONFIG_KB_KEY_COUNT];
+static uint32_t samples;
+
+static enum kb_calibration_state state = KB_CALIBRATION_IDLE;
+static struct k_spinlock lock;
+
+static uint8_t last_count;
+
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+// Slave half was started and did not send all its results yet
+static atomic_t slave_pending;
+static kb_settings_key_calib_t slave_keys[CONFIG_KB_KEY_COUNT_SLAVE];
+static bool slave_valid[CONFIG_KB_KEY_COUNT_SLAVE];
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+
+#if CONFIG_BT_INTER_KB_COMM_SLAVE
+// Keys calibrated by the last run, sent to the master half
+static bool calibrated[CONFIG_KB_KEY_COUNT];
+static size_t send_index;
+#endif // CONFIG_BT_INTER_KB_COMM_SLAVE
+
+static inline uint16_t median3(uint16_t a, uint16_t b, uint16_t c) {
+    return MAX(MIN(a, b), MIN(MAX(a, b), c));
+}
+
+static void kb_calibration_set_state(enum kb_calibration_state new_state) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    state = new_state;
+    k_spin_unlock(&lock, key);
+}
+
+enum kb_calibration_state kb_calibration_get_state() {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    enum kb_calibration_state current = state;
+    k_spin_unlock(&lock, key);
+    return current;
+}
+
+uint8_t kb_calibration_get_last_count() {
+    return last_count;
+}
+
+bool kb_calibration_on_scan(const uint16_t *values) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (state != KB_CALIBRATION_RUNNING) {
+        bool busy = state != KB_CALIBRATION_IDLE;
+        k_spin_unlock(&lock, key);
+        return busy;
+    }
+
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
+        struct kb_calibration_key *k = &keys[i];
+        if (samples >= ARRAY_SIZE(k->history)) {
+            uint16_t value = median3(k->history[0], k->history[1], values[i]);
+            k->minimum = MIN(k->minimum, value);
+            k->maximum = MAX(k->maximum, value);
+        }
+        k->history[0] = k->history[1];
+        k->history[1] = values[i];
+    }
+    samples++;
+
+    k_spin_unlock(&lock, key);
+    return true;
+}
+
+// Update 'calib' with the captured extremes, keeping the actuation point of
+// the threshold
+//
+// Returns false if the key was not pressed through during the window
+static bool kb_calibration_update(kb_settings_key_calib_t *calib,
+                                  const struct kb_calibration_key *k) {
+    if (k->minimum >= k->maximum ||
+        k->maximum - k->minimum < CONFIG_KB_CALIBRATION_MIN_TRAVEL) {
+        return false;
+    }
+
+    calib->threshold =
+        kb_settings_calib_rescale_threshold(calib, k->minimum, k->maximum);
+    calib->minimum = k->minimum;
+    calib->maximum = k->maximum;
+    return true;
+}
+
+#if CONFIG_BT_INTER_KB_COMM_SLAVE
+
+static void kb_calibration_send_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(send_work, kb_calibration_send_work_handler);
+
+static void kb_calibration_send_work_handler(struct k_work *work) {
+    const kb_settings_t *settings = kb_settings_get();
+    int ret = 0;
+
+    for (; send_index < CONFIG_KB_KEY_COUNT; ++send_index) {
+        if (!calibrated[send_index]) {
+            continue;
+        }
+        ret = bt_connect_send_slave_calib_key(
+            send_index, &settings->keys_calibration[send_index]);
+        if (ret) {
+            break;
+        }
+    }
+
+    kb_settings_put(settings);
+
+    if (!ret) {
+        ret = bt_connect_send_slave_calib_done(last_count);
+    }
+    if (!ret) {
+        return;
+    }
+
+    if (ret == -ENOTCONN) {
+        LOG_WRN("Master half not connected, results are kept on this half");
+        return;
+    }
+    k_work_reschedule(&send_work, K_MSEC(KB_CALIBRATION_SEND_RETRY_MS));
+}
+
+#endif // CONFIG_BT_INTER_KB_COMM_SLAVE
+
+static void kb_calibration_apply_work_handler(struct k_work *work) {
+    if (kb_calibration_get_state() != KB_CALIBRATION_FINISHING) {
+        // Aborted meanwhile
+        return;
+    }
+
+    kb_settings_t *settings = kb_settings_edit_begin();
+    if (!settings) {
+        LOG_ERR("Unable to edit settings, calibration dropped");
+        kb_calibration_set_state(KB_CALIBRATION_IDLE);
+        return;
+    }
+
+    // The scan loop does not touch 'keys' until the next start
+    uint8_t count = 0;
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
+        bool updated =
+            kb_calibration_update(&settings->keys_calibration[i], &keys[i]);
+#if CONFIG_BT_INTER_KB_COMM_SLAVE
+        calibrated[i] = updated;
+#endif // CONFIG_BT_INTER_KB_COMM_SLAVE
+        if (!updated) {
+            LOG_DBG("Key %u was not pressed, not calibrated", (unsigned)i);
+            continue;
+        }
+        kb_settings_edit_mark_key(settings, i, false, KB_SETTINGS_PART_CALIB);
+        count++;
+    }
+
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+    if (atomic_clear(&slave_pending)) {
+        LOG_WRN("No results from the slave half, saving without them");
+    }
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT_SLAVE; ++i) {
+        if (!slave_valid[i]) {
+            continue;
+        }
+        settings->keys_calibration_slave[i] = slave_keys[i];
+        kb_settings_edit_mark_key(settings, i, true,
+                                  KB_SETTINGS_PART_CALIB_SLAVE);
+        count++;
+    }
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+
+    // Single commit, so all keys are written to flash together
+    kb_settings_edit_commit(settings, 0);
+
+    last_count = count;
+    kb_calibration_set_state(KB_CALIBRATION_IDLE);
+    LOG_INF("Calibration finished, %u keys calibrated", count);
+
+#if CONFIG_BT_INTER_KB_COMM_SLAVE
+    send_index = 0;
+    k_work_reschedule(&send_work, K_NO_WAIT);
+#endif // CONFIG_BT_INTER_KB_COMM_SLAVE
+}
+
+static K_WORK_DELAYABLE_DEFINE(apply_work, kb_calibration_apply_work_handler);
+
+static void kb_calibration_window_work_handler(struct k_work *work) {
+    kb_calibration_finish();
+}
+
+static K_WORK_DELAYABLE_DEFINE(window_work,
+                               kb_calibration_window_work_handler);
+
+int kb_calibration_start() {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    if (state != KB_CALIBRATION_IDLE) {
+        k_spin_unlock(&lock, key);
+        return -EBUSY;
+    }
+
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
+        keys[i].minimum = UINT16_MAX;
+        keys[i].maximum = 0;
+    }
+    samples = 0;
+    state = KB_CALIBRATION_RUNNING;
+    k_spin_unlock(&lock, key);
+
+#if CONFIG_BT_INTER_KB_COMM_SLAVE
+    // Results of the previous run are stale now
+    k_work_cancel_delayable(&send_work);
+#endif // CONFIG_BT_INTER_KB_COMM_SLAVE
+
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+    memset(slave_valid, 0, sizeof(slave_valid));
+    int ret = bt_connect_send_master_calib(BT_CONNECT_CALIB_START);
+    atomic_set(&slave_pending, ret == 0);
+    if (ret) {
+        LOG_WRN("Slave half not calibrated (err %d)", ret);
+    }
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+
+    k_work_reschedule(&window_work, K_MSEC(CONFIG_KB_CALIBRATION_WINDOW_MS));
+    LOG_INF("Calibration started, press every key all the way down");
+    return 0;
+}
+
+int kb_calibration_finish() {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    if (state != KB_CALIBRATION_RUNNING) {
+        k_spin_unlock(&lock, key);
+        return -EALREADY;
+    }
+    state = KB_CALIBRATION_FINISHING;
+    k_spin_unlock(&lock, key);
+
+    k_work_cancel_delayable(&window_work);
+
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+    if (atomic_get(&slave_pending)) {
+        // Applied once the slave half results are in
+        bt_connect_send_master_calib(BT_CONNECT_CALIB_FINISH);
+        k_work_reschedule(&apply_work,
+                          K_MSEC(CONFIG_KB_CALIBRATION_SLAVE_TIMEOUT_MS));
+        return 0;
+    }
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+
+    k_work_reschedule(&apply_work, K_NO_WAIT);
+    return 0;
+}
+
+void kb_calibration_abort() {
+    kb_calibration_set_state(KB_CALIBRATION_IDLE);
+    k_work_cancel_delayable(&window_work);
+    k_work_cancel_delayable(&apply_work);
+
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+    if (atomic_clear(&slave_pending)) {
+        bt_connect_send_master_calib(BT_CONNECT_CALIB_ABORT);
+    }
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+
+    LOG_INF("Calibration aborted");
+}
+
+void kb_calibration_toggle() {
+    switch (kb_calibration_get_state()) {
+    case KB_CALIBRATION_IDLE:
+        kb_calibration_start();
+        break;
+    case KB_CALIBRATION_RUNNING:
+        kb_calibration_finish();
+        break;
+    default:
+        break;
+    }
+}
+
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+
+void kb_calibration_on_slave_key(uint8_t index,
+                                 const kb_settings_key_calib_t *calib) {
+    if (index >= CONFIG_KB_KEY_COUNT_SLAVE || !atomic_get(&slave_pending)) {
+        LOG_WRN("Unexpected slave calibration of key %u", index);
+        return;
+    }
+    if (calib->minimum >= calib->maximum) {
+        LOG_WRN("Bad slave calibration of key %u", index);
+        return;
+    }
+    slave_keys[index] = *calib;
+    slave_valid[index] = true;
+}
+
+void kb_calibration_on_slave_done(uint8_t count) {
+    if (!atomic_clear(&slave_pending)) {
+        return;
+    }
+    LOG_INF("Slave half calibrated %u keys", count);
+    if (kb_calibration_get_state() == KB_CALIBRATION_FINISHING) {
+        k_work_reschedule(&apply_work, K_NO_WAIT);
+    }
+}
+
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
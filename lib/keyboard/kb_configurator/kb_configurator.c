@@ -0,0 +1,552 @@
+#include <lib/keyboard/kb_configurator.h>
+
+#include <lib/connect/usb_connect_vendor.h>
+#include <lib/keyboard/kb_calibration.h>
+#include <lib/keyboard/kb_settings.h>
+#include <lib/keyboard/kb_travel.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(kb_configurator, CONFIG_KB_CONFIGURATOR_LOG_LEVEL);
+
+#define PAYLOAD_SIZE USB_CONNECT_VENDOR_REPORT_SIZE
+
+// u8 cmd, u8 tag
+#define CMD_HEADER_SIZE 2
+// u8 cmd, u8 tag, i8 status
+#define RESP_HEADER_SIZE 3
+// u8 section, u8 first key, u8 key count
+#define RANGE_HEADER_SIZE 3
+
+// Room for READ/WRITE items, the same both ways
+#define ITEMS_SIZE (PAYLOAD_SIZE - RESP_HEADER_SIZE - RANGE_HEADER_SIZE)
+
+#define MAIN_ITEM_SIZE 3
+#define CALIB_ITEM_SIZE 6
+#define ACTUATION_ITEM_SIZE 2
+#define RULE_SIZE 3
+#define KEYMAP_ITEM_SIZE (1 + CONFIG_KB_MAX_RULES_PER_KEY * RULE_SIZE)
+
+BUILD_ASSERT(KEYMAP_ITEM_SIZE <= ITEMS_SIZE,
+             "CONFIG_KB_MAX_RULES_PER_KEY rules do not fit into a report");
+
+#define STREAM_REPORTS_PER_FRAME                                               \
+    DIV_ROUND_UP(CONFIG_KB_KEY_COUNT, KB_CONF_STREAM_KEYS_PER_REPORT)
+
+#define RESPONSE_RETRIES 10
+
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+#define KEY_COUNT_SLAVE CONFIG_KB_KEY_COUNT_SLAVE
+#define SECTION_ARRAY(settings, slave, field)                                  \
+    ((slave) ? (settings)->field##_slave : (settings)->field)
+#else
+#define KEY_COUNT_SLAVE 0
+#define SECTION_ARRAY(settings, slave, field) ((settings)->field)
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+
+// Commands are handled on the system work queue, not in the USB stack thread
+K_MSGQ_DEFINE(cmd_queue, PAYLOAD_SIZE, CONFIG_KB_CONFIGURATOR_CMD_QUEUE_SIZE,
+              1);
+
+// Latest scanned values, for calibration
+static uint16_t last_values[CONFIG_KB_KEY_COUNT];
+static bool last_values_valid = false;
+static struct k_spinlock values_lock;
+
+static atomic_t stream_interval = ATOMIC_INIT(0);
+static uint8_t stream_scans = 0;
+static uint16_t stream_seq = 0;
+
+// Key range of READ/WRITE arguments
+struct range {
+    uint8_t section;
+    uint8_t first;
+    uint8_t count;
+    bool slave;
+    size_t item_size;
+};
+
+static int range_parse(const uint8_t *args, struct range *range, bool clamp) {
+    size_t key_count;
+
+    range->section = args[0];
+    range->first = args[1];
+    range->count = args[2];
+
+    switch (range->section) {
+    case KB_CONF_SECTION_MAIN:
+        range->first = 0;
+        range->count = 1;
+        range->slave = false;
+        range->item_size = MAIN_ITEM_SIZE;
+        return 0;
+    case KB_CONF_SECTION_CALIB:
+    case KB_CONF_SECTION_KEYMAP:
+        range->slave = false;
+        key_count = CONFIG_KB_KEY_COUNT;
+        break;
+    case KB_CONF_SECTION_CALIB_SLAVE:
+    case KB_CONF_SECTION_KEYMAP_SLAVE:
+        range->slave = true;
+        key_count = KEY_COUNT_SLAVE;
+        break;
+#if CONFIG_KB_TRAVEL
+    case KB_CONF_SECTION_ACTUATION:
+        range->slave = false;
+        key_count = CONFIG_KB_KEY_COUNT;
+        break;
+#endif // CONFIG_KB_TRAVEL
+    default:
+        return -EINVAL;
+    }
+
+    switch (range->section) {
+    case KB_CONF_SECTION_CALIB:
+    case KB_CONF_SECTION_CALIB_SLAVE:
+        range->item_size = CALIB_ITEM_SIZE;
+        break;
+    case KB_CONF_SECTION_ACTUATION:
+        range->item_size = ACTUATION_ITEM_SIZE;
+        break;
+    default:
+        range->item_size = KEYMAP_ITEM_SIZE;
+        break;
+    }
+
+    size_t fits = ITEMS_SIZE / range->item_size;
+    if (range->count > fits) {
+        if (!clamp) {
+            return -EMSGSIZE;
+        }
+        range->count = fits;
+    }
+    if (range->count == 0 || range->first + range->count > key_count) {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static void calib_write_item(const kb_settings_key_calib_t *calib,
+                             uint8_t *item) {
+    sys_put_le16(calib->minimum, &item[0]);
+    sys_put_le16(calib->maximum, &item[2]);
+    sys_put_le16(calib->threshold, &item[4]);
+}
+
+static void keymap_write_item(const kb_key_rules_t *rules, uint8_t *item) {
+    memset(item, 0, KEYMAP_ITEM_SIZE);
+    item[0] = rules->count;
+    for (uint8_t r = 0; r < rules->count; ++r) {
+        sys_put_le16(rules->rules[r].layer_eq, &item[1 + r * RULE_SIZE]);
+        item[3 + r * RULE_SIZE] = rules->rules[r].out_code;
+    }
+}
+
+static int cmd_info(const uint8_t *args, uint8_t *data) {
+    data[0] = KB_CONF_PROTO_VERSION;
+    data[1] = CONFIG_KB_KEY_COUNT;
+    data[2] = KEY_COUNT_SLAVE;
+    data[3] = CONFIG_KB_MAX_RULES_PER_KEY;
+    data[4] = kb_settings_profile_get();
+    sys_put_le32(kb_settings_generation(), &data[5]);
+    data[9] = KB_CONF_STREAM_KEYS_PER_REPORT;
+#if CONFIG_KB_TRAVEL
+    sys_put_le16(KB_TRAVEL_MAX, &data[10]);
+#else
+    sys_put_le16(0, &data[10]);
+#endif // CONFIG_KB_TRAVEL
+    return 12;
+}
+
+static int cmd_read(const uint8_t *args, uint8_t *data) {
+    struct range range;
+    int err = range_parse(args, &range, true);
+    if (err) {
+        return err;
+    }
+
+    const kb_settings_t *settings = kb_settings_get();
+    uint8_t *item = &data[RANGE_HEADER_SIZE];
+
+    data[0] = range.section;
+    data[1] = range.first;
+    data[2] = range.count;
+
+    for (uint8_t i = 0; i < range.count; ++i, item += range.item_size) {
+        size_t key = range.first + i;
+        switch (range.section) {
+        case KB_CONF_SECTION_MAIN:
+            item[0] = settings->main.mode;
+            sys_put_le16(settings->main.key_polling_rate, &item[1]);
+            break;
+        case KB_CONF_SECTION_CALIB:
+        case KB_CONF_SECTION_CALIB_SLAVE:
+            calib_write_item(
+                &SECTION_ARRAY(settings, range.slave, keys_calibration)[key],
+                item);
+            break;
+#if CONFIG_KB_TRAVEL
+        case KB_CONF_SECTION_ACTUATION:
+            sys_put_le16(
+                kb_travel_from_value(&settings->key_travel[key],
+                                     settings->keys_calibration[key].threshold),
+                item);
+            break;
+#endif // CONFIG_KB_TRAVEL
+        default:
+            keymap_write_item(
+                &SECTION_ARRAY(settings, range.slave, mappings)[key], item);
+            break;
+        }
+    }
+
+    kb_settings_put(settings);
+
+    return RANGE_HEADER_SIZE + range.count * range.item_size;
+}
+
+static int write_main(kb_settings_t *settings, const uint8_t *item) {
+    uint16_t polling_rate = sys_get_le16(&item[1]);
+    if (item[0] > KB_MODE_RACE || polling_rate == 0) {
+        return -EINVAL;
+    }
+
+    settings->main.mode = item[0];
+    settings->main.key_polling_rate = polling_rate;
+
+    return 0;
+}
+
+static int write_calib(kb_settings_t *settings, const struct range *range,
+                       size_t key, const uint8_t *item) {
+    kb_settings_key_calib_t calib = {
+        .minimum = sys_get_le16(&item[0]),
+        .maximum = sys_get_le16(&item[2]),
+        .threshold = sys_get_le16(&item[4]),
+    };
+    if (calib.minimum >= calib.maximum || calib.threshold < calib.minimum ||
+        calib.threshold > calib.maximum) {
+        return -EINVAL;
+    }
+
+    SECTION_ARRAY(settings, range->slave, keys_calibration)[key] = calib;
+    kb_settings_edit_mark_key(settings, key, range->slave,
+                              range->slave ? KB_SETTINGS_PART_CALIB_SLAVE
+                                           : KB_SETTINGS_PART_CALIB);
+
+    return 0;
+}
+
+#if CONFIG_KB_TRAVEL
+
+static int write_actuation(kb_settings_t *settings, size_t key,
+                           const uint8_t *item) {
+    uint16_t actuation = sys_get_le16(item);
+    kb_settings_key_calib_t *calib = &settings->keys_calibration[key];
+    if (actuation == 0 || actuation > KB_TRAVEL_MAX ||
+        calib->minimum >= calib->maximum) {
+        return -EINVAL;
+    }
+
+    calib->threshold =
+        kb_travel_to_value(calib->minimum, calib->maximum, actuation);
+    kb_settings_edit_mark_key(settings, key, false, KB_SETTINGS_PART_CALIB);
+
+    return 0;
+}
+
+#endif // CONFIG_KB_TRAVEL
+
+static int write_keymap(kb_settings_t *settings, const struct range *range,
+                        size_t key, const uint8_t *item) {
+    kb_map_rule_t rules[CONFIG_KB_MAX_RULES_PER_KEY];
+    uint8_t count = item[0];
+
+    if (count > CONFIG_KB_MAX_RULES_PER_KEY) {
+        return -EINVAL;
+    }
+    for (uint8_t r = 0; r < count; ++r) {
+        rules[r] = RULE(sys_get_le16(&item[1 + r * RULE_SIZE]),
+                        item[3 + r * RULE_SIZE]);
+    }
+
+    return kb_settings_edit_set_rules(settings, key, range->slave, rules,
+                                      count);
+}
+
+static int cmd_write(const uint8_t *args, uint8_t *data) {
+    struct range range;
+    int err = range_parse(args, &range, false);
+    if (err) {
+        return err;
+    }
+
+    kb_settings_t *settings = kb_settings_edit_begin();
+    if (!settings) {
+        return -EBUSY;
+    }
+
+    const uint8_t *item = &args[RANGE_HEADER_SIZE];
+    uint32_t parts = 0;
+
+    for (uint8_t i = 0; i < range.count && !err; ++i) {
+        size_t key = range.first + i;
+        switch (range.section) {
+        case KB_CONF_SECTION_MAIN:
+            err = write_main(settings, item);
+            parts = KB_SETTINGS_PART_MAIN;
+            break;
+        case KB_CONF_SECTION_CALIB:
+        case KB_CONF_SECTION_CALIB_SLAVE:
+            err = write_calib(settings, &range, key, item);
+            break;
+#if CONFIG_KB_TRAVEL
+        case KB_CONF_SECTION_ACTUATION:
+            err = write_actuation(settings, key, item);
+            break;
+#endif // CONFIG_KB_TRAVEL
+        default:
+            err = write_keymap(settings, &range, key, item);
+            break;
+        }
+        item += range.item_size;
+    }
+
+    if (err) {
+        kb_settings_edit_abort(settings);
+        return err;
+    }
+
+    kb_settings_edit_commit(settings, parts);
+
+    data[0] = range.count;
+    return 1;
+}
+
+// Take current values as released values, keeping the actuation point of
+// the thresholds
+static int calibrate_rest(uint8_t *data) {
+    uint16_t values[CONFIG_KB_KEY_COUNT];
+
+    k_spinlock_key_t key = k_spin_lock(&values_lock);
+    bool valid = last_values_valid;
+    memcpy(values, last_values, sizeof(values));
+    k_spin_unlock(&values_lock, key);
+
+    if (!valid) {
+        return -EAGAIN;
+    }
+
+    kb_settings_t *settings = kb_settings_edit_begin();
+    if (!settings) {
+        return -EBUSY;
+    }
+
+    uint8_t calibrated = 0;
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
+        kb_settings_key_calib_t *calib = &settings->keys_calibration[i];
+        if (calib->minimum >= calib->maximum) {
+            continue;
+        }
+        // A key past its actuation point is not at rest
+        if (values[i] >= calib->threshold) {
+            LOG_WRN("Key %u is pressed, not calibrated", (unsigned)i);
+            continue;
+        }
+
+        calib->threshold = kb_settings_calib_rescale_threshold(
+            calib, values[i], calib->maximum);
+        calib->minimum = values[i];
+
+        kb_settings_edit_mark_key(settings, i, false, KB_SETTINGS_PART_CALIB);
+        calibrated++;
+    }
+
+    kb_settings_edit_commit(settings, 0);
+
+    data[0] = calibrated;
+    return 1;
+}
+
+#if CONFIG_KB_CALIBRATION
+
+static int calibrate_mode(uint8_t op, uint8_t *data) {
+    int ret = 0;
+    switch (op) {
+    case KB_CONF_CALIBRATE_START:
+        ret = kb_calibration_start();
+        break;
+    case KB_CONF_CALIBRATE_FINISH:
+        ret = kb_calibration_finish();
+        break;
+    case KB_CONF_CALIBRATE_ABORT:
+        kb_calibration_abort();
+        break;
+    default:
+        break;
+    }
+    if (ret) {
+        return ret;
+    }
+
+    data[0] = kb_calibration_get_state();
+    data[1] = kb_calibration_get_last_count();
+    return 2;
+}
+
+#endif // CONFIG_KB_CALIBRATION
+
+static int cmd_calibrate(const uint8_t *args, uint8_t *data) {
+    switch (args[0]) {
+    case KB_CONF_CALIBRATE_REST:
+        return calibrate_rest(data);
+#if CONFIG_KB_CALIBRATION
+    case KB_CONF_CALIBRATE_START:
+    case KB_CONF_CALIBRATE_FINISH:
+    case KB_CONF_CALIBRATE_ABORT:
+    case KB_CONF_CALIBRATE_STATUS:
+        return calibrate_mode(args[0], data);
+#endif // CONFIG_KB_CALIBRATION
+    default:
+        return -ENOTSUP;
+    }
+}
+
+static int cmd_stream(const uint8_t *args, uint8_t *data) {
+    // The IN endpoint carries a single report per frame
+    uint8_t interval = args[0] ? MAX(args[0], STREAM_REPORTS_PER_FRAME) : 0;
+
+    atomic_set(&stream_interval, interval);
+    LOG_INF("Streaming %s (every %u scans)", interval ? "on" : "off",
+            interval);
+
+    data[0] = interval;
+    data[1] = STREAM_REPORTS_PER_FRAME;
+    return 2;
+}
+
+static void kb_configurator_handle(const uint8_t *cmd) {
+    uint8_t resp[PAYLOAD_SIZE] = {cmd[0], cmd[1]};
+    const uint8_t *args = &cmd[CMD_HEADER_SIZE];
+    uint8_t *data = &resp[RESP_HEADER_SIZE];
+    int ret;
+
+    switch (cmd[0]) {
+    case KB_CONF_CMD_INFO:
+        ret = cmd_info(args, data);
+        break;
+    case KB_CONF_CMD_READ:
+        ret = cmd_read(args, data);
+        break;
+    case KB_CONF_CMD_WRITE:
+        ret = cmd_write(args, data);
+        break;
+    case KB_CONF_CMD_CALIBRATE:
+        ret = cmd_calibrate(args, data);
+        break;
+    case KB_CONF_CMD_STREAM:
+        ret = cmd_stream(args, data);
+        break;
+    default:
+        ret = -ENOTSUP;
+        break;
+    }
+
+    if (ret < 0) {
+        LOG_WRN("Command 0x%02x failed (err %d)", cmd[0], ret);
+        resp[2] = (uint8_t)(int8_t)ret;
+    }
+
+    // Streaming may keep the queue full for a moment
+    for (int i = 0; i < RESPONSE_RETRIES; ++i) {
+        ret = usb_connect_vendor_send(USB_CONNECT_VENDOR_REPORT_RESPONSE, resp,
+                                      sizeof(resp));
+        if (ret != -EAGAIN) {
+            break;
+        }
+        k_msleep(1);
+    }
+    if (ret) {
+        LOG_ERR("Unable to send response (err %d)", ret);
+    }
+}
+
+static void cmd_work_handler(struct k_work *work) {
+    uint8_t cmd[PAYLOAD_SIZE];
+    while (!k_msgq_get(&cmd_queue, cmd, K_NO_WAIT)) {
+        kb_configurator_handle(cmd);
+    }
+}
+
+static K_WORK_DEFINE(cmd_work, cmd_work_handler);
+
+static void kb_configurator_on_command(const uint8_t *buf, uint16_t len) {
+    uint8_t cmd[PAYLOAD_SIZE] = {0};
+    memcpy(cmd, buf, MIN(len, sizeof(cmd)));
+
+    if (k_msgq_put(&cmd_queue, cmd, K_NO_WAIT)) {
+        LOG_WRN("Command queue full, command 0x%02x dropped", cmd[0]);
+        return;
+    }
+    k_work_submit(&cmd_work);
+}
+
+static void kb_configurator_stream(const uint16_t *values) {
+    uint8_t report[PAYLOAD_SIZE];
+
+    sys_put_le16(stream_seq++, &report[0]);
+    sys_put_le32((uint32_t)k_ticks_to_us_floor64(k_uptime_ticks()),
+                 &report[2]);
+
+    for (size_t first = 0; first < CONFIG_KB_KEY_COUNT;
+         first += KB_CONF_STREAM_KEYS_PER_REPORT) {
+        size_t count =
+            MIN(CONFIG_KB_KEY_COUNT - first, KB_CONF_STREAM_KEYS_PER_REPORT);
+        report[6] = first;
+        report[7] = count;
+        for (size_t i = 0; i < count; ++i) {
+            sys_put_le16(values[first + i],
+                         &report[KB_CONF_STREAM_HEADER_SIZE + 2 * i]);
+        }
+        if (usb_connect_vendor_send(USB_CONNECT_VENDOR_REPORT_STREAM, report,
+                                    KB_CONF_STREAM_HEADER_SIZE + 2 * count)) {
+            // Host is not keeping up, drop the rest of the frame
+            return;
+        }
+    }
+}
+
+void kb_configurator_on_scan(const uint16_t *values) {
+    k_spinlock_key_t key = k_spin_lock(&values_lock);
+    memcpy(last_values, values, sizeof(last_values));
+    last_values_valid = true;
+    k_spin_unlock(&values_lock, key);
+
+    uint8_t interval = atomic_get(&stream_interval);
+    if (!interval) {
+        stream_scans = 0;
+        return;
+    }
+    if (++stream_scans < interval) {
+        return;
+    }
+    stream_scans = 0;
+
+    kb_configurator_stream(values);
+}
+
+int kb_configurator_init() {
+    return usb_connect_vendor_set_output_cb(USB_CONNECT_VENDOR_REPORT_COMMAND,
+                                            kb_configurator_on_command);
+}
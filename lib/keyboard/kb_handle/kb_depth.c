@@ -0,0 +1,50 @@
+#include <lib/keyboard/kb_depth.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/barrier.h>
+
+#include <errno.h>
+#include <string.h>
+
+// Amount of attempts to read a consistent snapshot before giving up
+#define KB_DEPTH_READ_RETRIES 4
+
+// Sequence counter, odd while the scan loop is writing 'depths'
+static atomic_t seq = ATOMIC_INIT(0);
+
+static uint8_t key_depths[CONFIG_KB_KEY_COUNT];
+
+void kb_depth_publish(const kb_settings_t *settings, const uint16_t *values) {
+    atomic_inc(&seq);
+    barrier_dmem_fence_full();
+
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
+        key_depths[i] = kb_depth_of_key(settings, i, values[i]);
+    }
+
+    barrier_dmem_fence_full();
+    atomic_inc(&seq);
+}
+
+int kb_depth_snapshot(uint8_t depths[CONFIG_KB_KEY_COUNT]) {
+    for (int i = 0; i < KB_DEPTH_READ_RETRIES; ++i) {
+        atomic_val_t start = atomic_get(&seq);
+        if (start & 1) {
+            // Writer is in the middle of publishing, it is likely preempted
+            // by us, let it finish
+            k_yield();
+            continue;
+        }
+
+        barrier_dmem_fence_full();
+        memcpy(depths, key_depths, sizeof(key_depths));
+        barrier_dmem_fence_full();
+
+        if (atomic_get(&seq) == start) {
+            return 0;
+        }
+    }
+
+    return -EAGAIN;
+}
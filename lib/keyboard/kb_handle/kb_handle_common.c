@@ -1,9 +1,18 @@
 #include "kb_handle_common.h"
 
+#include <lib/connect/bt_connect.h>
+#include <lib/keyboard/kb_autocal.h>
+#include <lib/keyboard/kb_calibration.h>
+#include <lib/keyboard/kb_configurator.h>
+#include <lib/keyboard/kb_depth.h>
 #include <lib/keyboard/kb_fn_keystroke.h>
 #include <lib/keyboard/kb_handle.h>
 #include <lib/keyboard/kb_keys.h>
+#include <lib/keyboard/kb_latency.h>
 #include <lib/keyboard/kb_settings.h>
+#include <lib/keyboard/kb_stats.h>
+#include <lib/keyboard/kb_trace.h>
+#include <lib/led/kb_backlight.h>
 
 #include <drivers/kscan.h>
 
@@ -17,23 +26,23 @@ LOG_MODULE_REGISTER(kb_handle, CONFIG_KB_HANDLE_LOG_LEVEL);
 
 static inline void for_each_set_bit(uint32_t word, uint16_t base,
                                     key_state_changed_cb cb,
-                                    kb_settings_t *settings) {
+                                    const kb_settings_t *settings,
+                                    uint8_t latency_flags) {
     while (word) {
         uint32_t b = __builtin_ctz(word);
+        kb_latency_mark(KB_LATENCY_EDGE, base + b, latency_flags);
         cb((uint8_t)(base + b), settings);
         word &= word - 1;
     }
 }
 
-static inline uint8_t key_percentage(kb_settings_t *settings, uint16_t *values,
-                                     uint8_t key_index) {
-    kb_settings_key_calib_t calib = settings->keys_calibration[key_index];
-    double percentage = (double)(values[key_index] - calib.minimum) /
-                        (calib.maximum - calib.minimum) * 100;
-    return (uint8_t)percentage;
+static inline uint8_t key_percentage(const kb_settings_t *settings,
+                                     uint16_t *values, uint8_t key_index) {
+    uint8_t depth = kb_depth_of_key(settings, key_index, values[key_index]);
+    return (uint8_t)((depth * 100u) / KB_DEPTH_MAX);
 }
 
-void edge_detection(kb_settings_t *settings, uint32_t *prev_down,
+void edge_detection(const kb_settings_t *settings, uint32_t *prev_down,
                     uint32_t *curr_down, size_t bm_size,
                     key_state_changed_cb on_press,
                     key_state_changed_cb on_release) {
@@ -41,18 +50,14 @@ void edge_detection(kb_settings_t *settings, uint32_t *prev_down,
         uint32_t base = (uint32_t)(w * KB_WORD_BITS);
         uint32_t presses = curr_down[w] & ~prev_down[w];
         uint32_t releases = prev_down[w] & ~curr_down[w];
-        for_each_set_bit(presses, base, on_press, settings);
-        for_each_set_bit(releases, base, on_release, settings);
+        for_each_set_bit(presses, base, on_press, settings,
+                         KB_LATENCY_FLAG_PRESS);
+        for_each_set_bit(releases, base, on_release, settings, 0);
     }
     memcpy(prev_down, curr_down, bm_size);
 }
 
-static uint16_t key_thresholds[CONFIG_KB_KEY_COUNT] = {0};
-
-static void on_settings_update(kb_settings_t *settings) {
-    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
-        key_thresholds[i] = settings->keys_calibration[i].threshold;
-    }
+static void on_settings_update(const kb_settings_t *settings) {
 #if CONFIG_BT_INTER_KB_COMM_MASTER
     bt_connect_send_master_kb_settings();
 #endif // CONFIG_BT_INTER_KB_COMM_MASTER
@@ -60,8 +65,9 @@ static void on_settings_update(kb_settings_t *settings) {
 
 static int64_t last_update_time = 0;
 
-bool get_kscan_bitmap(kb_settings_t *settings, const struct device *const kscan,
-                      uint16_t *values, uint32_t *curr_down) {
+bool get_kscan_bitmap(const kb_settings_t *settings,
+                      const struct device *const kscan, uint16_t *values,
+                      uint32_t *curr_down) {
 
     int64_t uptime = k_uptime_get();
     int64_t delta = uptime - last_update_time;
@@ -71,9 +77,17 @@ bool get_kscan_bitmap(kb_settings_t *settings, const struct device *const kscan,
     last_update_time = uptime;
     memset(curr_down, 0, KB_BITMAP_BYTECNT);
 
+    const uint16_t *thresholds = kb_autocal_thresholds(settings);
+
+    kb_latency_sample();
+    kb_stats_scan_begin();
+
+    // Race poll found no key above its threshold
+    bool race_none = false;
+
     switch (settings->main.mode) {
     case KB_MODE_NORMAL: {
-        int res = kscan_poll_normal(kscan, curr_down, key_thresholds, values);
+        int res = kscan_poll_normal(kscan, curr_down, thresholds, values);
         if (res < 0) {
             LOG_ERR("Unable to poll normal (err %d)", res);
             return false;
@@ -81,9 +95,12 @@ bool get_kscan_bitmap(kb_settings_t *settings, const struct device *const kscan,
         break;
     }
     case KB_MODE_RACE: {
-        int res = kscan_poll_race(kscan, curr_down, key_thresholds, values);
-        if (res == -1)
-            return false;
+        int res = kscan_poll_race(kscan, curr_down, thresholds, values);
+        if (res == -1) {
+            // Values are still fresh, released keys need their depths
+            race_none = true;
+            break;
+        }
         if (res < -1) {
             LOG_ERR("Unable to poll race (err %d)", res);
             return false;
@@ -92,7 +109,23 @@ bool get_kscan_bitmap(kb_settings_t *settings, const struct device *const kscan,
     }
     }
 
-    return true;
+#if CONFIG_KB_TRACE_RECORD
+    kb_trace_record(values);
+#endif // CONFIG_KB_TRACE_RECORD
+
+    kb_configurator_on_scan(values);
+
+    // Let the backlight and others follow key depths between edges
+    kb_depth_publish(settings, values);
+
+    // No key events while calibrating
+    if (kb_calibration_on_scan(values)) {
+        return false;
+    }
+
+    kb_autocal_on_scan(settings, values, curr_down);
+
+    return !race_none;
 }
 
 static uint8_t fn_buff[CONFIG_KB_FN_KEYSTROKE_MAX_KEYS] = {0};
@@ -166,7 +199,7 @@ static void remove_normal_key(uint8_t key_index) {
 void on_press_default(press_ctx_t *ctx) {
 
     uint8_t idx = ctx->index;
-    kb_key_rules_t *rules = &ctx->mappings[idx];
+    const kb_key_rules_t *rules = &ctx->mappings[idx];
 
 #if CONFIG_BT_INTER_KB_COMM_MASTER
     if ((IS_ENABLED(CONFIG_BT_CONNECT_MASTER_LEFT) && ctx->is_slave) ||
@@ -181,6 +214,8 @@ void on_press_default(press_ctx_t *ctx) {
         return;
     }
 
+    kb_latency_mark(KB_LATENCY_KEYMAP, idx, KB_LATENCY_FLAG_PRESS);
+
     LOG_DBG("Key %d HID 0x%X pressed", idx, code);
 
     if (code < KEY_FN) {
@@ -207,7 +242,7 @@ void on_press_default(press_ctx_t *ctx) {
 void on_release_default(press_ctx_t *ctx) {
 
     uint8_t idx = ctx->index;
-    kb_key_rules_t *rules = &ctx->mappings[idx];
+    const kb_key_rules_t *rules = &ctx->mappings[idx];
 
 #if CONFIG_BT_INTER_KB_COMM_MASTER
     if ((IS_ENABLED(CONFIG_BT_CONNECT_MASTER_LEFT) && ctx->is_slave) ||
@@ -222,6 +257,8 @@ void on_release_default(press_ctx_t *ctx) {
         return;
     }
 
+    kb_latency_mark(KB_LATENCY_KEYMAP, idx, 0);
+
     LOG_DBG("Key %d HID 0x%X released", idx, code);
 
     if (code < KEY_FN) {
@@ -241,14 +278,20 @@ void on_release_default(press_ctx_t *ctx) {
     }
 }
 
-void handle_bl_on_event(uint8_t key_index, kb_settings_t *settings,
+void handle_bl_on_event(uint8_t key_index, const kb_settings_t *settings,
                         bool pressed, uint16_t *values) {
-#if CONFIG_KB_BACKLIGHT
+#if CONFIG_KB_BACKLIGHT || CONFIG_BT_INTER_KB_COMM_BL_EVENTS
     kb_key_t key = {
         .index = key_index,
         .pressed = pressed,
         .value = key_percentage(settings, values, key_index),
     };
+#endif // CONFIG_KB_BACKLIGHT || CONFIG_BT_INTER_KB_COMM_BL_EVENTS
+#if CONFIG_BT_INTER_KB_COMM_BL_EVENTS
+    // The other half animates with our keys too
+    bt_connect_send_bl_event(&key);
+#endif // CONFIG_BT_INTER_KB_COMM_BL_EVENTS
+#if CONFIG_KB_BACKLIGHT
     kb_backlight_on_event(&key);
 #endif // CONFIG_KB_BACKLIGHT
 }
@@ -274,27 +317,39 @@ void handle_hid_report() {
         }
     }
 
+    kb_latency_mark(KB_LATENCY_REPORT_BUILD, KB_LATENCY_KEY_NONE, 0);
+
+#if CONFIG_KB_TRACE_REPLAY
+    kb_trace_replay_on_report(report, sizeof(report));
+#endif // CONFIG_KB_TRACE_REPLAY
+
 #if CONFIG_KB_HANDLE_REPORT_PRIO_USB
     if (usb_connect_is_ready()) {
         usb_connect_handle_wakeup();
+        kb_latency_mark(KB_LATENCY_REPORT_SUBMIT, KB_LATENCY_KEY_NONE, 0);
         usb_connect_send(report);
     } else if (bt_connect_is_ready()) {
+        kb_latency_mark(KB_LATENCY_REPORT_SUBMIT, KB_LATENCY_KEY_NONE, 0);
         bt_connect_send(report, report_size);
     }
 #elif CONFIG_KB_HANDLE_REPORT_PRIO_BT
     if (bt_connect_is_ready()) {
+        kb_latency_mark(KB_LATENCY_REPORT_SUBMIT, KB_LATENCY_KEY_NONE, 0);
         bt_connect_send(report, report_size);
     } else if (usb_connect_is_ready()) {
         usb_connect_handle_wakeup();
+        kb_latency_mark(KB_LATENCY_REPORT_SUBMIT, KB_LATENCY_KEY_NONE, 0);
         usb_connect_send(report);
     }
 #elif CONFIG_LIB_BT_CONNECT
     if (bt_connect_is_ready()) {
+        kb_latency_mark(KB_LATENCY_REPORT_SUBMIT, KB_LATENCY_KEY_NONE, 0);
         bt_connect_send(report, report_size);
     }
 #elif CONFIG_LIB_USB_CONNECT
     if (usb_connect_is_ready()) {
         usb_connect_handle_wakeup();
+        kb_latency_mark(KB_LATENCY_REPORT_SUBMIT, KB_LATENCY_KEY_NONE, 0);
         usb_connect_send(report);
     }
 #endif // CONFIG_KB_HANDLE_REPORT_PRIO_USB
@@ -304,5 +359,9 @@ int kb_handle_init() {
 
     kb_settings_set_on_update(on_settings_update);
 
+#if CONFIG_BT_INTER_KB_COMM_MASTER && CONFIG_KB_BACKLIGHT
+    kb_backlight_set_on_update(bt_connect_send_master_bl_state);
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER && CONFIG_KB_BACKLIGHT
+
     return 0;
 }
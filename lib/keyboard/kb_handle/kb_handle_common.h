@@ -11,31 +11,30 @@
 // Fill out current ADC values in 'values'
 //
 // Returns false if key polling rate did not pass yet or on error
-bool get_kscan_bitmap(kb_settings_t *settings, const struct device *const kscan,
-                      uint16_t *values, uint32_t *curr_down);
+bool get_kscan_bitmap(const kb_settings_t *settings,
+                      const struct device *const kscan, uint16_t *values,
+                      uint32_t *curr_down);
 
 // Invoke 'on_event' for current backlight mode if possible
-void handle_bl_on_event(uint8_t key_index, kb_settings_t *settings,
+void handle_bl_on_event(uint8_t key_index, const kb_settings_t *settings,
                         bool pressed, uint16_t *values);
 
-// Clear out the HID report with zeros
-void clear_hid_report();
-
 // Send HID report where possible
 void handle_hid_report();
 
 // Callback type for on_press/on_release
-typedef void (*key_state_changed_cb)(uint8_t idx, kb_settings_t *settings);
+typedef void (*key_state_changed_cb)(uint8_t idx,
+                                    const kb_settings_t *settings);
 
 // Go through the bitmap and invoke on_press/on_release callbacks
-void edge_detection(kb_settings_t *settings, uint32_t *prev_down,
+void edge_detection(const kb_settings_t *settings, uint32_t *prev_down,
                     uint32_t *curr_down, size_t bm_size,
                     key_state_changed_cb on_press,
                     key_state_changed_cb on_release);
 
 typedef struct {
-    kb_key_rules_t *mappings;
-    kb_settings_t *settings;
+    const kb_key_rules_t *mappings;
+    const kb_settings_t *settings;
     uint8_t index;
     bool is_slave;
 } press_ctx_t;
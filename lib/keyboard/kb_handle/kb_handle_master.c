@@ -5,6 +5,7 @@
 
 #include <lib/connect/bt_connect.h>
 #include <lib/keyboard/kb_settings.h>
+#include <lib/keyboard/kb_stats.h>
 
 #include <zephyr/device.h>
 #include <zephyr/kernel.h>
@@ -38,7 +39,7 @@ static uint32_t prev_down_slave[KB_BITMAP_WORDS_SLAVE] = {0};
 #include YKB_DEF_MAPPINGS_PATH
 
 // Runs on every master key just pressed once
-void on_press_master(uint8_t key_index, kb_settings_t *settings) {
+void on_press_master(uint8_t key_index, const kb_settings_t *settings) {
     // Handle backlight 'on_event' if present
     handle_bl_on_event(key_index, settings, true, values);
 
@@ -53,7 +54,7 @@ void on_press_master(uint8_t key_index, kb_settings_t *settings) {
 }
 
 // Runs on every master key just release once
-void on_release_master(uint8_t key_index, kb_settings_t *settings) {
+void on_release_master(uint8_t key_index, const kb_settings_t *settings) {
     // Same logic as in on_press_master above
     handle_bl_on_event(key_index, settings, false, values);
     press_ctx_t ctx = {
@@ -66,7 +67,7 @@ void on_release_master(uint8_t key_index, kb_settings_t *settings) {
 }
 
 // Runs on every slave key just pressed once
-void on_press_slave(uint8_t key_index, kb_settings_t *settings) {
+void on_press_slave(uint8_t key_index, const kb_settings_t *settings) {
 
     // Backlight 'on_event' is handled on the slave directly
 
@@ -81,7 +82,7 @@ void on_press_slave(uint8_t key_index, kb_settings_t *settings) {
 }
 
 // Runs on every slave key just released once
-void on_release_slave(uint8_t key_index, kb_settings_t *settings) {
+void on_release_slave(uint8_t key_index, const kb_settings_t *settings) {
     // Same logic as in on_press_slave above
     press_ctx_t ctx = {
         .mappings = settings->mappings_slave,
@@ -94,7 +95,7 @@ void on_release_slave(uint8_t key_index, kb_settings_t *settings) {
 
 void kb_handle() {
 
-    kb_settings_t *settings = kb_settings_get();
+    const kb_settings_t *settings = kb_settings_acquire();
 
     // Fill out master curr_down and values
     if (!get_kscan_bitmap(settings, kscan, values, curr_down)) {
@@ -121,4 +122,6 @@ void kb_handle() {
 
     // Send HID report if possible BT/USB
     handle_hid_report();
+
+    kb_stats_scan_end();
 }
@@ -11,6 +11,7 @@
 
 #include <lib/keyboard/kb_keys.h>
 #include <lib/keyboard/kb_settings.h>
+#include <lib/keyboard/kb_stats.h>
 
 // Include FN keystrokes
 #include YKB_FN_KEYSTROKES_PATH
@@ -30,7 +31,7 @@ static uint16_t values[CONFIG_KB_KEY_COUNT] = {0};
 static bool change = false;
 
 // Runs on every key just pressed once
-static void on_press(uint8_t key_index, kb_settings_t *settings) {
+static void on_press(uint8_t key_index, const kb_settings_t *settings) {
     // Handle backlight 'on_event' if present
     handle_bl_on_event(key_index, settings, true, values);
 
@@ -46,7 +47,7 @@ static void on_press(uint8_t key_index, kb_settings_t *settings) {
 }
 
 // Runs on every key just release once
-static void on_release(uint8_t key_index, kb_settings_t *settings) {
+static void on_release(uint8_t key_index, const kb_settings_t *settings) {
     // Same logic as in on_press above
     handle_bl_on_event(key_index, settings, false, values);
     press_ctx_t ctx = {
@@ -60,7 +61,7 @@ static void on_release(uint8_t key_index, kb_settings_t *settings) {
 }
 
 void kb_handle() {
-    kb_settings_t *settings = kb_settings_get();
+    const kb_settings_t *settings = kb_settings_acquire();
 
     // Fill out curr_down and values
     if (!get_kscan_bitmap(settings, kscan, values, curr_down)) {
@@ -71,12 +72,11 @@ void kb_handle() {
     edge_detection(settings, prev_down, curr_down, KB_BITMAP_BYTECNT, on_press,
                    on_release);
 
-    // Clear HID report buffer from the previous iteration
-    clear_hid_report();
-
     // Send HID report if possible BT/USB
     if (change) {
         handle_hid_report();
         change = false;
     }
+
+    kb_stats_scan_end();
 }
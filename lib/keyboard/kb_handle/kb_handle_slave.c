@@ -3,6 +3,7 @@
 
 #include <lib/connect/bt_connect.h>
 #include <lib/keyboard/kb_settings.h>
+#include <lib/keyboard/kb_stats.h>
 
 #include <zephyr/device.h>
 #include <zephyr/kernel.h>
@@ -29,7 +30,7 @@ static uint32_t prev_down[KB_BITMAP_WORDS] = {0};
 static bool change = false;
 
 // Runs on every key just pressed once
-static void on_press_slave(uint8_t key_index, kb_settings_t *settings) {
+static void on_press_slave(uint8_t key_index, const kb_settings_t *settings) {
 
     change = true;
 
@@ -50,7 +51,7 @@ static void on_press_slave(uint8_t key_index, kb_settings_t *settings) {
 }
 
 // Runs on every key just released once
-static void on_release_slave(uint8_t key_index, kb_settings_t *settings) {
+static void on_release_slave(uint8_t key_index, const kb_settings_t *settings) {
 
     change = true;
 
@@ -68,7 +69,7 @@ static void on_release_slave(uint8_t key_index, kb_settings_t *settings) {
 
 void kb_handle() {
 
-    kb_settings_t *settings = kb_settings_get();
+    const kb_settings_t *settings = kb_settings_acquire();
 
     // Fill out curr_down and values
     if (!get_kscan_bitmap(settings, kscan, values, curr_down)) {
@@ -86,6 +87,8 @@ void kb_handle() {
         change = false;
     }
 
+    kb_stats_scan_end();
+
     // It doesn't really make sense to
     // do anything else with them here
     // since master should handle everything
@@ -0,0 +1,149 @@
+#include <lib/keyboard/kb_latency.h>
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(kb_latency, CONFIG_KB_LATENCY_LOG_LEVEL);
+
+#define RING_SIZE CONFIG_KB_LATENCY_RING_SIZE
+
+BUILD_ASSERT(IS_POWER_OF_TWO(RING_SIZE),
+             "CONFIG_KB_LATENCY_RING_SIZE must be a power of two");
+
+#define DUMP_POLL_MS 100
+
+static const struct device *uart = DEVICE_DT_GET(DT_CHOSEN(ykb_latency));
+
+static struct kb_latency_entry ring[RING_SIZE];
+// Total amount of entries ever stored, the ring holds the last RING_SIZE
+static uint32_t head = 0;
+
+// Set while the ring is being dumped, trace points are dropped meanwhile
+static bool paused = false;
+
+static struct k_spinlock lock;
+
+static uint32_t sample_cycles;
+static uint8_t sample_seq = 0;
+static bool sample_pending = false;
+
+static inline void ring_push(uint32_t cycles, uint8_t stage, uint8_t key,
+                             uint8_t flags) {
+    struct kb_latency_entry *entry = &ring[head & (RING_SIZE - 1)];
+    entry->cycles = cycles;
+    entry->stage = stage;
+    entry->key = key;
+    entry->flags = flags;
+    entry->seq = sample_seq;
+    head++;
+}
+
+void kb_latency_sample() {
+    sample_cycles = k_cycle_get_32();
+    sample_seq++;
+    sample_pending = true;
+}
+
+void kb_latency_mark(enum kb_latency_stage stage, uint8_t key, uint8_t flags) {
+    uint32_t now = k_cycle_get_32();
+
+    k_spinlock_key_t lock_key = k_spin_lock(&lock);
+    // Reports sent without a key event in the same poll are not traced
+    if (sample_pending && stage >= KB_LATENCY_REPORT_BUILD) {
+        k_spin_unlock(&lock, lock_key);
+        return;
+    }
+    if (!paused) {
+        if (sample_pending) {
+            ring_push(sample_cycles, KB_LATENCY_SAMPLE, KB_LATENCY_KEY_NONE,
+                      0);
+            sample_pending = false;
+        }
+        ring_push(now, stage, key, flags);
+    }
+    k_spin_unlock(&lock, lock_key);
+}
+
+static void uart_write(const void *data, size_t len) {
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < len; ++i) {
+        uart_poll_out(uart, bytes[i]);
+    }
+}
+
+static void kb_latency_dump() {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    paused = true;
+    uint32_t end = head;
+    k_spin_unlock(&lock, key);
+
+    uint32_t count = MIN(end, RING_SIZE);
+
+    uint8_t header[16];
+    memcpy(header, KB_LATENCY_MAGIC, 4);
+    header[4] = KB_LATENCY_VERSION;
+    header[5] = KB_LATENCY_STAGE_COUNT;
+    sys_put_le16(sizeof(struct kb_latency_entry), &header[6]);
+    sys_put_le32(sys_clock_hw_cycles_per_sec(), &header[8]);
+    sys_put_le32(count, &header[12]);
+    uart_write(header, sizeof(header));
+
+    // Ring is not written while paused, so it can be sent directly
+    for (uint32_t i = end - count; i != end; ++i) {
+        struct kb_latency_entry entry = ring[i & (RING_SIZE - 1)];
+        entry.cycles = sys_cpu_to_le32(entry.cycles);
+        uart_write(&entry, sizeof(entry));
+    }
+
+    key = k_spin_lock(&lock);
+    paused = false;
+    k_spin_unlock(&lock, key);
+
+    LOG_INF("Dumped %u latency trace entries", count);
+}
+
+static void kb_latency_dump_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(dump_work, kb_latency_dump_work_handler);
+
+// Dump once every time the host opens the port (DTR rises), or
+// periodically if the UART has no DTR line
+static void kb_latency_dump_work_handler(struct k_work *work) {
+    static bool dtr_prev = false;
+    static int64_t last_dump = 0;
+
+    uint32_t dtr = 0;
+    int err = uart_line_ctrl_get(uart, UART_LINE_CTRL_DTR, &dtr);
+    if (err == -ENOSYS || err == -ENOTSUP) {
+        int64_t now = k_uptime_get();
+        if (now - last_dump >= CONFIG_KB_LATENCY_DUMP_INTERVAL_MS) {
+            last_dump = now;
+            kb_latency_dump();
+        }
+    } else if (!err) {
+        if (dtr && !dtr_prev) {
+            kb_latency_dump();
+        }
+        dtr_prev = dtr;
+    }
+
+    k_work_reschedule(&dump_work, K_MSEC(DUMP_POLL_MS));
+}
+
+int kb_latency_init() {
+    if (!device_is_ready(uart)) {
+        LOG_ERR("Latency dump UART is not ready");
+        return -ENODEV;
+    }
+
+    k_work_reschedule(&dump_work, K_MSEC(DUMP_POLL_MS));
+
+    return 0;
+}
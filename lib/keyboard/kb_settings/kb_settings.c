@@ -1,11 +1,18 @@
 #include <lib/keyboard/kb_settings.h>
+#include <lib/keyboard/kb_settings_migrate.h>
+#include <lib/keyboard/kb_settings_persist.h>
 
+#include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/settings/settings.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/printk.h>
 #include <zephyr/toolchain.h>
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 LOG_MODULE_REGISTER(kb_settings, CONFIG_KB_SETTINGS_LOG_LEVEL);
@@ -17,25 +24,163 @@ BUILD_ASSERT(CONFIG_KB_SETTINGS_DEFAULT_MINIMUM <
              "Default value for key not pressed should be less than default "
              "value for key pressed fully.");
 
-K_SEM_DEFINE(settings_sem, 0, 1);
-static kb_settings_t settings = {0};
-
 /*
  * Namespace: "kb"
- * Item key : "blob"
- * Full path: "kb/blob"
+ *
+ * Every part of a profile is stored as an independent record:
+ *
+ *  "<p>/main"       - kb_settings_main_t
+ *  "<p>/calib"      - keys calibration
+ *  "<p>/calib_s"    - slave keys calibration (split master only)
+ *  "<p>/km/<n>"     - keymap chunk <n>
+ *  "<p>/km_s/<n>"   - slave keymap chunk <n> (split master only)
+ *
+ * where <p> is "kb" for profile 0 and "kb/p<profile>" for the others.
+ *
+ * Each record starts with 'struct kb_settings_rec_hdr'.
+ *
+ * "kb/active" holds index of the active profile.
+ *
+ * "kb/blob" is the legacy monolithic image, it is converted into profile 0
+ * records by the boot time load and deleted afterwards.
  */
 #define KB_SETTINGS_NS "kb"
-#define KB_SETTINGS_ITEM "blob"
-#define KB_SETTINGS_KEY KB_SETTINGS_NS "/" KB_SETTINGS_ITEM
 
-static kb_ruleset_pod_t runtime_mappings[CONFIG_KB_KEY_COUNT] = {0};
+#define KB_SETTINGS_REC_MAIN "main"
+#define KB_SETTINGS_REC_CALIB "calib"
+#define KB_SETTINGS_REC_CALIB_SLAVE "calib_s"
+#define KB_SETTINGS_REC_KEYMAP "km"
+#define KB_SETTINGS_REC_KEYMAP_SLAVE "km_s"
+#define KB_SETTINGS_REC_ACTIVE "active"
+#define KB_SETTINGS_REC_LEGACY_BLOB "blob"
+
+// Prefix of profile subtrees, e.g. "kb/p1"
+#define KB_SETTINGS_PROFILE_PREFIX 'p'
+
+// Increment every time the corresponding record payload changes and register
+// a migration from the previous version with KB_SETTINGS_MIGRATION_DEFINE
+#define KB_SETTINGS_REC_MAIN_VERSION 1
+#define KB_SETTINGS_REC_CALIB_VERSION 1
+#define KB_SETTINGS_REC_KEYMAP_VERSION 1
+
+#define KB_SETTINGS_KEYMAP_CHUNKS                                              \
+    DIV_ROUND_UP(CONFIG_KB_KEY_COUNT, CONFIG_KB_SETTINGS_KEYMAP_CHUNK_KEYS)
 
 #if CONFIG_BT_INTER_KB_COMM_MASTER
-static kb_ruleset_pod_t runtime_mappings_slave[CONFIG_KB_KEY_COUNT_SLAVE] = {0};
+#define KB_SETTINGS_KEYMAP_CHUNKS_SLAVE                                        \
+    DIV_ROUND_UP(CONFIG_KB_KEY_COUNT_SLAVE,                                    \
+                 CONFIG_KB_SETTINGS_KEYMAP_CHUNK_KEYS)
+#define KB_SETTINGS_KEY_COUNT_MAX                                              \
+    MAX(CONFIG_KB_KEY_COUNT, CONFIG_KB_KEY_COUNT_SLAVE)
+#else
+#define KB_SETTINGS_KEYMAP_CHUNKS_SLAVE 0
+#define KB_SETTINGS_KEY_COUNT_MAX CONFIG_KB_KEY_COUNT
 #endif // CONFIG_BT_INTER_KB_COMM_MASTER
 
-static bool s_loaded_ok = false;
+// Record indexes used for dirty/loaded tracking
+enum {
+    KB_SETTINGS_REC_IDX_MAIN = 0,
+    KB_SETTINGS_REC_IDX_CALIB,
+    KB_SETTINGS_REC_IDX_CALIB_SLAVE,
+    KB_SETTINGS_REC_IDX_KEYMAP,
+    KB_SETTINGS_REC_IDX_KEYMAP_SLAVE =
+        KB_SETTINGS_REC_IDX_KEYMAP + KB_SETTINGS_KEYMAP_CHUNKS,
+    KB_SETTINGS_REC_COUNT =
+        KB_SETTINGS_REC_IDX_KEYMAP_SLAVE + KB_SETTINGS_KEYMAP_CHUNKS_SLAVE,
+};
+
+struct kb_settings_rec {
+    struct kb_settings_rec_hdr hdr;
+    union {
+        kb_settings_main_t main;
+        kb_settings_key_calib_t calib[KB_SETTINGS_KEY_COUNT_MAX];
+        kb_ruleset_pod_t keymap[CONFIG_KB_SETTINGS_KEYMAP_CHUNK_KEYS];
+    } payload;
+};
+
+// Stored records of an older version may be larger than the current layout,
+// they are read and upgraded in a buffer of at least this size
+#define KB_SETTINGS_REC_LOAD_SIZE                                              \
+    MAX(sizeof(struct kb_settings_rec), CONFIG_KB_SETTINGS_MIGRATION_BUF_SIZE)
+
+enum kb_settings_slot_state {
+    // Unused, can be allocated
+    KB_SETTINGS_SLOT_FREE = 0,
+    // Published snapshot used by everyone
+    KB_SETTINGS_SLOT_ACTIVE,
+    // Next profile loaded in advance
+    KB_SETTINGS_SLOT_PRELOAD,
+    // Being filled out by a writer, not visible to readers
+    KB_SETTINGS_SLOT_EDIT,
+    // Replaced snapshot, freed once the scan loop leaves it and it is stored
+    KB_SETTINGS_SLOT_RETIRED,
+};
+
+// RAM snapshot of a single profile
+struct kb_settings_slot {
+    kb_settings_t settings;
+
+    kb_ruleset_pod_t runtime_mappings[CONFIG_KB_KEY_COUNT];
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+    kb_ruleset_pod_t runtime_mappings_slave[CONFIG_KB_KEY_COUNT_SLAVE];
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+
+    // Records which need to be written to flash
+    ATOMIC_DEFINE(dirty, KB_SETTINGS_REC_COUNT);
+    // Records successfully loaded from flash
+    ATOMIC_DEFINE(loaded, KB_SETTINGS_REC_COUNT);
+
+    // Readers holding the snapshot, see 'kb_settings_get'
+    atomic_t readers;
+
+    enum kb_settings_slot_state state;
+};
+
+/*
+ * Published snapshots are never modified. Writers copy the active snapshot
+ * into a free slot, modify the copy and publish it with a new generation.
+ *
+ * The scan loop picks up the active snapshot once per scan with
+ * 'kb_settings_acquire', the snapshot it uses is not reused until it moves on
+ * to a newer one. This keeps the scan loop lock free. Other readers hold a
+ * reference with 'kb_settings_get' / 'kb_settings_put' instead.
+ *
+ * Everything else (writers, profile loading, picking records to store) is
+ * serialized with 'settings_lock'. Records are written to flash without it,
+ * so writers never wait for a flash erase.
+ */
+static struct kb_settings_slot slots[CONFIG_KB_SETTINGS_SNAPSHOT_COUNT];
+
+K_MUTEX_DEFINE(settings_lock);
+
+// Snapshot currently published
+static atomic_ptr_t active_slot = ATOMIC_PTR_INIT(NULL);
+
+// Snapshot the scan loop picked up at its last scan boundary
+static atomic_ptr_t scan_slot = ATOMIC_PTR_INIT(NULL);
+
+// Generation of the last published snapshot
+static uint32_t generation = 0;
+
+// Profile switch requested but not yet loaded (-1 if none)
+static atomic_t requested_profile = ATOMIC_INIT(-1);
+
+// "kb/active" needs to be written to flash
+static atomic_t active_dirty = ATOMIC_INIT(0);
+
+// Legacy "kb/blob" was found and has to be deleted once records are written
+static bool legacy_blob_present = false;
+
+// Boot time load is done, later loads run on the persistence work queue
+static bool booted = false;
+
+// Record being loaded, protected by 'settings_lock'
+static union {
+    struct kb_settings_rec rec;
+    uint8_t raw[KB_SETTINGS_REC_LOAD_SIZE];
+} load_buf;
+
+static struct k_work_delayable profile_work;
 
 static on_settings_update_cb on_settings_update = NULL;
 
@@ -43,14 +188,89 @@ void kb_settings_set_on_update(on_settings_update_cb cb) {
     on_settings_update = cb;
 }
 
+static inline struct kb_settings_slot *kb_settings_active_slot() {
+    return atomic_ptr_get(&active_slot);
+}
+
+static inline struct kb_settings_slot *
+kb_settings_slot_of(const kb_settings_t *settings) {
+    return CONTAINER_OF(settings, struct kb_settings_slot, settings);
+}
+
+static bool kb_settings_slot_is_dirty(struct kb_settings_slot *slot) {
+    for (size_t i = 0; i < ARRAY_SIZE(slot->dirty); ++i) {
+        if (atomic_get(&slot->dirty[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Find a free slot, reclaiming retired ones nobody uses anymore.
+//
+// Should be called with 'settings_lock' held.
+static struct kb_settings_slot *kb_settings_slot_alloc() {
+    struct kb_settings_slot *scan = atomic_ptr_get(&scan_slot);
+
+    for (size_t i = 0; i < ARRAY_SIZE(slots); ++i) {
+        struct kb_settings_slot *slot = &slots[i];
+        if (slot->state == KB_SETTINGS_SLOT_RETIRED && slot != scan &&
+            !atomic_get(&slot->readers) && !kb_settings_slot_is_dirty(slot)) {
+            slot->state = KB_SETTINGS_SLOT_FREE;
+        }
+        if (slot->state == KB_SETTINGS_SLOT_FREE) {
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+// Find the newest snapshot of 'profile' other than the active one
+//
+// Should be called with 'settings_lock' held.
+static struct kb_settings_slot *kb_settings_slot_find(uint8_t profile) {
+    struct kb_settings_slot *found = NULL;
+
+    for (size_t i = 0; i < ARRAY_SIZE(slots); ++i) {
+        struct kb_settings_slot *slot = &slots[i];
+        if ((slot->state != KB_SETTINGS_SLOT_PRELOAD &&
+             slot->state != KB_SETTINGS_SLOT_RETIRED) ||
+            slot->settings.profile != profile) {
+            continue;
+        }
+        if (!found ||
+            (int32_t)(slot->settings.generation - found->settings.generation) >
+                0) {
+            found = slot;
+        }
+    }
+
+    return found;
+}
+
+static struct kb_settings_slot *kb_settings_slot_preload() {
+    for (size_t i = 0; i < ARRAY_SIZE(slots); ++i) {
+        if (slots[i].state == KB_SETTINGS_SLOT_PRELOAD) {
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
 static void
 kb_settings_load_default_keys_calibration(kb_settings_key_calib_t *calibrations,
                                           size_t key_count) {
     uint16_t max = CONFIG_KB_SETTINGS_DEFAULT_MAXIMUM;
     uint16_t min = CONFIG_KB_SETTINGS_DEFAULT_MINIMUM;
+#if CONFIG_KB_TRAVEL
+    uint16_t threshold =
+        kb_travel_to_value(min, max, KB_TRAVEL_DEFAULT_ACTUATION);
+#else
     double threshold =
         ((double)(max - min) * CONFIG_KB_SETTINGS_DEFAULT_THRESHOLD / 100) +
         min;
+#endif // CONFIG_KB_TRAVEL
     for (size_t i = 0; i < key_count; ++i) {
         kb_settings_key_calib_t *c = &calibrations[i];
         c->maximum = CONFIG_KB_SETTINGS_DEFAULT_MAXIMUM;
@@ -110,215 +330,1116 @@ static void kb_settings_keymap_rehydrate(kb_key_rules_t *keymap,
     }
 }
 
-static void kb_settings_load_default() {
-    settings.main.key_polling_rate = CONFIG_KB_SETTINGS_DEFAULT_POLLING_RATE;
-    settings.main.mode = KB_MODE_NORMAL;
+// Copy snapshot 'src' into 'dst' pointing mappings to the 'dst' own rules
+static void kb_settings_slot_copy(struct kb_settings_slot *dst,
+                                  const struct kb_settings_slot *src) {
+    dst->settings = src->settings;
 
-    LOG_DBG("Selected key polling rate: %d", settings.main.key_polling_rate);
-    LOG_DBG("Selected mode: %d", settings.main.mode);
-
-    kb_settings_load_default_keys_calibration(settings.keys_calibration,
-                                              CONFIG_KB_KEY_COUNT);
-    LOG_DBG("Keys calibration values: min: %d, max: %d, thr: %d",
-            settings.keys_calibration[0].minimum,
-            settings.keys_calibration[0].maximum,
-            settings.keys_calibration[0].threshold);
+    memcpy(dst->runtime_mappings, src->runtime_mappings,
+           sizeof(dst->runtime_mappings));
+    kb_settings_keymap_rehydrate(dst->settings.mappings, dst->runtime_mappings,
+                                 CONFIG_KB_KEY_COUNT);
 
 #if CONFIG_BT_INTER_KB_COMM_MASTER
-    kb_settings_load_default_keys_calibration(settings.keys_calibration_slave,
-                                              CONFIG_KB_KEY_COUNT_SLAVE);
-    LOG_DBG("Slave keys calibration values: min: %d, max: %d, thr: %d",
-            settings.keys_calibration_slave[0].minimum,
-            settings.keys_calibration_slave[0].maximum,
-            settings.keys_calibration_slave[0].threshold);
+    memcpy(dst->runtime_mappings_slave, src->runtime_mappings_slave,
+           sizeof(dst->runtime_mappings_slave));
+    kb_settings_keymap_rehydrate(dst->settings.mappings_slave,
+                                 dst->runtime_mappings_slave,
+                                 CONFIG_KB_KEY_COUNT_SLAVE);
 #endif // CONFIG_BT_INTER_KB_COMM_MASTER
 
-    LOG_DBG("Loading default keymap...");
+    for (size_t i = 0; i < ARRAY_SIZE(dst->dirty); ++i) {
+        atomic_clear(&dst->dirty[i]);
+    }
+}
+
+// Precompute lookup tables used by the scan loop
+static void kb_settings_update_tables(kb_settings_t *settings) {
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
+        const kb_settings_key_calib_t *calib = &settings->keys_calibration[i];
+        settings->key_thresholds[i] = calib->threshold;
+#if CONFIG_KB_TRAVEL
+        kb_travel_key_init(&settings->key_travel[i], calib->minimum,
+                           calib->maximum);
+#endif // CONFIG_KB_TRAVEL
+    }
+}
+
+// Keymap chunk <-> key range helpers
+
+static inline size_t kb_settings_chunk_first_key(size_t chunk) {
+    return chunk * CONFIG_KB_SETTINGS_KEYMAP_CHUNK_KEYS;
+}
+
+static inline size_t kb_settings_chunk_key_count(size_t chunk,
+                                                 size_t key_count) {
+    size_t first = kb_settings_chunk_first_key(chunk);
+    return MIN(key_count - first, CONFIG_KB_SETTINGS_KEYMAP_CHUNK_KEYS);
+}
+
+// Default keymap offsets in the DEFAULT_KEYMAP for this half and the slave
 #if CONFIG_YKB_RIGHT
-    kb_key_rules_into_kb_ruleset_pods(&DEFAULT_KEYMAP[CONFIG_KB_KEY_COUNT_LEFT],
-                                      CONFIG_KB_KEY_COUNT, runtime_mappings);
+#define KB_SETTINGS_DEFAULT_KEYMAP_OFFSET CONFIG_KB_KEY_COUNT_LEFT
+#define KB_SETTINGS_DEFAULT_KEYMAP_OFFSET_SLAVE 0
+#elif CONFIG_YKB_LEFT
+#define KB_SETTINGS_DEFAULT_KEYMAP_OFFSET 0
+#define KB_SETTINGS_DEFAULT_KEYMAP_OFFSET_SLAVE CONFIG_KB_KEY_COUNT_LEFT
 #else
-    kb_key_rules_into_kb_ruleset_pods(DEFAULT_KEYMAP, CONFIG_KB_KEY_COUNT,
-                                      runtime_mappings);
+#define KB_SETTINGS_DEFAULT_KEYMAP_OFFSET 0
+#define KB_SETTINGS_DEFAULT_KEYMAP_OFFSET_SLAVE 0
 #endif // CONFIG_YKB_RIGHT
-    kb_settings_keymap_rehydrate(settings.mappings, runtime_mappings,
-                                 CONFIG_KB_KEY_COUNT);
-    LOG_DBG("Loaded default keymap.");
 
+// Per-record defaults
+
+static void kb_settings_load_default_rec(struct kb_settings_slot *slot,
+                                         size_t idx) {
+    kb_settings_t *settings = &slot->settings;
+
+    if (idx == KB_SETTINGS_REC_IDX_MAIN) {
+        settings->main.key_polling_rate =
+            CONFIG_KB_SETTINGS_DEFAULT_POLLING_RATE;
+        settings->main.mode = KB_MODE_NORMAL;
+
+        LOG_DBG("Selected key polling rate: %d",
+                settings->main.key_polling_rate);
+        LOG_DBG("Selected mode: %d", settings->main.mode);
+        return;
+    }
+
+    if (idx == KB_SETTINGS_REC_IDX_CALIB) {
+        kb_settings_load_default_keys_calibration(settings->keys_calibration,
+                                                  CONFIG_KB_KEY_COUNT);
+        LOG_DBG("Keys calibration values: min: %d, max: %d, thr: %d",
+                settings->keys_calibration[0].minimum,
+                settings->keys_calibration[0].maximum,
+                settings->keys_calibration[0].threshold);
+        return;
+    }
+
+    if (idx == KB_SETTINGS_REC_IDX_CALIB_SLAVE) {
 #if CONFIG_BT_INTER_KB_COMM_MASTER
-    LOG_DBG("Loading default slave keymap...");
-#if CONFIG_YKB_RIGHT
-    kb_key_rules_into_kb_ruleset_pods(DEFAULT_KEYMAP, CONFIG_KB_KEY_COUNT_SLAVE,
-                                      runtime_mappings_slave);
-#endif // CONFIG_YKB_RIGHT
-#if CONFIG_YKB_LEFT
-    kb_key_rules_into_kb_ruleset_pods(&DEFAULT_KEYMAP[CONFIG_KB_KEY_COUNT_LEFT],
-                                      CONFIG_KB_KEY_COUNT_SLAVE,
-                                      runtime_mappings_slave);
-#endif // CONFIG_YKB_LEFT
-    kb_settings_keymap_rehydrate(settings.mappings_slave,
-                                 runtime_mappings_slave,
-                                 CONFIG_KB_KEY_COUNT_SLAVE);
-    LOG_DBG("Loaded default slave keymap.");
+        kb_settings_load_default_keys_calibration(
+            settings->keys_calibration_slave, CONFIG_KB_KEY_COUNT_SLAVE);
+        LOG_DBG("Slave keys calibration values: min: %d, max: %d, thr: %d",
+                settings->keys_calibration_slave[0].minimum,
+                settings->keys_calibration_slave[0].maximum,
+                settings->keys_calibration_slave[0].threshold);
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+        return;
+    }
+
+    if (idx < KB_SETTINGS_REC_IDX_KEYMAP_SLAVE) {
+        size_t chunk = idx - KB_SETTINGS_REC_IDX_KEYMAP;
+        size_t first = kb_settings_chunk_first_key(chunk);
+        size_t count = kb_settings_chunk_key_count(chunk, CONFIG_KB_KEY_COUNT);
+        LOG_DBG("Loading default keymap chunk %d...", chunk);
+        kb_key_rules_into_kb_ruleset_pods(
+            &DEFAULT_KEYMAP[KB_SETTINGS_DEFAULT_KEYMAP_OFFSET + first], count,
+            &slot->runtime_mappings[first]);
+        kb_settings_keymap_rehydrate(&settings->mappings[first],
+                                     &slot->runtime_mappings[first], count);
+        return;
+    }
+
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+    if (idx < KB_SETTINGS_REC_COUNT) {
+        size_t chunk = idx - KB_SETTINGS_REC_IDX_KEYMAP_SLAVE;
+        size_t first = kb_settings_chunk_first_key(chunk);
+        size_t count =
+            kb_settings_chunk_key_count(chunk, CONFIG_KB_KEY_COUNT_SLAVE);
+        LOG_DBG("Loading default slave keymap chunk %d...", chunk);
+        kb_key_rules_into_kb_ruleset_pods(
+            &DEFAULT_KEYMAP[KB_SETTINGS_DEFAULT_KEYMAP_OFFSET_SLAVE + first],
+            count, &slot->runtime_mappings_slave[first]);
+        kb_settings_keymap_rehydrate(&settings->mappings_slave[first],
+                                     &slot->runtime_mappings_slave[first],
+                                     count);
+    }
 #endif // CONFIG_BT_INTER_KB_COMM_MASTER
+}
 
-    if (on_settings_update) {
-        on_settings_update(&settings);
+// Whether record with index 'idx' exists in this configuration
+static inline bool kb_settings_rec_exists(size_t idx) {
+    if (idx == KB_SETTINGS_REC_IDX_CALIB_SLAVE) {
+        return IS_ENABLED(CONFIG_BT_INTER_KB_COMM_MASTER);
+    }
+    return idx < KB_SETTINGS_REC_COUNT;
+}
+
+static enum kb_settings_rec_kind kb_settings_rec_kind(size_t idx) {
+    if (idx == KB_SETTINGS_REC_IDX_MAIN) {
+        return KB_SETTINGS_REC_KIND_MAIN;
+    }
+    if (idx == KB_SETTINGS_REC_IDX_CALIB ||
+        idx == KB_SETTINGS_REC_IDX_CALIB_SLAVE) {
+        return KB_SETTINGS_REC_KIND_CALIB;
     }
+    return KB_SETTINGS_REC_KIND_KEYMAP;
 }
 
-void kb_settings_build_image_from_runtime(struct kb_settings_image *img) {
-    img->version = KB_SETTINGS_IMAGE_VERSION;
-    img->main = settings.main;
+static uint16_t kb_settings_rec_kind_version(enum kb_settings_rec_kind kind) {
+    switch (kind) {
+    case KB_SETTINGS_REC_KIND_MAIN:
+        return KB_SETTINGS_REC_MAIN_VERSION;
+    case KB_SETTINGS_REC_KIND_CALIB:
+        return KB_SETTINGS_REC_CALIB_VERSION;
+    case KB_SETTINGS_REC_KIND_KEYMAP:
+        return KB_SETTINGS_REC_KEYMAP_VERSION;
+    }
+    return 0;
+}
 
-    memcpy(img->keys_calibration, settings.keys_calibration,
-           sizeof(img->keys_calibration));
-    kb_key_rules_into_kb_ruleset_pods(settings.mappings, CONFIG_KB_KEY_COUNT,
-                                      img->mappings);
+// Subtree holding records of 'profile', e.g. "kb/p2"
+static void kb_settings_profile_subtree(uint8_t profile, char *name,
+                                        size_t name_len) {
+    if (profile == 0) {
+        snprintk(name, name_len, KB_SETTINGS_NS);
+        return;
+    }
+    snprintk(name, name_len, KB_SETTINGS_NS "/%c%u",
+             KB_SETTINGS_PROFILE_PREFIX, profile);
+}
+
+// Full record name, e.g. "kb/p1/km/2"
+static void kb_settings_rec_name(uint8_t profile, size_t idx, char *name,
+                                 size_t name_len) {
+    char subtree[sizeof(KB_SETTINGS_NS) + 5];
+    kb_settings_profile_subtree(profile, subtree, sizeof(subtree));
 
+    if (idx == KB_SETTINGS_REC_IDX_MAIN) {
+        snprintk(name, name_len, "%s/%s", subtree, KB_SETTINGS_REC_MAIN);
+    } else if (idx == KB_SETTINGS_REC_IDX_CALIB) {
+        snprintk(name, name_len, "%s/%s", subtree, KB_SETTINGS_REC_CALIB);
+    } else if (idx == KB_SETTINGS_REC_IDX_CALIB_SLAVE) {
+        snprintk(name, name_len, "%s/%s", subtree,
+                 KB_SETTINGS_REC_CALIB_SLAVE);
+    } else if (idx < KB_SETTINGS_REC_IDX_KEYMAP_SLAVE) {
+        snprintk(name, name_len, "%s/%s/%u", subtree, KB_SETTINGS_REC_KEYMAP,
+                 (unsigned int)(idx - KB_SETTINGS_REC_IDX_KEYMAP));
+    } else {
+        snprintk(name, name_len, "%s/%s/%u", subtree,
+                 KB_SETTINGS_REC_KEYMAP_SLAVE,
+                 (unsigned int)(idx - KB_SETTINGS_REC_IDX_KEYMAP_SLAVE));
+    }
+}
+
+// Fill out record 'rec' from the slot settings
+//
+// Returns full record size (header + payload)
+static size_t kb_settings_rec_build(struct kb_settings_slot *slot, size_t idx,
+                                    struct kb_settings_rec *rec) {
+    kb_settings_t *settings = &slot->settings;
+    size_t size = 0;
+
+    if (idx == KB_SETTINGS_REC_IDX_MAIN) {
+        rec->payload.main = settings->main;
+        size = sizeof(rec->payload.main);
+    } else if (idx == KB_SETTINGS_REC_IDX_CALIB) {
+        size = sizeof(settings->keys_calibration);
+        memcpy(rec->payload.calib, settings->keys_calibration, size);
 #if CONFIG_BT_INTER_KB_COMM_MASTER
-    memcpy(img->keys_calibration_slave, settings.keys_calibration_slave,
-           sizeof(img->keys_calibration_slave));
-    kb_key_rules_into_kb_ruleset_pods(settings.mappings_slave,
-                                      CONFIG_KB_KEY_COUNT_SLAVE,
-                                      img->mappings_slave);
+    } else if (idx == KB_SETTINGS_REC_IDX_CALIB_SLAVE) {
+        size = sizeof(settings->keys_calibration_slave);
+        memcpy(rec->payload.calib, settings->keys_calibration_slave, size);
 #endif // CONFIG_BT_INTER_KB_COMM_MASTER
+    } else if (idx < KB_SETTINGS_REC_IDX_KEYMAP_SLAVE) {
+        size_t chunk = idx - KB_SETTINGS_REC_IDX_KEYMAP;
+        size_t first = kb_settings_chunk_first_key(chunk);
+        size_t count = kb_settings_chunk_key_count(chunk, CONFIG_KB_KEY_COUNT);
+        kb_key_rules_into_kb_ruleset_pods(&settings->mappings[first], count,
+                                          rec->payload.keymap);
+        size = count * sizeof(kb_ruleset_pod_t);
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+    } else {
+        size_t chunk = idx - KB_SETTINGS_REC_IDX_KEYMAP_SLAVE;
+        size_t first = kb_settings_chunk_first_key(chunk);
+        size_t count =
+            kb_settings_chunk_key_count(chunk, CONFIG_KB_KEY_COUNT_SLAVE);
+        kb_key_rules_into_kb_ruleset_pods(&settings->mappings_slave[first],
+                                          count, rec->payload.keymap);
+        size = count * sizeof(kb_ruleset_pod_t);
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+    }
+
+    rec->hdr.hdr_size = sizeof(rec->hdr);
+    rec->hdr.kind = kb_settings_rec_kind(idx);
+    rec->hdr.version = kb_settings_rec_kind_version(rec->hdr.kind);
+    rec->hdr.size = (uint16_t)size;
+    rec->hdr.reserved = 0;
+    rec->hdr.crc = crc32_ieee((const uint8_t *)&rec->payload, size);
+
+    return sizeof(rec->hdr) + size;
 }
 
-kb_settings_t *kb_settings_get() {
-    return &settings;
+// Apply validated record payload to the slot settings
+static void kb_settings_rec_apply(struct kb_settings_slot *slot, size_t idx,
+                                  struct kb_settings_rec *rec) {
+    kb_settings_t *settings = &slot->settings;
+
+    if (idx == KB_SETTINGS_REC_IDX_MAIN) {
+        settings->main = rec->payload.main;
+    } else if (idx == KB_SETTINGS_REC_IDX_CALIB) {
+        memcpy(settings->keys_calibration, rec->payload.calib,
+               sizeof(settings->keys_calibration));
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+    } else if (idx == KB_SETTINGS_REC_IDX_CALIB_SLAVE) {
+        memcpy(settings->keys_calibration_slave, rec->payload.calib,
+               sizeof(settings->keys_calibration_slave));
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+    } else if (idx < KB_SETTINGS_REC_IDX_KEYMAP_SLAVE) {
+        size_t chunk = idx - KB_SETTINGS_REC_IDX_KEYMAP;
+        size_t first = kb_settings_chunk_first_key(chunk);
+        size_t count = kb_settings_chunk_key_count(chunk, CONFIG_KB_KEY_COUNT);
+        kb_ruleset_pods_into_runtime_pods(rec->payload.keymap, count,
+                                          &slot->runtime_mappings[first]);
+        kb_settings_keymap_rehydrate(&settings->mappings[first],
+                                     &slot->runtime_mappings[first], count);
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+    } else {
+        size_t chunk = idx - KB_SETTINGS_REC_IDX_KEYMAP_SLAVE;
+        size_t first = kb_settings_chunk_first_key(chunk);
+        size_t count =
+            kb_settings_chunk_key_count(chunk, CONFIG_KB_KEY_COUNT_SLAVE);
+        kb_ruleset_pods_into_runtime_pods(
+            rec->payload.keymap, count, &slot->runtime_mappings_slave[first]);
+        kb_settings_keymap_rehydrate(&settings->mappings_slave[first],
+                                     &slot->runtime_mappings_slave[first],
+                                     count);
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+    }
 }
 
-void kb_settings_save() {
-    struct kb_settings_image img;
-    kb_settings_build_image_from_runtime(&img);
-    int w = settings_save_one(KB_SETTINGS_KEY, &img, sizeof(img));
+// Resolve record index from its name relative to the profile subtree
+//
+// Returns negative value if name is unknown
+static int kb_settings_rec_idx_from_name(const char *name) {
+    const char *next;
+
+    if (settings_name_steq(name, KB_SETTINGS_REC_MAIN, &next) && !next) {
+        return KB_SETTINGS_REC_IDX_MAIN;
+    }
+    if (settings_name_steq(name, KB_SETTINGS_REC_CALIB, &next) && !next) {
+        return KB_SETTINGS_REC_IDX_CALIB;
+    }
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+    if (settings_name_steq(name, KB_SETTINGS_REC_CALIB_SLAVE, &next) &&
+        !next) {
+        return KB_SETTINGS_REC_IDX_CALIB_SLAVE;
+    }
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+
+    int base = -1;
+    size_t chunks = 0;
+    if (settings_name_steq(name, KB_SETTINGS_REC_KEYMAP, &next) && next) {
+        base = KB_SETTINGS_REC_IDX_KEYMAP;
+        chunks = KB_SETTINGS_KEYMAP_CHUNKS;
+    } else if (settings_name_steq(name, KB_SETTINGS_REC_KEYMAP_SLAVE, &next) &&
+               next) {
+        base = KB_SETTINGS_REC_IDX_KEYMAP_SLAVE;
+        chunks = KB_SETTINGS_KEYMAP_CHUNKS_SLAVE;
+    }
+    if (base < 0) {
+        return -ENOENT;
+    }
+
+    char *end;
+    unsigned long chunk = strtoul(next, &end, 10);
+    if (end == next || *end != '\0' || chunk >= chunks) {
+        return -ENOENT;
+    }
+
+    return base + (int)chunk;
+}
+
+// Whether 'name' relative to "kb" belongs to a profile other than 0
+static bool kb_settings_is_profile_subtree(const char *name) {
+    return name[0] == KB_SETTINGS_PROFILE_PREFIX && name[1] >= '0' &&
+           name[1] <= '9';
+}
+
+static void kb_settings_notify_update(const kb_settings_t *settings) {
+    if (on_settings_update) {
+        on_settings_update(settings);
+    }
+}
+
+static inline bool kb_settings_slot_is_stored(struct kb_settings_slot *slot) {
+    return slot->state == KB_SETTINGS_SLOT_ACTIVE ||
+           slot->state == KB_SETTINGS_SLOT_PRELOAD ||
+           slot->state == KB_SETTINGS_SLOT_RETIRED;
+}
+
+// Mark record 'idx' of the newest snapshot of 'profile' dirty again
+//
+// Should be called with 'settings_lock' held.
+static void kb_settings_rec_redirty(uint8_t profile, size_t idx) {
+    struct kb_settings_slot *slot = kb_settings_active_slot();
+    if (slot->settings.profile != profile) {
+        slot = kb_settings_slot_find(profile);
+    }
+    if (slot) {
+        atomic_set_bit(slot->dirty, idx);
+    }
+}
+
+// Write record 'idx' of 'slot' if it is dirty
+//
+// The record is built under 'settings_lock' and written without it.
+static int kb_settings_rec_store(struct kb_settings_slot *slot, size_t idx) {
+    struct kb_settings_rec rec;
+    char key[32];
+
+    k_mutex_lock(&settings_lock, K_FOREVER);
+    if (!kb_settings_slot_is_stored(slot) ||
+        !atomic_test_and_clear_bit(slot->dirty, idx)) {
+        k_mutex_unlock(&settings_lock);
+        return 0;
+    }
+    uint8_t profile = slot->settings.profile;
+    size_t len = kb_settings_rec_build(slot, idx, &rec);
+    kb_settings_rec_name(profile, idx, key, sizeof(key));
+    k_mutex_unlock(&settings_lock);
+
+    int w = settings_save_one(key, &rec, len);
     if (w) {
-        LOG_WRN("Could not save keyboard settings: %d", w);
-    } else {
-        LOG_INF("Keyboard settings saved.");
+        LOG_WRN("Could not save keyboard settings record '%s': %d", key, w);
+        // Commits move dirty records to newer snapshots meanwhile
+        k_mutex_lock(&settings_lock, K_FOREVER);
+        kb_settings_rec_redirty(profile, idx);
+        k_mutex_unlock(&settings_lock);
+        return w;
     }
+    LOG_DBG("Keyboard settings record '%s' saved (%d bytes)", key, len);
+
+    return 0;
 }
 
-static void kb_settings_load_from_image(struct kb_settings_image *img) {
-    settings.main.mode = img->main.mode;
-    settings.main.key_polling_rate = img->main.key_polling_rate;
+static int kb_settings_store() {
+    int ret = 0;
 
-    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
-        settings.keys_calibration[i] = img->keys_calibration[i];
+    for (size_t i = 0; i < ARRAY_SIZE(slots); ++i) {
+        for (size_t idx = 0; idx < KB_SETTINGS_REC_COUNT; ++idx) {
+            if (!kb_settings_rec_exists(idx)) {
+                continue;
+            }
+            int err = kb_settings_rec_store(&slots[i], idx);
+            if (err) {
+                ret = err;
+            }
+        }
     }
-    kb_ruleset_pods_into_runtime_pods(img->mappings, CONFIG_KB_KEY_COUNT,
-                                      runtime_mappings);
-    kb_settings_keymap_rehydrate(settings.mappings, runtime_mappings,
-                                 CONFIG_KB_KEY_COUNT);
 
-#if CONFIG_BT_INTER_KB_COMM_MASTER
-    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT_SLAVE; ++i) {
-        settings.keys_calibration_slave[i] = img->keys_calibration_slave[i];
+    if (atomic_cas(&active_dirty, 1, 0)) {
+        uint8_t profile = kb_settings_active_slot()->settings.profile;
+        int err = settings_save_one(KB_SETTINGS_NS "/" KB_SETTINGS_REC_ACTIVE,
+                                    &profile, sizeof(profile));
+        if (err) {
+            LOG_WRN("Could not save active keyboard profile: %d", err);
+            atomic_set(&active_dirty, 1);
+            ret = err;
+        }
     }
-    kb_ruleset_pods_into_runtime_pods(
-        img->mappings_slave, CONFIG_KB_KEY_COUNT_SLAVE, runtime_mappings_slave);
-    kb_settings_keymap_rehydrate(settings.mappings_slave,
-                                 runtime_mappings_slave,
-                                 CONFIG_KB_KEY_COUNT_SLAVE);
+
+    // Only touched by the persistence work queue after init
+    if (!ret && legacy_blob_present) {
+        int err =
+            settings_delete(KB_SETTINGS_NS "/" KB_SETTINGS_REC_LEGACY_BLOB);
+        if (err) {
+            LOG_WRN("Could not delete legacy keyboard settings image: %d", err);
+        } else {
+            LOG_INF("Legacy keyboard settings image deleted");
+            legacy_blob_present = false;
+        }
+    }
+
+    return ret;
+}
+
+KB_SETTINGS_PERSIST_SECTION_DEFINE(kb, kb_settings_store);
+
+static void kb_settings_mark_rec_dirty(struct kb_settings_slot *slot,
+                                       size_t idx) {
+    atomic_set_bit(slot->dirty, idx);
+    kb_settings_persist_mark_dirty(KB_SETTINGS_PERSIST_SECTION(kb));
+}
+
+static void kb_settings_slot_mark_parts(struct kb_settings_slot *slot,
+                                        uint32_t parts) {
+    if (parts & KB_SETTINGS_PART_MAIN) {
+        atomic_set_bit(slot->dirty, KB_SETTINGS_REC_IDX_MAIN);
+    }
+    if (parts & KB_SETTINGS_PART_CALIB) {
+        atomic_set_bit(slot->dirty, KB_SETTINGS_REC_IDX_CALIB);
+    }
+    if ((parts & KB_SETTINGS_PART_CALIB_SLAVE) &&
+        kb_settings_rec_exists(KB_SETTINGS_REC_IDX_CALIB_SLAVE)) {
+        atomic_set_bit(slot->dirty, KB_SETTINGS_REC_IDX_CALIB_SLAVE);
+    }
+    if (parts & KB_SETTINGS_PART_KEYMAP) {
+        for (size_t i = 0; i < KB_SETTINGS_KEYMAP_CHUNKS; ++i) {
+            atomic_set_bit(slot->dirty, KB_SETTINGS_REC_IDX_KEYMAP + i);
+        }
+    }
+    if (parts & KB_SETTINGS_PART_KEYMAP_SLAVE) {
+        for (size_t i = 0; i < KB_SETTINGS_KEYMAP_CHUNKS_SLAVE; ++i) {
+            atomic_set_bit(slot->dirty, KB_SETTINGS_REC_IDX_KEYMAP_SLAVE + i);
+        }
+    }
+}
+
+// Make 'slot' the active snapshot. Scan loop picks it up on its next scan.
+//
+// Should be called with 'settings_lock' held.
+static void kb_settings_publish(struct kb_settings_slot *slot) {
+    struct kb_settings_slot *old = kb_settings_active_slot();
+
+    slot->settings.generation = ++generation;
+    slot->state = KB_SETTINGS_SLOT_ACTIVE;
+    atomic_ptr_set(&active_slot, slot);
+
+    if (old && old != slot) {
+        old->state = KB_SETTINGS_SLOT_RETIRED;
+    }
+}
+
+const kb_settings_t *kb_settings_get() {
+    struct kb_settings_slot *slot;
+
+    // Retry if the snapshot got replaced (and possibly reclaimed) before we
+    // announced using it
+    for (;;) {
+        slot = kb_settings_active_slot();
+        atomic_inc(&slot->readers);
+        if (slot == kb_settings_active_slot()) {
+            return &slot->settings;
+        }
+        atomic_dec(&slot->readers);
+    }
+}
+
+void kb_settings_put(const kb_settings_t *settings) {
+    struct kb_settings_slot *slot = kb_settings_slot_of(settings);
+
+    __ASSERT_NO_MSG(atomic_get(&slot->readers) > 0);
+
+    atomic_dec(&slot->readers);
+}
+
+const kb_settings_t *kb_settings_acquire() {
+    struct kb_settings_slot *slot;
+
+    // Retry if the snapshot got replaced (and possibly reclaimed) before we
+    // announced using it
+    do {
+        slot = kb_settings_active_slot();
+        atomic_ptr_set(&scan_slot, slot);
+    } while (slot != kb_settings_active_slot());
+
+    return &slot->settings;
+}
+
+uint32_t kb_settings_generation() {
+    return kb_settings_active_slot()->settings.generation;
+}
+
+kb_settings_t *kb_settings_edit_begin() {
+    k_mutex_lock(&settings_lock, K_FOREVER);
+
+    struct kb_settings_slot *slot = kb_settings_slot_alloc();
+    if (!slot) {
+        k_mutex_unlock(&settings_lock);
+        LOG_WRN("No free keyboard settings snapshot");
+        return NULL;
+    }
+
+    kb_settings_slot_copy(slot, kb_settings_active_slot());
+    slot->state = KB_SETTINGS_SLOT_EDIT;
+
+    // 'settings_lock' stays locked until commit or abort
+    return &slot->settings;
+}
+
+void kb_settings_edit_mark_key(kb_settings_t *settings, size_t key_index,
+                               bool slave, uint32_t parts) {
+    struct kb_settings_slot *slot = kb_settings_slot_of(settings);
+
+    __ASSERT_NO_MSG(slot->state == KB_SETTINGS_SLOT_EDIT);
+
+    kb_settings_slot_mark_parts(
+        slot, parts & (KB_SETTINGS_PART_CALIB | KB_SETTINGS_PART_CALIB_SLAVE));
+    if (!(parts & (KB_SETTINGS_PART_KEYMAP | KB_SETTINGS_PART_KEYMAP_SLAVE))) {
+        return;
+    }
+
+    size_t chunk = key_index / CONFIG_KB_SETTINGS_KEYMAP_CHUNK_KEYS;
+    if (slave) {
+        if (chunk < KB_SETTINGS_KEYMAP_CHUNKS_SLAVE) {
+            atomic_set_bit(slot->dirty,
+                           KB_SETTINGS_REC_IDX_KEYMAP_SLAVE + chunk);
+        }
+    } else if (chunk < KB_SETTINGS_KEYMAP_CHUNKS) {
+        atomic_set_bit(slot->dirty, KB_SETTINGS_REC_IDX_KEYMAP + chunk);
+    }
+}
+
+int kb_settings_edit_set_rules(kb_settings_t *settings, size_t key_index,
+                               bool slave, const kb_map_rule_t *rules,
+                               uint8_t count) {
+    struct kb_settings_slot *slot = kb_settings_slot_of(settings);
+    kb_ruleset_pod_t *pod;
+    kb_key_rules_t *mapping;
+
+    __ASSERT_NO_MSG(slot->state == KB_SETTINGS_SLOT_EDIT);
+
+    if (count > CONFIG_KB_MAX_RULES_PER_KEY) {
+        return -EINVAL;
+    }
+
+    if (slave) {
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+        if (key_index >= CONFIG_KB_KEY_COUNT_SLAVE) {
+            return -EINVAL;
+        }
+        pod = &slot->runtime_mappings_slave[key_index];
+        mapping = &settings->mappings_slave[key_index];
+#else
+        return -ENOTSUP;
 #endif // CONFIG_BT_INTER_KB_COMM_MASTER
+    } else {
+        if (key_index >= CONFIG_KB_KEY_COUNT) {
+            return -EINVAL;
+        }
+        pod = &slot->runtime_mappings[key_index];
+        mapping = &settings->mappings[key_index];
+    }
+
+    // Rules live in the edited slot, 'mappings' only point to them
+    memcpy(pod->rules, rules, count * sizeof(rules[0]));
+    pod->count = count;
+    mapping->rules = pod->rules;
+    mapping->count = count;
+
+    kb_settings_edit_mark_key(settings, key_index, slave,
+                              slave ? KB_SETTINGS_PART_KEYMAP_SLAVE
+                                    : KB_SETTINGS_PART_KEYMAP);
+
+    return 0;
 }
 
-int kb_settings_handler_set(const char *key, size_t len,
-                            settings_read_cb read_cb, void *cb_arg) {
-    if (strcmp(key, KB_SETTINGS_ITEM) != 0) {
-        return -ENOENT;
+void kb_settings_edit_commit(kb_settings_t *settings, uint32_t parts) {
+    struct kb_settings_slot *slot = kb_settings_slot_of(settings);
+    struct kb_settings_slot *old = kb_settings_active_slot();
+
+    __ASSERT_NO_MSG(slot->state == KB_SETTINGS_SLOT_EDIT);
+
+    kb_settings_update_tables(&slot->settings);
+    kb_settings_slot_mark_parts(slot, parts);
+
+    // Changes of the replaced snapshot not yet written move to the new one
+    for (size_t i = 0; i < ARRAY_SIZE(slot->dirty); ++i) {
+        atomic_or(&slot->dirty[i], atomic_clear(&old->dirty[i]));
+    }
+
+    kb_settings_publish(slot);
+
+    k_mutex_unlock(&settings_lock);
+
+    kb_settings_persist_mark_dirty(KB_SETTINGS_PERSIST_SECTION(kb));
+    kb_settings_notify_update(&slot->settings);
+}
+
+uint16_t kb_settings_calib_rescale_threshold(
+    const kb_settings_key_calib_t *calib, uint16_t minimum, uint16_t maximum) {
+    if (minimum >= maximum) {
+        return minimum;
+    }
+#if CONFIG_KB_TRAVEL
+    uint16_t actuation = KB_TRAVEL_DEFAULT_ACTUATION;
+    if (calib->minimum < calib->maximum) {
+        kb_travel_key_t key;
+        kb_travel_key_init(&key, calib->minimum, calib->maximum);
+        actuation = kb_travel_from_value(&key, calib->threshold);
+    }
+    return kb_travel_to_value(minimum, maximum, actuation);
+#else
+    uint32_t depth = CONFIG_KB_SETTINGS_DEFAULT_THRESHOLD;
+    if (calib->minimum < calib->maximum &&
+        calib->threshold > calib->minimum) {
+        depth = MIN(100, (uint32_t)(calib->threshold - calib->minimum) * 100 /
+                             (calib->maximum - calib->minimum));
+    }
+    return minimum + (uint16_t)((maximum - minimum) * depth / 100);
+#endif // CONFIG_KB_TRAVEL
+}
+
+void kb_settings_edit_abort(kb_settings_t *settings) {
+    struct kb_settings_slot *slot = kb_settings_slot_of(settings);
+
+    __ASSERT_NO_MSG(slot->state == KB_SETTINGS_SLOT_EDIT);
+
+    slot->state = KB_SETTINGS_SLOT_FREE;
+    k_mutex_unlock(&settings_lock);
+}
+
+void kb_settings_save() {
+    k_mutex_lock(&settings_lock, K_FOREVER);
+    kb_settings_slot_mark_parts(kb_settings_active_slot(),
+                                KB_SETTINGS_PART_ALL);
+    k_mutex_unlock(&settings_lock);
+
+    kb_settings_persist_mark_dirty(KB_SETTINGS_PERSIST_SECTION(kb));
+}
+
+// Layout of the legacy monolithic "kb/blob" image
+struct kb_settings_legacy_image {
+    uint16_t version;
+    kb_settings_main_t main;
+    kb_settings_key_calib_t keys_calibration[CONFIG_KB_KEY_COUNT];
+    kb_ruleset_pod_t mappings[CONFIG_KB_KEY_COUNT];
+
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+
+    kb_settings_key_calib_t keys_calibration_slave[CONFIG_KB_KEY_COUNT_SLAVE];
+    kb_ruleset_pod_t mappings_slave[CONFIG_KB_KEY_COUNT_SLAVE];
+
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+};
+
+// The only legacy image version which can be converted into records
+#define KB_SETTINGS_LEGACY_IMAGE_VERSION 3
+
+static void
+kb_settings_legacy_apply_rec(struct kb_settings_slot *slot, size_t idx,
+                             const struct kb_settings_legacy_image *img) {
+    struct kb_settings_rec rec;
+
+    if (idx == KB_SETTINGS_REC_IDX_MAIN) {
+        rec.payload.main = img->main;
+    } else if (idx == KB_SETTINGS_REC_IDX_CALIB) {
+        memcpy(rec.payload.calib, img->keys_calibration,
+               sizeof(img->keys_calibration));
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+    } else if (idx == KB_SETTINGS_REC_IDX_CALIB_SLAVE) {
+        memcpy(rec.payload.calib, img->keys_calibration_slave,
+               sizeof(img->keys_calibration_slave));
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+    } else if (idx < KB_SETTINGS_REC_IDX_KEYMAP_SLAVE) {
+        size_t chunk = idx - KB_SETTINGS_REC_IDX_KEYMAP;
+        size_t first = kb_settings_chunk_first_key(chunk);
+        size_t count = kb_settings_chunk_key_count(chunk, CONFIG_KB_KEY_COUNT);
+        memcpy(rec.payload.keymap, &img->mappings[first],
+               count * sizeof(kb_ruleset_pod_t));
+#if CONFIG_BT_INTER_KB_COMM_MASTER
+    } else {
+        size_t chunk = idx - KB_SETTINGS_REC_IDX_KEYMAP_SLAVE;
+        size_t first = kb_settings_chunk_first_key(chunk);
+        size_t count =
+            kb_settings_chunk_key_count(chunk, CONFIG_KB_KEY_COUNT_SLAVE);
+        memcpy(rec.payload.keymap, &img->mappings_slave[first],
+               count * sizeof(kb_ruleset_pod_t));
+#endif // CONFIG_BT_INTER_KB_COMM_MASTER
     }
 
-    const size_t kb_settings_img_size = sizeof(struct kb_settings_image);
-    if (len != kb_settings_img_size) {
-        LOG_ERR("Keyboard settings image size mismatch: got %zu, want %zu", len,
-                kb_settings_img_size);
+    kb_settings_rec_apply(slot, idx, &rec);
+}
+
+static int kb_settings_load_legacy_blob(struct kb_settings_slot *slot,
+                                        size_t len, settings_read_cb read_cb,
+                                        void *cb_arg) {
+    // Delete legacy image after records are written, whether it is usable or
+    // not
+    legacy_blob_present = true;
+
+    const size_t img_size = sizeof(struct kb_settings_legacy_image);
+    if (len != img_size) {
+        LOG_ERR("Legacy keyboard settings image size mismatch: got %zu, want "
+                "%zu",
+                len, img_size);
         return -EINVAL;
     }
 
-    struct kb_settings_image img;
+    struct kb_settings_legacy_image img;
     ssize_t rlen = read_cb(cb_arg, &img, sizeof(img));
+    if (rlen < 0) {
+        LOG_ERR("Legacy keyboard settings read_cb error: %d", (int)rlen);
+        return -EINVAL;
+    }
+    if ((size_t)rlen != sizeof(img)) {
+        LOG_ERR("Legacy keyboard settings truncated: %zd", rlen);
+        return -EINVAL;
+    }
+    if (img.version != KB_SETTINGS_LEGACY_IMAGE_VERSION) {
+        LOG_ERR("Legacy keyboard settings image version %u is not supported",
+                img.version);
+        return -EINVAL;
+    }
+
+    uint32_t start = k_cycle_get_32();
+
+    for (size_t idx = 0; idx < KB_SETTINGS_REC_COUNT; ++idx) {
+        // Records stored on their own are newer than the legacy image
+        if (!kb_settings_rec_exists(idx) ||
+            atomic_test_bit(slot->loaded, idx)) {
+            continue;
+        }
+        kb_settings_legacy_apply_rec(slot, idx, &img);
+        atomic_set_bit(slot->loaded, idx);
+        kb_settings_mark_rec_dirty(slot, idx);
+    }
+
+    kb_settings_migrate_account(k_cycle_get_32() - start);
+    LOG_INF("Legacy keyboard settings image converted into records");
+
+    return 0;
+}
+
+static int kb_settings_load_rec(struct kb_settings_slot *slot, const char *key,
+                                size_t len, settings_read_cb read_cb,
+                                void *cb_arg) {
+    int idx = kb_settings_rec_idx_from_name(key);
+    if (idx < 0) {
+        LOG_WRN("Unknown keyboard settings record '%s'", key);
+        return -ENOENT;
+    }
+
+    struct kb_settings_rec *rec = &load_buf.rec;
+
+    // Expected record size for the current layout
+    size_t want = kb_settings_rec_build(slot, idx, rec);
+
+    // Size is checked against the current layout only after migrating
+    if (len < sizeof(rec->hdr) || len > sizeof(load_buf)) {
+        LOG_ERR("Keyboard settings record '%s' has invalid size %zu", key,
+                len);
+        return -EINVAL;
+    }
 
+    ssize_t rlen = read_cb(cb_arg, &load_buf, len);
     if (rlen < 0) {
-        LOG_ERR("Keyboard settings read_cb error: %d", (int)rlen);
+        LOG_ERR("Keyboard settings record '%s' read_cb error: %d", key,
+                (int)rlen);
+        return -EINVAL;
+    }
+    if ((size_t)rlen != len) {
+        LOG_ERR("Keyboard settings record '%s' truncated: %zd", key, rlen);
         return -EINVAL;
     }
 
-    if ((size_t)rlen != sizeof(img)) {
-        LOG_ERR("Keyboard settings truncated: %zd", rlen);
+    enum kb_settings_rec_kind kind = kb_settings_rec_kind(idx);
+    if (rec->hdr.hdr_size != sizeof(rec->hdr) || rec->hdr.kind != kind ||
+        rec->hdr.size != len - sizeof(rec->hdr)) {
+        LOG_ERR("Keyboard settings record '%s' has malformed header", key);
         return -EINVAL;
     }
 
-    if (img.version != KB_SETTINGS_IMAGE_VERSION) {
-        LOG_ERR("Keyboad settings image version mismatch: got %u, want %u",
-                img.version, KB_SETTINGS_IMAGE_VERSION);
+    uint32_t crc = crc32_ieee((const uint8_t *)&rec->payload, rec->hdr.size);
+    if (crc != rec->hdr.crc) {
+        LOG_ERR("Keyboard settings record '%s' CRC mismatch", key);
         return -EINVAL;
     }
 
-    kb_settings_load_from_image(&img);
+    uint16_t version = kb_settings_rec_kind_version(kind);
+    if (rec->hdr.version > version) {
+        LOG_ERR("Keyboard settings record '%s' version %u is newer than "
+                "supported %u",
+                key, rec->hdr.version, version);
+        return -EINVAL;
+    }
 
-    kb_settings_keymap_rehydrate(settings.mappings, runtime_mappings,
-                                 CONFIG_KB_KEY_COUNT);
+    if (rec->hdr.version < version) {
+        // Raw payload of the stored length, the whole buffer is available
+        int err = kb_settings_migrate(kind, &rec->hdr.version, version,
+                                      (uint8_t *)&rec->payload, &rec->hdr.size,
+                                      sizeof(load_buf) - sizeof(rec->hdr));
+        if (err) {
+            return err;
+        }
+        // Write upgraded record back
+        kb_settings_mark_rec_dirty(slot, idx);
+    }
 
-#if CONFIG_BT_INTER_KB_COMM_MASTER
-    kb_settings_keymap_rehydrate(settings.mappings_slave,
-                                 runtime_mappings_slave,
-                                 CONFIG_KB_KEY_COUNT_SLAVE);
-#endif // CONFIG_BT_INTER_KB_COMM_MASTER
+    if (rec->hdr.size != want - sizeof(rec->hdr)) {
+        LOG_ERR("Keyboard settings record '%s' payload size mismatch: got %u, "
+                "want %zu",
+                key, rec->hdr.size, want - sizeof(rec->hdr));
+        return -EINVAL;
+    }
 
-    if (on_settings_update) {
-        on_settings_update(&settings);
+    kb_settings_rec_apply(slot, idx, rec);
+    atomic_set_bit(slot->loaded, idx);
+
+    return 0;
+}
+
+struct kb_settings_load_ctx {
+    struct kb_settings_slot *slot;
+    // Loading from the "kb" root (profile 0)
+    bool root;
+    // Convert the legacy image, only done at boot as the whole image has to
+    // be read at once and does not fit the persistence work queue stack
+    bool legacy;
+};
+
+static int kb_settings_load_cb(const char *key, size_t len,
+                               settings_read_cb read_cb, void *cb_arg,
+                               void *param) {
+    struct kb_settings_load_ctx *ctx = param;
+    const char *next;
+
+    if (!key) {
+        return 0;
     }
-    s_loaded_ok = true;
+
+    if (ctx->root) {
+        if (kb_settings_is_profile_subtree(key) ||
+            (settings_name_steq(key, KB_SETTINGS_REC_ACTIVE, &next) &&
+             !next)) {
+            return 0;
+        }
+        if (settings_name_steq(key, KB_SETTINGS_REC_LEGACY_BLOB, &next) &&
+            !next) {
+            if (ctx->legacy) {
+                kb_settings_load_legacy_blob(ctx->slot, len, read_cb, cb_arg);
+            } else {
+                // Converted at boot, records are either in RAM or in flash
+                legacy_blob_present = true;
+            }
+            return 0;
+        }
+    }
+
+    // Invalid records are replaced with defaults, keep loading the rest
+    kb_settings_load_rec(ctx->slot, key, len, read_cb, cb_arg);
+
     return 0;
 }
 
-int kb_settings_handler_export(int (*export_func)(const char *name,
-                                                  const void *val,
-                                                  size_t val_len)) {
-    struct kb_settings_image img;
-    kb_settings_build_image_from_runtime(&img);
-    return export_func(KB_SETTINGS_ITEM, &img, sizeof(img));
+static int kb_settings_load_active_cb(const char *key, size_t len,
+                                      settings_read_cb read_cb, void *cb_arg,
+                                      void *param) {
+    uint8_t *profile = param;
+    const char *next;
+
+    if (!key || !settings_name_steq(key, KB_SETTINGS_REC_ACTIVE, &next) ||
+        next) {
+        return 0;
+    }
+
+    uint8_t value;
+    if (len != sizeof(value) ||
+        read_cb(cb_arg, &value, sizeof(value)) != sizeof(value)) {
+        LOG_ERR("Invalid active keyboard profile record");
+        return 0;
+    }
+    if (value >= CONFIG_KB_SETTINGS_PROFILE_COUNT) {
+        LOG_WRN("Active keyboard profile %u out of range", value);
+        return 0;
+    }
+
+    *profile = value;
+    return 0;
 }
 
-struct settings_handler settings_handler = {
-    .name = KB_SETTINGS_NS,
-    .h_set = kb_settings_handler_set,
-    .h_export = kb_settings_handler_export,
-};
+// Load 'profile' from flash into 'slot'.
+//
+// Missing or invalid records are replaced with defaults and scheduled to be
+// written.
+static void kb_settings_slot_load(struct kb_settings_slot *slot,
+                                  uint8_t profile) {
+    memset(&slot->settings, 0, sizeof(slot->settings));
+    slot->settings.profile = profile;
+    for (size_t i = 0; i < ARRAY_SIZE(slot->loaded); ++i) {
+        atomic_clear(&slot->loaded[i]);
+        atomic_clear(&slot->dirty[i]);
+    }
+
+    char subtree[sizeof(KB_SETTINGS_NS) + 5];
+    kb_settings_profile_subtree(profile, subtree, sizeof(subtree));
+
+    struct kb_settings_load_ctx ctx = {
+        .slot = slot,
+        .root = profile == 0,
+        .legacy = profile == 0 && !booted,
+    };
+    int err = settings_load_subtree_direct(subtree, kb_settings_load_cb, &ctx);
+    if (err) {
+        LOG_WRN("Unable to load keyboard profile %u (err=%d)", profile, err);
+    }
+
+    size_t missing = 0;
+    for (size_t idx = 0; idx < KB_SETTINGS_REC_COUNT; ++idx) {
+        if (!kb_settings_rec_exists(idx) ||
+            atomic_test_bit(slot->loaded, idx)) {
+            continue;
+        }
+        kb_settings_load_default_rec(slot, idx);
+        kb_settings_mark_rec_dirty(slot, idx);
+        missing++;
+    }
+    if (missing) {
+        LOG_WRN("%d keyboard profile %u records missing or invalid, defaults "
+                "loaded",
+                missing, profile);
+    }
+
+    kb_settings_update_tables(&slot->settings);
+}
+
+uint8_t kb_settings_profile_get() {
+    return kb_settings_active_slot()->settings.profile;
+}
+
+static inline uint8_t kb_settings_profile_after(uint8_t profile) {
+    return (profile + 1) % CONFIG_KB_SETTINGS_PROFILE_COUNT;
+}
+
+// Publish preloaded profile snapshot
+//
+// Should be called with 'settings_lock' held.
+static void kb_settings_profile_publish(struct kb_settings_slot *slot) {
+    kb_settings_publish(slot);
+    atomic_set(&active_dirty, 1);
+
+    LOG_INF("Keyboard profile %u active", slot->settings.profile);
+}
+
+// Runs on the persistence work queue: loads requested profile and preloads the
+// one after the active profile
+static void kb_settings_profile_work_handler(struct k_work *work) {
+    ARG_UNUSED(work);
+
+    k_mutex_lock(&settings_lock, K_FOREVER);
+
+    struct kb_settings_slot *active = kb_settings_active_slot();
+    atomic_val_t requested = atomic_set(&requested_profile, -1);
+    bool do_switch = requested >= 0 && requested != active->settings.profile;
+
+    uint8_t target = kb_settings_profile_after(active->settings.profile);
+    if (do_switch) {
+        target = requested;
+    }
+
+    struct kb_settings_slot *preload = kb_settings_slot_preload();
+    if (!preload || preload->settings.profile != target) {
+        // Newest snapshot of the target profile might still be in RAM
+        struct kb_settings_slot *slot = kb_settings_slot_find(target);
+        if (!slot) {
+            slot = kb_settings_slot_alloc();
+            if (!slot) {
+                // Wait for the scan loop to release a snapshot
+                if (do_switch) {
+                    atomic_cas(&requested_profile, -1, requested);
+                }
+                k_mutex_unlock(&settings_lock);
+                kb_settings_persist_submit(&profile_work, K_MSEC(1));
+                return;
+            }
+            kb_settings_slot_load(slot, target);
+            LOG_DBG("Keyboard profile %u preloaded", target);
+        }
+        if (preload) {
+            preload->state = KB_SETTINGS_SLOT_RETIRED;
+        }
+        slot->state = KB_SETTINGS_SLOT_PRELOAD;
+        preload = slot;
+    }
+
+    if (do_switch) {
+        kb_settings_profile_publish(preload);
+    }
+
+    k_mutex_unlock(&settings_lock);
+
+    if (do_switch) {
+        kb_settings_persist_mark_dirty(KB_SETTINGS_PERSIST_SECTION(kb));
+        kb_settings_notify_update(&preload->settings);
+        // Preload the profile after the new active one
+        kb_settings_persist_submit(&profile_work, K_NO_WAIT);
+    }
+}
+
+int kb_settings_profile_select(uint8_t profile) {
+    if (profile >= CONFIG_KB_SETTINGS_PROFILE_COUNT) {
+        return -EINVAL;
+    }
+
+    if (profile == kb_settings_profile_get()) {
+        return 0;
+    }
+
+    // Might be called from the scan loop, never wait for the lock here
+    if (k_mutex_lock(&settings_lock, K_NO_WAIT) == 0) {
+        struct kb_settings_slot *preload = kb_settings_slot_preload();
+        if (preload && preload->settings.profile == profile) {
+            // Preloaded already, switch right away
+            kb_settings_profile_publish(preload);
+            k_mutex_unlock(&settings_lock);
+
+            kb_settings_persist_mark_dirty(KB_SETTINGS_PERSIST_SECTION(kb));
+            kb_settings_notify_update(&preload->settings);
+            kb_settings_persist_submit(&profile_work, K_NO_WAIT);
+            return 0;
+        }
+        k_mutex_unlock(&settings_lock);
+    }
+
+    // Load it in the background first
+    atomic_set(&requested_profile, profile);
+    kb_settings_persist_submit(&profile_work, K_NO_WAIT);
+
+    return 0;
+}
+
+void kb_settings_profile_next() {
+    kb_settings_profile_select(
+        kb_settings_profile_after(kb_settings_profile_get()));
+}
+
+void kb_settings_profile_prev() {
+    uint8_t profile = kb_settings_profile_get();
+    kb_settings_profile_select(profile ? profile - 1
+                                       : CONFIG_KB_SETTINGS_PROFILE_COUNT - 1);
+}
 
 int kb_settings_init() {
     int err;
+    uint8_t profile = 0;
 
-    s_loaded_ok = false;
-
-    err = settings_subsys_init();
+    err = kb_settings_persist_init();
     if (err) {
-        LOG_ERR("settings_subsys_init err %d", err);
-        goto load_defaults;
+        LOG_ERR("kb_settings_persist_init err %d", err);
+        return err;
     }
 
-    err = settings_register(&settings_handler);
+    k_work_init_delayable(&profile_work, kb_settings_profile_work_handler);
+
+    err = settings_subsys_init();
     if (err) {
-        LOG_ERR("settings_register failed: %d", err);
-        goto load_defaults;
+        LOG_ERR("settings_subsys_init err %d", err);
+    } else {
+        err = settings_load_subtree_direct(
+            KB_SETTINGS_NS, kb_settings_load_active_cb, &profile);
+        if (err) {
+            LOG_WRN("Unable to load active keyboard profile (err=%d)", err);
+        }
     }
 
-    err = settings_load_subtree(KB_SETTINGS_NS);
+    k_mutex_lock(&settings_lock, K_FOREVER);
 
-    if (!s_loaded_ok) {
-        LOG_WRN("No valid keyboard settings found (err=%d) — loading defaults",
-                err);
-        goto load_defaults;
-    }
+    // Falls back to defaults if settings are not available
+    kb_settings_slot_load(&slots[0], profile);
+    kb_settings_publish(&slots[0]);
+    atomic_ptr_set(&scan_slot, &slots[0]);
+    booted = true;
 
-    return 0;
+    k_mutex_unlock(&settings_lock);
 
-load_defaults:
+    kb_settings_migrate_report();
+    kb_settings_notify_update(&slots[0].settings);
 
-    kb_settings_load_default();
-    kb_settings_save();
+    if (CONFIG_KB_SETTINGS_PROFILE_COUNT > 1) {
+        kb_settings_persist_submit(&profile_work, K_NO_WAIT);
+    }
 
     return 0;
 }
@@ -0,0 +1,82 @@
+#include <lib/keyboard/kb_settings_migrate.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <errno.h>
+#include <stdint.h>
+
+LOG_MODULE_DECLARE(kb_settings, CONFIG_KB_SETTINGS_LOG_LEVEL);
+
+// Cycles spent in migrations since boot
+static uint64_t migrate_cycles = 0;
+
+static const struct kb_settings_migration *
+kb_settings_migration_find(enum kb_settings_rec_kind kind,
+                           uint16_t from_version) {
+    STRUCT_SECTION_FOREACH(kb_settings_migration, migration) {
+        if (migration->kind == kind &&
+            migration->from_version == from_version) {
+            return migration;
+        }
+    }
+    return NULL;
+}
+
+int kb_settings_migrate(enum kb_settings_rec_kind kind, uint16_t *version,
+                        uint16_t to_version, uint8_t *payload, uint16_t *size,
+                        size_t buf_size) {
+    while (*version < to_version) {
+        const struct kb_settings_migration *migration =
+            kb_settings_migration_find(kind, *version);
+        if (!migration) {
+            LOG_ERR("No migration for settings record kind %d from version %u",
+                    kind, *version);
+            return -ENOENT;
+        }
+
+        uint32_t start = k_cycle_get_32();
+        int res = migration->migrate(payload, *size, buf_size);
+        uint32_t cycles = k_cycle_get_32() - start;
+        kb_settings_migrate_account(cycles);
+
+        if (res < 0 || res > UINT16_MAX) {
+            LOG_ERR("Settings record kind %d migration from version %u "
+                    "failed: %d",
+                    kind, *version, res);
+            return res < 0 ? res : -EINVAL;
+        }
+
+        LOG_INF("Settings record kind %d migrated from version %u to %u "
+                "(%u us)",
+                kind, *version, *version + 1, k_cyc_to_us_ceil32(cycles));
+
+        *size = (uint16_t)res;
+        (*version)++;
+    }
+
+    return 0;
+}
+
+void kb_settings_migrate_account(uint32_t cycles) {
+    migrate_cycles += cycles;
+}
+
+uint32_t kb_settings_migrate_time_us() {
+    return (uint32_t)k_cyc_to_us_ceil64(migrate_cycles);
+}
+
+void kb_settings_migrate_report() {
+    if (!migrate_cycles) {
+        return;
+    }
+
+    uint32_t us = kb_settings_migrate_time_us();
+    if (us > CONFIG_KB_SETTINGS_MIGRATION_BUDGET_MS * USEC_PER_MSEC) {
+        LOG_WRN("Settings migrations took %u us, over the %d ms budget", us,
+                CONFIG_KB_SETTINGS_MIGRATION_BUDGET_MS);
+        return;
+    }
+
+    LOG_INF("Settings migrations took %u us", us);
+}
@@ -0,0 +1,140 @@
+#include <lib/keyboard/kb_settings_persist.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/spinlock.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+LOG_MODULE_DECLARE(kb_settings, CONFIG_KB_SETTINGS_LOG_LEVEL);
+
+// Failed flushes are retried with the delay doubled every time, until this
+// many attempts failed. Sections stay dirty and are retried on the next change.
+#define KB_SETTINGS_PERSIST_RETRY_COUNT 6
+
+static K_THREAD_STACK_DEFINE(kb_persist_stack,
+                             CONFIG_KB_SETTINGS_PERSIST_STACK_SIZE);
+static struct k_work_q kb_persist_q;
+
+static struct k_work_delayable kb_persist_work;
+
+static struct k_spinlock lock;
+
+// Failed flushes in a row, only used by the work queue
+static uint8_t failures = 0;
+
+// Uptime of the first change since the last flush (-1 when clean)
+static int64_t first_dirty_time = -1;
+
+static bool started = false;
+
+static void kb_settings_persist_schedule(void) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    int64_t now = k_uptime_get();
+    if (first_dirty_time < 0) {
+        first_dirty_time = now;
+    }
+
+    // Postpone the flush while changes keep coming in,
+    // but never beyond the max delay since the first change
+    int64_t elapsed = now - first_dirty_time;
+    int64_t delay = CONFIG_KB_SETTINGS_PERSIST_DELAY_MS;
+    if (elapsed + delay > CONFIG_KB_SETTINGS_PERSIST_MAX_DELAY_MS) {
+        delay = MAX(CONFIG_KB_SETTINGS_PERSIST_MAX_DELAY_MS - elapsed, 0);
+    }
+
+    bool can_schedule = started;
+
+    k_spin_unlock(&lock, key);
+
+    if (can_schedule) {
+        k_work_reschedule_for_queue(&kb_persist_q, &kb_persist_work,
+                                    K_MSEC(delay));
+    }
+}
+
+static void kb_settings_persist_handler(struct k_work *work) {
+    ARG_UNUSED(work);
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    first_dirty_time = -1;
+    k_spin_unlock(&lock, key);
+
+    bool failed = false;
+
+    STRUCT_SECTION_FOREACH(kb_settings_persist_section, section) {
+        if (!atomic_cas(section->dirty, 1, 0)) {
+            continue;
+        }
+        int err = section->store();
+        if (err) {
+            LOG_WRN("Could not persist settings section '%s' (err %d)",
+                    section->name, err);
+            atomic_set(section->dirty, 1);
+            failed = true;
+        } else {
+            LOG_DBG("Persisted settings section '%s'", section->name);
+        }
+    }
+
+    if (!failed) {
+        failures = 0;
+        return;
+    }
+
+    if (++failures >= KB_SETTINGS_PERSIST_RETRY_COUNT) {
+        LOG_ERR("Giving up persisting settings after %u attempts", failures);
+        failures = 0;
+        return;
+    }
+
+    int64_t delay = (int64_t)CONFIG_KB_SETTINGS_PERSIST_DELAY_MS << failures;
+    k_work_reschedule_for_queue(&kb_persist_q, &kb_persist_work,
+                                K_MSEC(delay));
+}
+
+void kb_settings_persist_mark_dirty(
+    const struct kb_settings_persist_section *section) {
+    atomic_set(section->dirty, 1);
+    kb_settings_persist_schedule();
+}
+
+void kb_settings_persist_submit(struct k_work_delayable *work,
+                                k_timeout_t delay) {
+    k_work_reschedule_for_queue(&kb_persist_q, work, delay);
+}
+
+bool kb_settings_persist_pending() {
+    STRUCT_SECTION_FOREACH(kb_settings_persist_section, section) {
+        if (atomic_get(section->dirty)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int kb_settings_persist_init() {
+    if (started) {
+        return 0;
+    }
+
+    k_work_init_delayable(&kb_persist_work, kb_settings_persist_handler);
+
+    k_work_queue_start(&kb_persist_q, kb_persist_stack,
+                       K_THREAD_STACK_SIZEOF(kb_persist_stack),
+                       K_PRIO_PREEMPT(CONFIG_KB_SETTINGS_PERSIST_PRIO), NULL);
+    k_thread_name_set(&kb_persist_q.thread, "kb_persist");
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    started = true;
+    k_spin_unlock(&lock, key);
+
+    // Something could have been marked dirty before we started
+    if (kb_settings_persist_pending()) {
+        kb_settings_persist_schedule();
+    }
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include <lib/keyboard/kb_stats.h>
+
+#if CONFIG_KB_STATS_HID
+#include <lib/connect/usb_connect_vendor.h>
+#endif // CONFIG_KB_STATS_HID
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(kb_stats, CONFIG_KB_STATS_LOG_LEVEL);
+
+#define BUCKETS CONFIG_KB_STATS_HIST_BUCKETS
+
+struct kb_stats_hist {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[BUCKETS];
+};
+
+static const uint32_t bucket_widths[KB_STATS_HIST_COUNT] = {
+    [KB_STATS_INTERVAL] = CONFIG_KB_STATS_INTERVAL_BUCKET_US,
+    [KB_STATS_DURATION] = CONFIG_KB_STATS_DURATION_BUCKET_US,
+};
+
+static struct kb_stats_hist hists[KB_STATS_HIST_COUNT];
+
+static struct k_spinlock lock;
+
+// Only touched by the scan loop
+static uint32_t scan_start;
+static bool scan_prev = false;
+static bool scan_open = false;
+
+static void hist_add(enum kb_stats_hist_id id, uint32_t us) {
+    struct kb_stats_hist *hist = &hists[id];
+    uint32_t bucket = MIN(us / bucket_widths[id], BUCKETS - 1);
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    hist->buckets[bucket]++;
+    hist->min_us = hist->count ? MIN(hist->min_us, us) : us;
+    hist->max_us = MAX(hist->max_us, us);
+    hist->sum_us += us;
+    hist->count++;
+    k_spin_unlock(&lock, key);
+}
+
+void kb_stats_scan_begin() {
+    uint32_t now = k_cycle_get_32();
+
+    if (scan_prev) {
+        hist_add(KB_STATS_INTERVAL, k_cyc_to_us_floor32(now - scan_start));
+    }
+
+    scan_start = now;
+    scan_prev = true;
+    scan_open = true;
+}
+
+void kb_stats_scan_end() {
+    if (!scan_open) {
+        return;
+    }
+    scan_open = false;
+
+    hist_add(KB_STATS_DURATION,
+             k_cyc_to_us_floor32(k_cycle_get_32() - scan_start));
+}
+
+void kb_stats_reset() {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    memset(hists, 0, sizeof(hists));
+    k_spin_unlock(&lock, key);
+}
+
+void kb_stats_summary_get(enum kb_stats_hist_id id,
+                          struct kb_stats_summary *summary) {
+    struct kb_stats_hist hist;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    hist = hists[id];
+    k_spin_unlock(&lock, key);
+
+    memset(summary, 0, sizeof(*summary));
+    if (hist.count == 0) {
+        return;
+    }
+
+    summary->count = hist.count;
+    summary->min_us = hist.min_us;
+    summary->avg_us = (uint32_t)(hist.sum_us / hist.count);
+    summary->max_us = hist.max_us;
+
+    uint32_t target = hist.count - hist.count / 100;
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < BUCKETS; ++i) {
+        seen += hist.buckets[i];
+        if (seen >= target) {
+            uint32_t upper = (i + 1) * bucket_widths[id] - 1;
+            summary->p99_us = i == BUCKETS - 1 ? hist.max_us
+                                               : MIN(upper, hist.max_us);
+            break;
+        }
+    }
+}
+
+uint32_t kb_stats_hist_get(enum kb_stats_hist_id id,
+                           uint32_t buckets[CONFIG_KB_STATS_HIST_BUCKETS]) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    memcpy(buckets, hists[id].buckets, sizeof(hists[id].buckets));
+    k_spin_unlock(&lock, key);
+
+    return bucket_widths[id];
+}
+
+static uint16_t permille(uint64_t part, uint64_t total) {
+    return total ? (uint16_t)MIN((part * 1000u) / total, 1000u) : 0;
+}
+
+uint16_t kb_stats_thread_load(k_tid_t thread) {
+    k_thread_runtime_stats_t stats;
+    if (k_thread_runtime_stats_get(thread, &stats)) {
+        return 0;
+    }
+    return permille(stats.execution_cycles,
+                    k_ticks_to_cyc_floor64(k_uptime_ticks()));
+}
+
+uint16_t kb_stats_cpu_load() {
+    k_thread_runtime_stats_t stats;
+    if (k_thread_runtime_stats_all_get(&stats)) {
+        return 0;
+    }
+    // 'execution_cycles' include idle ones for the whole system
+    return permille(stats.total_cycles, stats.execution_cycles);
+}
+
+#if CONFIG_KB_STATS_HID
+
+struct thread_load_ctx {
+    uint16_t kb_thread;
+    uint16_t kb_bl_thread;
+};
+
+static void thread_load_cb(const struct k_thread *thread, void *user_data) {
+    struct thread_load_ctx *ctx = user_data;
+    k_tid_t tid = (k_tid_t)thread;
+    const char *name = k_thread_name_get(tid);
+
+    if (!name) {
+        return;
+    }
+    if (!strcmp(name, "kb_thread")) {
+        ctx->kb_thread = kb_stats_thread_load(tid);
+    } else if (!strcmp(name, "kb_bl_thread")) {
+        ctx->kb_bl_thread = kb_stats_thread_load(tid);
+    }
+}
+
+static uint8_t *put_summary(enum kb_stats_hist_id id, uint8_t *buf) {
+    struct kb_stats_summary summary;
+    kb_stats_summary_get(id, &summary);
+
+    sys_put_le32(summary.count, &buf[0]);
+    sys_put_le32(summary.min_us, &buf[4]);
+    sys_put_le32(summary.avg_us, &buf[8]);
+    sys_put_le32(summary.max_us, &buf[12]);
+    sys_put_le32(summary.p99_us, &buf[16]);
+
+    return buf + 20;
+}
+
+static void kb_stats_hid_report(uint8_t *buf, uint16_t len) {
+    BUILD_ASSERT(USB_CONNECT_VENDOR_REPORT_SIZE >= 48,
+                 "Stats do not fit into the vendor report");
+
+    struct thread_load_ctx ctx = {0};
+    k_thread_foreach_unlocked(thread_load_cb, &ctx);
+
+    buf[0] = KB_STATS_REPORT_VERSION;
+    sys_put_le16(kb_stats_cpu_load(), &buf[2]);
+    sys_put_le16(ctx.kb_thread, &buf[4]);
+    sys_put_le16(ctx.kb_bl_thread, &buf[6]);
+
+    uint8_t *next = put_summary(KB_STATS_INTERVAL, &buf[8]);
+    put_summary(KB_STATS_DURATION, next);
+}
+
+#endif // CONFIG_KB_STATS_HID
+
+int kb_stats_init() {
+#if CONFIG_KB_STATS_HID
+    int err = usb_connect_vendor_set_feature_cb(
+        USB_CONNECT_VENDOR_REPORT_STATS, kb_stats_hid_report);
+    if (err) {
+        LOG_ERR("Unable to set stats feature report (err %d)", err);
+        return err;
+    }
+#endif // CONFIG_KB_STATS_HID
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <lib/keyboard/kb_stats.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#define HIST_BAR_WIDTH 40
+
+static const char *const hist_names[KB_STATS_HIST_COUNT] = {
+    [KB_STATS_INTERVAL] = "interval",
+    [KB_STATS_DURATION] = "duration",
+};
+
+static int cmd_scan(const struct shell *sh, size_t argc, char **argv) {
+    for (int i = 0; i < KB_STATS_HIST_COUNT; ++i) {
+        struct kb_stats_summary s;
+        kb_stats_summary_get(i, &s);
+        shell_print(sh, "%-8s n=%u min=%u avg=%u max=%u p99=%u us",
+                    hist_names[i], s.count, s.min_us, s.avg_us, s.max_us,
+                    s.p99_us);
+    }
+    return 0;
+}
+
+static int cmd_hist(const struct shell *sh, size_t argc, char **argv) {
+    int id = -1;
+    for (int i = 0; i < KB_STATS_HIST_COUNT; ++i) {
+        if (!strcmp(argv[1], hist_names[i])) {
+            id = i;
+        }
+    }
+    if (id < 0) {
+        shell_error(sh, "Unknown histogram %s", argv[1]);
+        return -EINVAL;
+    }
+
+    static uint32_t buckets[CONFIG_KB_STATS_HIST_BUCKETS];
+    uint32_t width = kb_stats_hist_get(id, buckets);
+
+    uint32_t top = 0;
+    for (int i = 0; i < CONFIG_KB_STATS_HIST_BUCKETS; ++i) {
+        top = MAX(top, buckets[i]);
+    }
+    if (top == 0) {
+        shell_print(sh, "No samples");
+        return 0;
+    }
+
+    for (int i = 0; i < CONFIG_KB_STATS_HIST_BUCKETS; ++i) {
+        if (buckets[i] == 0) {
+            continue;
+        }
+        char bar[HIST_BAR_WIDTH + 1];
+        size_t len = DIV_ROUND_UP(buckets[i] * HIST_BAR_WIDTH, top);
+        memset(bar, '#', len);
+        bar[len] = '\0';
+        shell_print(sh, "%6u%s us | %s %u", i * width,
+                    i == CONFIG_KB_STATS_HIST_BUCKETS - 1 ? "+" : " ", bar,
+                    buckets[i]);
+    }
+    return 0;
+}
+
+static void thread_cb(const struct k_thread *thread, void *user_data) {
+    const struct shell *sh = user_data;
+    k_tid_t tid = (k_tid_t)thread;
+    const char *name = k_thread_name_get(tid);
+    uint16_t load = kb_stats_thread_load(tid);
+
+    shell_print(sh, "%-24s %3u.%u%%", name && name[0] ? name : "(unnamed)",
+                load / 10, load % 10);
+}
+
+static int cmd_threads(const struct shell *sh, size_t argc, char **argv) {
+    uint16_t load = kb_stats_cpu_load();
+
+    shell_print(sh, "CPU load since boot %u.%u%%", load / 10, load % 10);
+    k_thread_foreach_unlocked(thread_cb, (void *)sh);
+    return 0;
+}
+
+static int cmd_reset(const struct shell *sh, size_t argc, char **argv) {
+    kb_stats_reset();
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+    sub_kb_stats,
+    SHELL_CMD(scan, NULL, "Scan interval and duration summary", cmd_scan),
+    SHELL_CMD_ARG(hist, NULL, "Histogram <interval|duration>", cmd_hist, 2,
+                  0),
+    SHELL_CMD(threads, NULL, "Thread CPU load since boot", cmd_threads),
+    SHELL_CMD(reset, NULL, "Reset scan statistics", cmd_reset),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(kb_stats, &sub_kb_stats, "Keyboard scan loop statistics",
+                   NULL);
@@ -0,0 +1,141 @@
+#include <lib/keyboard/kb_trace.h>
+
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include <errno.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(kb_trace, CONFIG_KB_TRACE_LOG_LEVEL);
+
+int kb_trace_encoder_init(struct kb_trace_encoder *enc, uint16_t key_count,
+                          uint8_t *buf, size_t len) {
+    if (key_count == 0 || key_count > KB_TRACE_MAX_KEYS) {
+        return -EINVAL;
+    }
+    if (len < KB_TRACE_HEADER_SIZE) {
+        return -ENOMEM;
+    }
+
+    enc->key_count = key_count;
+    enc->keyframe = true;
+
+    memcpy(buf, KB_TRACE_MAGIC, 4);
+    buf[4] = KB_TRACE_VERSION;
+    buf[5] = 0;
+    sys_put_le16(key_count, &buf[6]);
+
+    return KB_TRACE_HEADER_SIZE;
+}
+
+int kb_trace_encode(struct kb_trace_encoder *enc, uint32_t dt_us,
+                    const uint16_t *values, uint8_t *buf, size_t len) {
+    const size_t mask_size = KB_TRACE_MASK_SIZE(enc->key_count);
+    uint8_t mask[KB_TRACE_MASK_SIZE(KB_TRACE_MAX_KEYS)] = {0};
+    size_t changed = 0;
+
+    for (uint16_t i = 0; i < enc->key_count; ++i) {
+        if (enc->keyframe || values[i] != enc->prev[i]) {
+            mask[i / 8] |= BIT(i % 8);
+            changed++;
+        }
+    }
+
+    uint8_t dt[5];
+    size_t dt_size = 0;
+    do {
+        dt[dt_size] = dt_us & 0x7f;
+        dt_us >>= 7;
+        if (dt_us) {
+            dt[dt_size] |= 0x80;
+        }
+        dt_size++;
+    } while (dt_us);
+
+    size_t size = dt_size + mask_size + 2 * changed;
+    if (size > len) {
+        enc->keyframe = true;
+        return -ENOMEM;
+    }
+
+    memcpy(buf, dt, dt_size);
+    memcpy(buf + dt_size, mask, mask_size);
+    uint8_t *out = buf + dt_size + mask_size;
+    for (uint16_t i = 0; i < enc->key_count; ++i) {
+        if (mask[i / 8] & BIT(i % 8)) {
+            sys_put_le16(values[i], out);
+            out += 2;
+            enc->prev[i] = values[i];
+        }
+    }
+    enc->keyframe = false;
+
+    return size;
+}
+
+int kb_trace_decoder_init(struct kb_trace_decoder *dec, const uint8_t *data,
+                          size_t len) {
+    if (len < KB_TRACE_HEADER_SIZE || memcmp(data, KB_TRACE_MAGIC, 4)) {
+        return -EINVAL;
+    }
+    if (data[4] != KB_TRACE_VERSION) {
+        return -ENOTSUP;
+    }
+    uint16_t key_count = sys_get_le16(&data[6]);
+    if (key_count == 0 || key_count > KB_TRACE_MAX_KEYS) {
+        return -EINVAL;
+    }
+
+    dec->data = data;
+    dec->len = len;
+    dec->pos = KB_TRACE_HEADER_SIZE;
+    dec->key_count = key_count;
+    dec->time_us = 0;
+    memset(dec->values, 0, sizeof(dec->values));
+
+    return 0;
+}
+
+int kb_trace_decode(struct kb_trace_decoder *dec) {
+    const size_t mask_size = KB_TRACE_MASK_SIZE(dec->key_count);
+    size_t pos = dec->pos;
+
+    if (pos == dec->len) {
+        return 0;
+    }
+
+    uint32_t dt_us = 0;
+    for (int shift = 0;; shift += 7) {
+        if (pos == dec->len || shift > 28) {
+            return -EBADMSG;
+        }
+        uint8_t byte = dec->data[pos++];
+        dt_us |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+
+    if (dec->len - pos < mask_size) {
+        return -EBADMSG;
+    }
+    const uint8_t *mask = &dec->data[pos];
+    pos += mask_size;
+
+    for (uint16_t i = 0; i < dec->key_count; ++i) {
+        if (!(mask[i / 8] & BIT(i % 8))) {
+            continue;
+        }
+        if (dec->len - pos < 2) {
+            return -EBADMSG;
+        }
+        dec->values[i] = sys_get_le16(&dec->data[pos]);
+        pos += 2;
+    }
+
+    dec->pos = pos;
+    dec->time_us += dt_us;
+
+    return 1;
+}
@@ -0,0 +1,139 @@
+#include <lib/keyboard/kb_mappings.h>
+#include <lib/keyboard/kb_trace.h>
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+LOG_MODULE_DECLARE(kb_trace, CONFIG_KB_TRACE_LOG_LEVEL);
+
+BUILD_ASSERT(CONFIG_KB_KEY_COUNT <= KB_TRACE_MAX_KEYS,
+             "Too many keys for the trace format");
+
+static const struct device *uart = DEVICE_DT_GET(DT_CHOSEN(ykb_trace));
+
+// Encoded trace waiting to be streamed, filled by the keyboard thread
+// and drained by the UART ISR
+RING_BUF_DECLARE(trace_rb, CONFIG_KB_TRACE_RECORD_BUF_SIZE);
+
+static struct kb_trace_encoder enc;
+
+static bool recording = false;
+static bool has_dtr = true;
+static uint32_t last_cycle;
+static uint32_t dropped = 0;
+
+static void kb_trace_uart_isr(const struct device *dev, void *user_data) {
+    ARG_UNUSED(user_data);
+
+    while (uart_irq_update(dev) && uart_irq_is_pending(dev)) {
+        if (!uart_irq_tx_ready(dev)) {
+            continue;
+        }
+
+        uint8_t *data;
+        uint32_t len = ring_buf_get_claim(&trace_rb, &data, UINT32_MAX);
+        if (len == 0) {
+            uart_irq_tx_disable(dev);
+            break;
+        }
+
+        int sent = uart_fifo_fill(dev, data, len);
+        ring_buf_get_finish(&trace_rb, MAX(sent, 0));
+    }
+}
+
+// Host side is listening if it asserted DTR or there is no DTR at all
+static bool kb_trace_host_ready() {
+    if (!has_dtr) {
+        return true;
+    }
+
+    uint32_t dtr = 0;
+    int err = uart_line_ctrl_get(uart, UART_LINE_CTRL_DTR, &dtr);
+    if (err == -ENOSYS || err == -ENOTSUP) {
+        has_dtr = false;
+        return true;
+    }
+    return !err && dtr;
+}
+
+static bool kb_trace_put(const uint8_t *data, size_t len) {
+    if (ring_buf_space_get(&trace_rb) < len) {
+        return false;
+    }
+    ring_buf_put(&trace_rb, data, len);
+    uart_irq_tx_enable(uart);
+    return true;
+}
+
+static void kb_trace_record_start() {
+    uint8_t header[KB_TRACE_HEADER_SIZE];
+    int res = kb_trace_encoder_init(&enc, CONFIG_KB_KEY_COUNT, header,
+                                    sizeof(header));
+    if (res < 0 || !kb_trace_put(header, res)) {
+        LOG_ERR("Unable to start trace recording (err %d)", res);
+        return;
+    }
+
+    last_cycle = k_cycle_get_32();
+    dropped = 0;
+    recording = true;
+    LOG_INF("Trace recording started");
+}
+
+static void kb_trace_record_stop() {
+    recording = false;
+    // Anything left belongs to a trace nobody listens to anymore
+    ring_buf_reset(&trace_rb);
+    LOG_INF("Trace recording stopped (%u frames dropped)", dropped);
+}
+
+int kb_trace_record_init() {
+    if (!device_is_ready(uart)) {
+        LOG_ERR("Trace UART is not ready");
+        return -ENODEV;
+    }
+
+    int err = uart_irq_callback_user_data_set(uart, kb_trace_uart_isr, NULL);
+    if (err) {
+        LOG_ERR("Unable to set trace UART callback (err %d)", err);
+        return err;
+    }
+
+    return 0;
+}
+
+void kb_trace_record(const uint16_t *values) {
+    bool host_ready = kb_trace_host_ready();
+    if (!recording) {
+        if (host_ready) {
+            kb_trace_record_start();
+        }
+        return;
+    }
+    if (!host_ready) {
+        kb_trace_record_stop();
+        return;
+    }
+
+    uint32_t now = k_cycle_get_32();
+    uint32_t dt_us = k_cyc_to_us_floor32(now - last_cycle);
+
+    uint8_t frame[KB_TRACE_FRAME_MAX_SIZE(CONFIG_KB_KEY_COUNT)];
+    size_t space = MIN(sizeof(frame), ring_buf_space_get(&trace_rb));
+    int len = kb_trace_encode(&enc, dt_us, values, frame, space);
+    if (len < 0) {
+        // Not enough space, the next frame carries all values again
+        dropped++;
+        return;
+    }
+
+    kb_trace_put(frame, len);
+    last_cycle = now;
+}
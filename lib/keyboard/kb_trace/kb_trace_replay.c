@@ -0,0 +1,156 @@
+#include <lib/keyboard/kb_autocal.h>
+#include <lib/keyboard/kb_mappings.h>
+#include <lib/keyboard/kb_settings.h>
+#include <lib/keyboard/kb_trace.h>
+
+#include <drivers/kscan_emul.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/printk.h>
+
+#if CONFIG_KB_TRACE_REPLAY_EXIT
+#include <nsi_main.h>
+#endif // CONFIG_KB_TRACE_REPLAY_EXIT
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+LOG_MODULE_DECLARE(kb_trace, CONFIG_KB_TRACE_LOG_LEVEL);
+
+static const uint8_t trace_data[] = {
+#include "kb_trace_replay.inc"
+};
+
+static struct kb_trace_decoder dec;
+
+static bool done = false;
+static uint32_t frames = 0;
+static uint32_t reports = 0;
+
+// Reference detection: a key is down while its raw value is at or above
+// its threshold. Latency is measured from the reference edge to the first
+// HID report sent after it.
+static bool ref_down[CONFIG_KB_KEY_COUNT];
+static bool pending[CONFIG_KB_KEY_COUNT];
+static uint32_t onset_us[CONFIG_KB_KEY_COUNT];
+
+static uint32_t events = 0;
+static uint32_t unreported = 0;
+static uint64_t latency_sum_us = 0;
+static uint32_t latency_max_us = 0;
+
+static void kb_trace_replay_finish() {
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
+        if (pending[i]) {
+            pending[i] = false;
+            unreported++;
+        }
+    }
+
+    uint32_t reported = events - unreported;
+    printk("replay done: frames=%u reports=%u events=%u unreported=%u "
+           "latency_avg_us=%u latency_max_us=%u\n",
+           frames, reports, events, unreported,
+           reported ? (uint32_t)(latency_sum_us / reported) : 0,
+           latency_max_us);
+
+#if CONFIG_KB_TRACE_REPLAY_EXIT
+    nsi_exit(0);
+#endif // CONFIG_KB_TRACE_REPLAY_EXIT
+}
+
+static void kb_trace_replay_track(const uint16_t *values) {
+    // Runs from the kscan poll of the scan loop, so these are the
+    // thresholds the poll compares against
+    const kb_settings_t *settings = kb_settings_get();
+    const uint16_t *thresholds = kb_autocal_thresholds(settings);
+
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
+        bool down = values[i] >= thresholds[i];
+        if (down == ref_down[i]) {
+            continue;
+        }
+        ref_down[i] = down;
+        if (pending[i]) {
+            // Previous edge never made it into a report
+            unreported++;
+        }
+        pending[i] = true;
+        onset_us[i] = dec.time_us;
+        events++;
+    }
+
+    kb_settings_put(settings);
+}
+
+static void kb_trace_replay_source(const struct device *dev, uint16_t *values,
+                                   size_t count, void *user_data) {
+    ARG_UNUSED(dev);
+    ARG_UNUSED(user_data);
+
+    if (done) {
+        return;
+    }
+
+    int res = kb_trace_decode(&dec);
+    if (res <= 0) {
+        if (res < 0) {
+            LOG_ERR("Malformed trace at offset %u (err %d)",
+                    (unsigned)dec.pos, res);
+        }
+        done = true;
+        kb_trace_replay_finish();
+        return;
+    }
+
+    frames++;
+    memcpy(values, dec.values, MIN(count, dec.key_count) * sizeof(values[0]));
+    kb_trace_replay_track(dec.values);
+}
+
+int kb_trace_replay_start(const struct device *kscan) {
+    int err = kb_trace_decoder_init(&dec, trace_data, sizeof(trace_data));
+    if (err) {
+        LOG_ERR("Invalid replay trace (err %d)", err);
+        return err;
+    }
+
+    if (dec.key_count != kscan_emul_key_count(kscan) ||
+        dec.key_count != CONFIG_KB_KEY_COUNT) {
+        LOG_WRN("Trace has %u keys, keyboard has %u", dec.key_count,
+                CONFIG_KB_KEY_COUNT);
+    }
+
+    LOG_INF("Replaying %u bytes trace", (unsigned)sizeof(trace_data));
+
+    return kscan_emul_set_source(kscan, kb_trace_replay_source, NULL);
+}
+
+void kb_trace_replay_on_report(const uint8_t *report, uint8_t report_size) {
+    if (done) {
+        return;
+    }
+
+    reports++;
+
+    printk("report %u", dec.time_us);
+    for (uint8_t i = 0; i < report_size; ++i) {
+        printk(" %02x", report[i]);
+    }
+    printk("\n");
+
+    for (size_t i = 0; i < CONFIG_KB_KEY_COUNT; ++i) {
+        if (!pending[i]) {
+            continue;
+        }
+        pending[i] = false;
+
+        uint32_t latency = dec.time_us - onset_us[i];
+        latency_sum_us += latency;
+        latency_max_us = MAX(latency_max_us, latency);
+        printk("event %u %s onset_us=%u latency_us=%u\n", (unsigned)i,
+               ref_down[i] ? "press" : "release", onset_us[i], latency);
+    }
+}
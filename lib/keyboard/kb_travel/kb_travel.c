@@ -0,0 +1,70 @@
+#include <lib/keyboard/kb_travel.h>
+
+#include "kb_travel_profiles.h"
+
+#include <zephyr/sys/util.h>
+#include <zephyr/toolchain.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+BUILD_ASSERT(KB_TRAVEL_PROFILES_LUT_BITS == KB_TRAVEL_LUT_BITS,
+             "kb_travel_profiles.h is out of date, run "
+             "scripts/kb_travel_lut.py");
+
+#if CONFIG_KB_TRAVEL_PROFILE_MAGNETIC_4MM
+#define KB_TRAVEL_PROFILE MAGNETIC_4MM
+#elif CONFIG_KB_TRAVEL_PROFILE_MAGNETIC_3_5MM
+#define KB_TRAVEL_PROFILE MAGNETIC_3_5MM
+#elif CONFIG_KB_TRAVEL_PROFILE_LINEAR_4MM
+#define KB_TRAVEL_PROFILE LINEAR_4MM
+#endif
+
+#define KB_TRAVEL_PROFILE_MACRO(suffix)                                        \
+    UTIL_CAT(UTIL_CAT(KB_TRAVEL_PROFILE_, KB_TRAVEL_PROFILE), suffix)
+
+BUILD_ASSERT(KB_TRAVEL_PROFILE_MACRO(_TOTAL) == CONFIG_KB_TRAVEL_TOTAL,
+             "CONFIG_KB_TRAVEL_TOTAL does not match the switch profile");
+
+const uint16_t kb_travel_lut[KB_TRAVEL_LUT_SIZE + 1] =
+    KB_TRAVEL_PROFILE_MACRO(_LUT);
+
+void kb_travel_key_init(kb_travel_key_t *key, uint16_t minimum,
+                        uint16_t maximum) {
+    key->minimum = minimum;
+    key->maximum = maximum;
+    key->scale = maximum > minimum
+                     ? (KB_TRAVEL_LUT_SIZE << 16) / (maximum - minimum)
+                     : 0;
+}
+
+uint16_t kb_travel_to_value(uint16_t minimum, uint16_t maximum,
+                            uint16_t travel) {
+    if (maximum <= minimum || travel == 0) {
+        return minimum;
+    }
+    if (travel >= KB_TRAVEL_MAX) {
+        return maximum;
+    }
+
+    // Last LUT entry not past 'travel', the LUT is increasing
+    size_t lo = 0;
+    size_t hi = KB_TRAVEL_LUT_SIZE;
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (kb_travel_lut[mid] <= travel) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    // LUT position with 8 fractional bits
+    uint32_t step = kb_travel_lut[lo + 1] - kb_travel_lut[lo];
+    uint32_t frac = step ? ((travel - kb_travel_lut[lo]) << 8) / step : 0;
+    uint32_t pos = (lo << 8) + frac;
+
+    uint32_t span = maximum - minimum;
+    return minimum + (uint16_t)((pos * span + (KB_TRAVEL_LUT_SIZE << 7)) >>
+                                (KB_TRAVEL_LUT_BITS + 8));
+}
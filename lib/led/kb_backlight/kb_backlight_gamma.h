@@ -0,0 +1,660 @@
+// Generated by scripts/kb_backlight_gamma_lut.py, do not edit
+
+#ifndef LIB_KB_BACKLIGHT_GAMMA_H_
+#define LIB_KB_BACKLIGHT_GAMMA_H_
+
+#define KB_BACKLIGHT_GAMMA_LUT_BITS 8
+#define KB_BACKLIGHT_GAMMA_LUT_ONE 65535
+
+// Gamma 1.0
+#define KB_BACKLIGHT_GAMMA_LUT_10                                              \
+    {                                                                          \
+        0, 256, 512, 768, 1024, 1280, 1536, 1792, 2048, 2304,                  \
+        2560, 2816, 3072, 3328, 3584, 3840, 4096, 4352, 4608, 4864,            \
+        5120, 5376, 5632, 5888, 6144, 6400, 6656, 6912, 7168, 7424,            \
+        7680, 7936, 8192, 8448, 8704, 8960, 9216, 9472, 9728, 9984,            \
+        10240, 10496, 10752, 11008, 11264, 11520, 11776, 12032, 12288, 12544,  \
+        12800, 13056, 13312, 13568, 13824, 14080, 14336, 14592, 14848, 15104,  \
+        15360, 15616, 15872, 16128, 16384, 16640, 16896, 17152, 17408, 17664,  \
+        17920, 18176, 18432, 18688, 18944, 19200, 19456, 19712, 19968, 20224,  \
+        20480, 20736, 20992, 21248, 21504, 21760, 22016, 22272, 22528, 22784,  \
+        23040, 23296, 23552, 23808, 24064, 24320, 24576, 24832, 25088, 25344,  \
+        25600, 25856, 26112, 26368, 26624, 26880, 27136, 27392, 27648, 27904,  \
+        28160, 28416, 28672, 28928, 29184, 29440, 29696, 29952, 30208, 30464,  \
+        30720, 30976, 31232, 31488, 31744, 32000, 32256, 32512, 32768, 33023,  \
+        33279, 33535, 33791, 34047, 34303, 34559, 34815, 35071, 35327, 35583,  \
+        35839, 36095, 36351, 36607, 36863, 37119, 37375, 37631, 37887, 38143,  \
+        38399, 38655, 38911, 39167, 39423, 39679, 39935, 40191, 40447, 40703,  \
+        40959, 41215, 41471, 41727, 41983, 42239, 42495, 42751, 43007, 43263,  \
+        43519, 43775, 44031, 44287, 44543, 44799, 45055, 45311, 45567, 45823,  \
+        46079, 46335, 46591, 46847, 47103, 47359, 47615, 47871, 48127, 48383,  \
+        48639, 48895, 49151, 49407, 49663, 49919, 50175, 50431, 50687, 50943,  \
+        51199, 51455, 51711, 51967, 52223, 52479, 52735, 52991, 53247, 53503,  \
+        53759, 54015, 54271, 54527, 54783, 55039, 55295, 55551, 55807, 56063,  \
+        56319, 56575, 56831, 57087, 57343, 57599, 57855, 58111, 58367, 58623,  \
+        58879, 59135, 59391, 59647, 59903, 60159, 60415, 60671, 60927, 61183,  \
+        61439, 61695, 61951, 62207, 62463, 62719, 62975, 63231, 63487, 63743,  \
+        63999, 64255, 64511, 64767, 65023, 65279, 65535                        \
+    }
+
+// Gamma 1.1
+#define KB_BACKLIGHT_GAMMA_LUT_11                                              \
+    {                                                                          \
+        0, 147, 315, 492, 676, 864, 1055, 1250, 1448, 1648,                    \
+        1851, 2056, 2262, 2470, 2680, 2891, 3104, 3318, 3534, 3750,            \
+        3968, 4186, 4406, 4627, 4849, 5072, 5295, 5520, 5745, 5971,            \
+        6198, 6426, 6654, 6883, 7113, 7343, 7574, 7806, 8038, 8271,            \
+        8505, 8739, 8974, 9209, 9445, 9682, 9918, 10156, 10394, 10632,         \
+        10871, 11111, 11350, 11591, 11832, 12073, 12314, 12557, 12799, 13042,  \
+        13285, 13529, 13773, 14018, 14263, 14508, 14754, 15000, 15246, 15493,  \
+        15740, 15988, 16236, 16484, 16733, 16982, 17231, 17480, 17730, 17980,  \
+        18231, 18482, 18733, 18984, 19236, 19488, 19740, 19993, 20246, 20499,  \
+        20753, 21007, 21261, 21515, 21770, 22024, 22280, 22535, 22791, 23047,  \
+        23303, 23559, 23816, 24073, 24330, 24588, 24845, 25103, 25362, 25620,  \
+        25879, 26138, 26397, 26656, 26916, 27175, 27436, 27696, 27956, 28217,  \
+        28478, 28739, 29000, 29262, 29524, 29786, 30048, 30311, 30573, 30836,  \
+        31099, 31362, 31626, 31889, 32153, 32417, 32682, 32946, 33211, 33475,  \
+        33740, 34006, 34271, 34537, 34802, 35068, 35334, 35601, 35867, 36134,  \
+        36401, 36668, 36935, 37202, 37470, 37738, 38005, 38274, 38542, 38810,  \
+        39079, 39348, 39616, 39886, 40155, 40424, 40694, 40964, 41233, 41503,  \
+        41774, 42044, 42315, 42585, 42856, 43127, 43398, 43670, 43941, 44213,  \
+        44485, 44756, 45029, 45301, 45573, 45846, 46118, 46391, 46664, 46937,  \
+        47210, 47484, 47757, 48031, 48305, 48579, 48853, 49127, 49402, 49676,  \
+        49951, 50226, 50501, 50776, 51051, 51326, 51602, 51877, 52153, 52429,  \
+        52705, 52981, 53257, 53534, 53810, 54087, 54364, 54641, 54918, 55195,  \
+        55472, 55749, 56027, 56305, 56583, 56860, 57138, 57417, 57695, 57973,  \
+        58252, 58531, 58809, 59088, 59367, 59646, 59926, 60205, 60484, 60764,  \
+        61044, 61324, 61604, 61884, 62164, 62444, 62725, 63005, 63286, 63567,  \
+        63847, 64128, 64410, 64691, 64972, 65253, 65535                        \
+    }
+
+// Gamma 1.2
+#define KB_BACKLIGHT_GAMMA_LUT_12                                              \
+    {                                                                          \
+        0, 84, 194, 316, 446, 583, 725, 872, 1024, 1179,                       \
+        1338, 1501, 1666, 1834, 2004, 2177, 2352, 2530, 2710, 2891,            \
+        3075, 3260, 3447, 3636, 3827, 4019, 4213, 4408, 4604, 4802,            \
+        5002, 5203, 5405, 5608, 5812, 6018, 6225, 6433, 6642, 6853,            \
+        7064, 7277, 7490, 7705, 7920, 8137, 8354, 8572, 8792, 9012,            \
+        9233, 9455, 9678, 9902, 10126, 10352, 10578, 10805, 11033, 11262,      \
+        11491, 11721, 11952, 12184, 12417, 12650, 12884, 13118, 13354, 13590,  \
+        13826, 14064, 14302, 14540, 14780, 15020, 15260, 15502, 15743, 15986,  \
+        16229, 16473, 16717, 16962, 17208, 17454, 17700, 17948, 18196, 18444,  \
+        18693, 18942, 19192, 19443, 19694, 19946, 20198, 20451, 20704, 20958,  \
+        21212, 21467, 21722, 21978, 22234, 22491, 22748, 23006, 23265, 23523,  \
+        23782, 24042, 24302, 24563, 24824, 25085, 25347, 25610, 25873, 26136,  \
+        26400, 26664, 26929, 27194, 27459, 27725, 27992, 28259, 28526, 28793,  \
+        29061, 29330, 29599, 29868, 30138, 30408, 30678, 30949, 31221, 31492,  \
+        31764, 32037, 32310, 32583, 32856, 33130, 33405, 33680, 33955, 34230,  \
+        34506, 34782, 35059, 35336, 35613, 35891, 36169, 36447, 36726, 37005,  \
+        37285, 37564, 37845, 38125, 38406, 38687, 38969, 39250, 39533, 39815,  \
+        40098, 40381, 40665, 40949, 41233, 41517, 41802, 42088, 42373, 42659,  \
+        42945, 43231, 43518, 43805, 44093, 44380, 44668, 44957, 45245, 45534,  \
+        45824, 46113, 46403, 46693, 46984, 47274, 47566, 47857, 48149, 48441,  \
+        48733, 49025, 49318, 49611, 49905, 50198, 50492, 50787, 51081, 51376,  \
+        51671, 51967, 52262, 52558, 52854, 53151, 53448, 53745, 54042, 54340,  \
+        54638, 54936, 55234, 55533, 55832, 56131, 56431, 56730, 57030, 57331,  \
+        57631, 57932, 58233, 58535, 58836, 59138, 59440, 59742, 60045, 60348,  \
+        60651, 60955, 61258, 61562, 61866, 62171, 62475, 62780, 63085, 63391,  \
+        63696, 64002, 64308, 64614, 64921, 65228, 65535                        \
+    }
+
+// Gamma 1.3
+#define KB_BACKLIGHT_GAMMA_LUT_13                                              \
+    {                                                                          \
+        0, 49, 119, 202, 294, 393, 498, 609, 724, 844,                         \
+        968, 1095, 1227, 1361, 1499, 1639, 1783, 1929, 2078, 2229,             \
+        2383, 2539, 2697, 2858, 3020, 3185, 3351, 3520, 3690, 3863,            \
+        4037, 4212, 4390, 4569, 4750, 4932, 5116, 5302, 5489, 5677,            \
+        5867, 6059, 6252, 6446, 6641, 6838, 7036, 7236, 7437, 7639,            \
+        7842, 8046, 8252, 8459, 8667, 8876, 9087, 9298, 9511, 9725,            \
+        9939, 10155, 10372, 10590, 10809, 11029, 11250, 11473, 11696, 11920,   \
+        12145, 12371, 12598, 12826, 13055, 13284, 13515, 13747, 13979, 14213,  \
+        14447, 14682, 14918, 15155, 15393, 15632, 15871, 16112, 16353, 16595,  \
+        16837, 17081, 17325, 17571, 17817, 18064, 18311, 18559, 18809, 19058,  \
+        19309, 19560, 19813, 20065, 20319, 20573, 20829, 21084, 21341, 21598,  \
+        21856, 22115, 22374, 22634, 22895, 23156, 23418, 23681, 23945, 24209,  \
+        24474, 24739, 25005, 25272, 25539, 25807, 26076, 26345, 26615, 26886,  \
+        27157, 27429, 27702, 27975, 28249, 28523, 28798, 29074, 29350, 29627,  \
+        29904, 30182, 30460, 30740, 31019, 31300, 31581, 31862, 32144, 32427,  \
+        32710, 32994, 33278, 33563, 33848, 34134, 34421, 34708, 34996, 35284,  \
+        35573, 35862, 36152, 36442, 36733, 37025, 37317, 37609, 37902, 38196,  \
+        38490, 38784, 39079, 39375, 39671, 39968, 40265, 40563, 40861, 41160,  \
+        41459, 41758, 42059, 42359, 42660, 42962, 43264, 43567, 43870, 44173,  \
+        44478, 44782, 45087, 45393, 45699, 46005, 46312, 46619, 46927, 47236,  \
+        47545, 47854, 48164, 48474, 48784, 49095, 49407, 49719, 50032, 50344,  \
+        50658, 50972, 51286, 51601, 51916, 52231, 52547, 52864, 53181, 53498,  \
+        53816, 54134, 54453, 54772, 55091, 55411, 55732, 56052, 56374, 56695,  \
+        57017, 57340, 57663, 57986, 58310, 58634, 58959, 59284, 59609, 59935,  \
+        60261, 60588, 60915, 61242, 61570, 61898, 62227, 62556, 62885, 63215,  \
+        63545, 63876, 64207, 64538, 64870, 65202, 65535                        \
+    }
+
+// Gamma 1.4
+#define KB_BACKLIGHT_GAMMA_LUT_14                                              \
+    {                                                                          \
+        0, 28, 74, 130, 194, 265, 342, 425, 512, 604,                          \
+        700, 800, 903, 1010, 1121, 1234, 1351, 1471, 1593, 1719,               \
+        1847, 1977, 2110, 2246, 2384, 2524, 2666, 2811, 2958, 3107,            \
+        3258, 3411, 3566, 3723, 3882, 4042, 4205, 4369, 4536, 4704,            \
+        4873, 5045, 5218, 5393, 5569, 5747, 5927, 6108, 6290, 6475,            \
+        6660, 6848, 7036, 7226, 7418, 7611, 7805, 8001, 8199, 8397,            \
+        8597, 8798, 9001, 9205, 9410, 9616, 9824, 10033, 10244, 10455,         \
+        10668, 10882, 11097, 11313, 11531, 11750, 11970, 12191, 12413, 12636,  \
+        12861, 13086, 13313, 13541, 13770, 14000, 14231, 14463, 14696, 14931,  \
+        15166, 15403, 15640, 15879, 16118, 16359, 16600, 16843, 17087, 17331,  \
+        17577, 17823, 18071, 18319, 18569, 18819, 19071, 19323, 19576, 19831,  \
+        20086, 20342, 20599, 20857, 21116, 21375, 21636, 21898, 22160, 22423,  \
+        22688, 22953, 23219, 23486, 23754, 24022, 24292, 24562, 24833, 25105,  \
+        25378, 25652, 25926, 26202, 26478, 26755, 27033, 27312, 27591, 27871,  \
+        28152, 28434, 28717, 29001, 29285, 29570, 29856, 30143, 30430, 30718,  \
+        31007, 31297, 31588, 31879, 32171, 32464, 32758, 33052, 33347, 33643,  \
+        33939, 34237, 34535, 34834, 35133, 35434, 35735, 36036, 36339, 36642,  \
+        36946, 37250, 37556, 37862, 38169, 38476, 38784, 39093, 39403, 39713,  \
+        40024, 40335, 40648, 40961, 41275, 41589, 41904, 42220, 42536, 42853,  \
+        43171, 43489, 43809, 44128, 44449, 44770, 45092, 45414, 45737, 46061,  \
+        46385, 46710, 47036, 47362, 47689, 48017, 48345, 48674, 49003, 49334,  \
+        49664, 49996, 50328, 50660, 50994, 51328, 51662, 51997, 52333, 52669,  \
+        53006, 53344, 53682, 54021, 54361, 54701, 55041, 55383, 55724, 56067,  \
+        56410, 56754, 57098, 57443, 57788, 58134, 58481, 58828, 59176, 59524,  \
+        59873, 60223, 60573, 60924, 61275, 61627, 61979, 62332, 62686, 63040,  \
+        63395, 63750, 64106, 64462, 64819, 65177, 65535                        \
+    }
+
+// Gamma 1.5
+#define KB_BACKLIGHT_GAMMA_LUT_15                                              \
+    {                                                                          \
+        0, 16, 45, 83, 128, 179, 235, 296, 362, 432,                           \
+        506, 584, 665, 750, 838, 930, 1024, 1121, 1222, 1325,                  \
+        1431, 1540, 1651, 1765, 1881, 2000, 2121, 2245, 2371, 2499,            \
+        2629, 2762, 2896, 3033, 3172, 3313, 3456, 3601, 3748, 3897,            \
+        4048, 4200, 4355, 4511, 4670, 4830, 4992, 5155, 5321, 5488,            \
+        5657, 5827, 6000, 6173, 6349, 6526, 6705, 6885, 7067, 7251,            \
+        7436, 7623, 7811, 8001, 8192, 8385, 8579, 8775, 8972, 9170,            \
+        9370, 9572, 9775, 9979, 10185, 10392, 10601, 10811, 11022, 11235,      \
+        11448, 11664, 11880, 12098, 12318, 12538, 12760, 12984, 13208, 13434,  \
+        13661, 13889, 14119, 14350, 14582, 14815, 15049, 15285, 15522, 15760,  \
+        16000, 16240, 16482, 16725, 16969, 17215, 17461, 17709, 17958, 18208,  \
+        18459, 18711, 18964, 19219, 19475, 19732, 19989, 20248, 20509, 20770,  \
+        21032, 21296, 21560, 21826, 22093, 22360, 22629, 22899, 23170, 23442,  \
+        23715, 23989, 24265, 24541, 24818, 25097, 25376, 25656, 25938, 26220,  \
+        26504, 26788, 27074, 27360, 27648, 27936, 28226, 28516, 28808, 29100,  \
+        29393, 29688, 29983, 30280, 30577, 30875, 31175, 31475, 31776, 32078,  \
+        32381, 32685, 32990, 33296, 33603, 33911, 34220, 34529, 34840, 35151,  \
+        35464, 35777, 36092, 36407, 36723, 37040, 37358, 37677, 37996, 38317,  \
+        38639, 38961, 39284, 39609, 39934, 40260, 40587, 40914, 41243, 41572,  \
+        41903, 42234, 42566, 42899, 43233, 43568, 43903, 44240, 44577, 44915,  \
+        45254, 45594, 45935, 46276, 46619, 46962, 47306, 47651, 47996, 48343,  \
+        48690, 49038, 49388, 49737, 50088, 50440, 50792, 51145, 51499, 51854,  \
+        52209, 52566, 52923, 53281, 53640, 53999, 54360, 54721, 55083, 55446,  \
+        55809, 56173, 56539, 56905, 57271, 57639, 58007, 58376, 58746, 59117,  \
+        59488, 59860, 60233, 60607, 60981, 61357, 61733, 62110, 62487, 62866,  \
+        63245, 63624, 64005, 64386, 64769, 65151, 65535                        \
+    }
+
+// Gamma 1.6
+#define KB_BACKLIGHT_GAMMA_LUT_16                                              \
+    {                                                                          \
+        0, 9, 28, 53, 84, 121, 162, 207, 256, 309,                             \
+        366, 426, 490, 557, 627, 700, 776, 855, 937, 1022,                     \
+        1109, 1199, 1292, 1387, 1485, 1585, 1688, 1793, 1900, 2010,            \
+        2122, 2236, 2352, 2471, 2592, 2715, 2840, 2968, 3097, 3228,            \
+        3362, 3497, 3635, 3774, 3916, 4059, 4204, 4352, 4501, 4652,            \
+        4804, 4959, 5116, 5274, 5434, 5596, 5760, 5925, 6092, 6261,            \
+        6432, 6604, 6778, 6954, 7131, 7311, 7491, 7674, 7858, 8044,            \
+        8231, 8420, 8610, 8802, 8996, 9192, 9388, 9587, 9787, 9988,            \
+        10191, 10396, 10602, 10810, 11019, 11229, 11442, 11655, 11870, 12087,  \
+        12305, 12524, 12745, 12968, 13191, 13417, 13643, 13872, 14101, 14332,  \
+        14564, 14798, 15033, 15270, 15508, 15747, 15987, 16229, 16473, 16718,  \
+        16964, 17211, 17460, 17710, 17961, 18214, 18468, 18723, 18980, 19238,  \
+        19498, 19758, 20020, 20283, 20548, 20814, 21081, 21349, 21618, 21889,  \
+        22161, 22435, 22710, 22985, 23263, 23541, 23821, 24101, 24383, 24667,  \
+        24951, 25237, 25524, 25812, 26102, 26392, 26684, 26977, 27271, 27567,  \
+        27863, 28161, 28460, 28760, 29062, 29364, 29668, 29973, 30279, 30586,  \
+        30895, 31204, 31515, 31827, 32140, 32454, 32769, 33085, 33403, 33722,  \
+        34041, 34362, 34684, 35008, 35332, 35657, 35984, 36312, 36640, 36970,  \
+        37301, 37634, 37967, 38301, 38637, 38973, 39311, 39649, 39989, 40330,  \
+        40672, 41015, 41359, 41704, 42051, 42398, 42746, 43096, 43446, 43798,  \
+        44151, 44504, 44859, 45215, 45572, 45930, 46289, 46649, 47010, 47372,  \
+        47735, 48100, 48465, 48831, 49198, 49567, 49936, 50307, 50678, 51050,  \
+        51424, 51798, 52174, 52551, 52928, 53307, 53686, 54067, 54448, 54831,  \
+        55215, 55599, 55985, 56371, 56759, 57148, 57537, 57928, 58319, 58712,  \
+        59105, 59500, 59895, 60292, 60689, 61088, 61487, 61888, 62289, 62691,  \
+        63095, 63499, 63904, 64311, 64718, 65126, 65535                        \
+    }
+
+// Gamma 1.7
+#define KB_BACKLIGHT_GAMMA_LUT_17                                              \
+    {                                                                          \
+        0, 5, 17, 34, 56, 81, 111, 144, 181, 221,                              \
+        265, 311, 361, 413, 469, 527, 588, 652, 719, 788,                      \
+        859, 934, 1011, 1090, 1172, 1256, 1343, 1431, 1523, 1616,              \
+        1712, 1810, 1911, 2013, 2118, 2225, 2334, 2446, 2559, 2675,            \
+        2792, 2912, 3034, 3158, 3283, 3411, 3541, 3673, 3807, 3943,            \
+        4081, 4220, 4362, 4505, 4651, 4798, 4947, 5099, 5252, 5406,            \
+        5563, 5722, 5882, 6044, 6208, 6374, 6542, 6711, 6882, 7055,            \
+        7230, 7406, 7585, 7765, 7946, 8130, 8315, 8502, 8690, 8880,            \
+        9072, 9266, 9461, 9658, 9857, 10057, 10259, 10463, 10668, 10875,       \
+        11084, 11294, 11505, 11719, 11934, 12151, 12369, 12589, 12810, 13033,  \
+        13258, 13484, 13712, 13941, 14172, 14404, 14638, 14874, 15111, 15349,  \
+        15590, 15831, 16074, 16319, 16565, 16813, 17063, 17313, 17566, 17819,  \
+        18075, 18332, 18590, 18850, 19111, 19374, 19638, 19904, 20171, 20439,  \
+        20709, 20981, 21254, 21528, 21804, 22082, 22360, 22641, 22922, 23205,  \
+        23490, 23776, 24063, 24352, 24642, 24934, 25227, 25521, 25817, 26115,  \
+        26413, 26713, 27015, 27317, 27622, 27927, 28234, 28543, 28852, 29164,  \
+        29476, 29790, 30105, 30422, 30740, 31059, 31380, 31702, 32025, 32350,  \
+        32676, 33003, 33332, 33662, 33994, 34327, 34661, 34996, 35333, 35671,  \
+        36010, 36351, 36693, 37037, 37381, 37727, 38075, 38423, 38773, 39125,  \
+        39477, 39831, 40186, 40543, 40900, 41260, 41620, 41981, 42344, 42709,  \
+        43074, 43441, 43809, 44178, 44549, 44921, 45294, 45668, 46044, 46421,  \
+        46799, 47179, 47559, 47941, 48325, 48709, 49095, 49482, 49870, 50260,  \
+        50651, 51043, 51436, 51830, 52226, 52623, 53021, 53421, 53821, 54223,  \
+        54626, 55031, 55436, 55843, 56251, 56661, 57071, 57483, 57896, 58310,  \
+        58725, 59142, 59560, 59979, 60399, 60820, 61243, 61667, 62092, 62518,  \
+        62945, 63374, 63804, 64235, 64667, 65100, 65535                        \
+    }
+
+// Gamma 1.8
+#define KB_BACKLIGHT_GAMMA_LUT_18                                              \
+    {                                                                          \
+        0, 3, 11, 22, 37, 55, 76, 101, 128, 158,                               \
+        191, 227, 266, 307, 350, 397, 446, 497, 551, 607,                      \
+        666, 727, 791, 857, 925, 995, 1068, 1143, 1220, 1300,                  \
+        1382, 1466, 1552, 1640, 1731, 1824, 1919, 2016, 2115, 2216,            \
+        2319, 2425, 2532, 2642, 2753, 2867, 2983, 3100, 3220, 3342,            \
+        3466, 3591, 3719, 3849, 3981, 4114, 4250, 4387, 4527, 4668,            \
+        4812, 4957, 5104, 5254, 5405, 5558, 5712, 5869, 6028, 6188,            \
+        6351, 6515, 6681, 6849, 7019, 7190, 7364, 7539, 7716, 7895,            \
+        8076, 8259, 8443, 8629, 8817, 9007, 9199, 9392, 9588, 9785,            \
+        9983, 10184, 10386, 10590, 10796, 11004, 11213, 11424, 11637, 11852,   \
+        12068, 12286, 12506, 12728, 12951, 13176, 13403, 13631, 13861, 14093,  \
+        14327, 14562, 14799, 15038, 15278, 15520, 15764, 16009, 16257, 16505,  \
+        16756, 17008, 17262, 17517, 17775, 18033, 18294, 18556, 18820, 19085,  \
+        19353, 19621, 19892, 20164, 20438, 20713, 20990, 21269, 21549, 21831,  \
+        22114, 22399, 22686, 22975, 23265, 23556, 23849, 24144, 24441, 24739,  \
+        25038, 25340, 25642, 25947, 26253, 26561, 26870, 27181, 27493, 27807,  \
+        28123, 28440, 28759, 29079, 29401, 29724, 30049, 30376, 30704, 31034,  \
+        31365, 31698, 32033, 32369, 32706, 33045, 33386, 33728, 34072, 34417,  \
+        34764, 35113, 35463, 35814, 36167, 36522, 36878, 37235, 37595, 37955,  \
+        38318, 38681, 39047, 39413, 39782, 40152, 40523, 40896, 41270, 41646,  \
+        42024, 42403, 42783, 43165, 43549, 43934, 44320, 44708, 45098, 45489,  \
+        45881, 46275, 46671, 47068, 47466, 47866, 48268, 48671, 49075, 49481,  \
+        49889, 50298, 50708, 51120, 51533, 51948, 52364, 52782, 53202, 53622,  \
+        54044, 54468, 54893, 55320, 55748, 56178, 56609, 57041, 57475, 57911,  \
+        58347, 58786, 59226, 59667, 60109, 60554, 60999, 61446, 61895, 62345,  \
+        62796, 63249, 63703, 64159, 64616, 65075, 65535                        \
+    }
+
+// Gamma 1.9
+#define KB_BACKLIGHT_GAMMA_LUT_19                                              \
+    {                                                                          \
+        0, 2, 6, 14, 24, 37, 52, 70, 91, 113,                                  \
+        138, 166, 196, 228, 262, 299, 338, 379, 423, 468,                      \
+        516, 566, 619, 673, 730, 789, 850, 913, 978, 1046,                     \
+        1115, 1187, 1261, 1337, 1415, 1495, 1577, 1661, 1747, 1836,            \
+        1926, 2019, 2113, 2210, 2309, 2409, 2512, 2617, 2724, 2833,            \
+        2943, 3056, 3171, 3288, 3407, 3528, 3651, 3776, 3902, 4031,            \
+        4162, 4295, 4430, 4566, 4705, 4846, 4988, 5133, 5279, 5428,            \
+        5578, 5731, 5885, 6041, 6200, 6360, 6522, 6686, 6852, 7020,            \
+        7189, 7361, 7535, 7710, 7888, 8067, 8248, 8431, 8617, 8804,            \
+        8992, 9183, 9376, 9571, 9767, 9965, 10166, 10368, 10572, 10778,        \
+        10985, 11195, 11407, 11620, 11835, 12052, 12272, 12492, 12715, 12940,  \
+        13166, 13395, 13625, 13857, 14091, 14327, 14564, 14804, 15045, 15288,  \
+        15533, 15780, 16029, 16279, 16532, 16786, 17042, 17300, 17560, 17821,  \
+        18085, 18350, 18617, 18886, 19157, 19429, 19703, 19980, 20258, 20537,  \
+        20819, 21102, 21388, 21675, 21964, 22254, 22547, 22841, 23137, 23435,  \
+        23735, 24037, 24340, 24645, 24952, 25261, 25571, 25884, 26198, 26514,  \
+        26832, 27151, 27472, 27795, 28120, 28447, 28775, 29106, 29438, 29772,  \
+        30107, 30445, 30784, 31125, 31467, 31812, 32158, 32506, 32856, 33208,  \
+        33561, 33916, 34273, 34632, 34992, 35354, 35718, 36084, 36452, 36821,  \
+        37192, 37565, 37939, 38316, 38694, 39074, 39455, 39839, 40224, 40610,  \
+        40999, 41389, 41782, 42175, 42571, 42968, 43368, 43768, 44171, 44575,  \
+        44982, 45389, 45799, 46210, 46623, 47038, 47455, 47873, 48293, 48715,  \
+        49138, 49564, 49991, 50419, 50850, 51282, 51716, 52151, 52589, 53028,  \
+        53469, 53911, 54356, 54802, 55249, 55699, 56150, 56603, 57058, 57514,  \
+        57972, 58432, 58893, 59357, 59822, 60288, 60757, 61227, 61699, 62172,  \
+        62647, 63124, 63603, 64084, 64566, 65049, 65535                        \
+    }
+
+// Gamma 2.0
+#define KB_BACKLIGHT_GAMMA_LUT_20                                              \
+    {                                                                          \
+        0, 1, 4, 9, 16, 25, 36, 49, 64, 81,                                    \
+        100, 121, 144, 169, 196, 225, 256, 289, 324, 361,                      \
+        400, 441, 484, 529, 576, 625, 676, 729, 784, 841,                      \
+        900, 961, 1024, 1089, 1156, 1225, 1296, 1369, 1444, 1521,              \
+        1600, 1681, 1764, 1849, 1936, 2025, 2116, 2209, 2304, 2401,            \
+        2500, 2601, 2704, 2809, 2916, 3025, 3136, 3249, 3364, 3481,            \
+        3600, 3721, 3844, 3969, 4096, 4225, 4356, 4489, 4624, 4761,            \
+        4900, 5041, 5184, 5329, 5476, 5625, 5776, 5929, 6084, 6241,            \
+        6400, 6561, 6724, 6889, 7056, 7225, 7396, 7569, 7744, 7921,            \
+        8100, 8281, 8464, 8649, 8836, 9025, 9216, 9409, 9604, 9801,            \
+        10000, 10201, 10404, 10609, 10816, 11025, 11236, 11449, 11664, 11881,  \
+        12100, 12321, 12544, 12769, 12996, 13225, 13456, 13689, 13924, 14161,  \
+        14400, 14641, 14884, 15129, 15376, 15625, 15876, 16129, 16384, 16641,  \
+        16900, 17161, 17424, 17689, 17956, 18225, 18496, 18769, 19044, 19321,  \
+        19600, 19881, 20164, 20449, 20736, 21025, 21316, 21609, 21904, 22201,  \
+        22500, 22801, 23104, 23409, 23716, 24025, 24336, 24649, 24964, 25281,  \
+        25600, 25921, 26244, 26569, 26896, 27225, 27556, 27889, 28224, 28561,  \
+        28900, 29241, 29584, 29929, 30276, 30625, 30976, 31329, 31684, 32041,  \
+        32400, 32761, 33123, 33488, 33855, 34224, 34595, 34968, 35343, 35720,  \
+        36099, 36480, 36863, 37248, 37635, 38024, 38415, 38808, 39203, 39600,  \
+        39999, 40400, 40803, 41208, 41615, 42024, 42435, 42848, 43263, 43680,  \
+        44099, 44520, 44943, 45368, 45795, 46224, 46655, 47088, 47523, 47960,  \
+        48399, 48840, 49283, 49728, 50175, 50624, 51075, 51528, 51983, 52440,  \
+        52899, 53360, 53823, 54288, 54755, 55224, 55695, 56168, 56643, 57120,  \
+        57599, 58080, 58563, 59048, 59535, 60024, 60515, 61008, 61503, 62000,  \
+        62499, 63000, 63503, 64008, 64515, 65024, 65535                        \
+    }
+
+// Gamma 2.1
+#define KB_BACKLIGHT_GAMMA_LUT_21                                              \
+    {                                                                          \
+        0, 1, 2, 6, 11, 17, 25, 34, 45, 58,                                    \
+        72, 88, 106, 125, 147, 169, 194, 220, 248, 278,                        \
+        310, 343, 379, 416, 455, 495, 538, 582, 628, 676,                      \
+        726, 778, 832, 887, 945, 1004, 1065, 1128, 1193, 1260,                 \
+        1329, 1400, 1472, 1547, 1623, 1702, 1782, 1865, 1949, 2035,            \
+        2123, 2213, 2306, 2400, 2496, 2594, 2694, 2796, 2900, 3006,            \
+        3114, 3224, 3336, 3450, 3566, 3684, 3804, 3926, 4050, 4176,            \
+        4304, 4434, 4566, 4701, 4837, 4975, 5115, 5258, 5402, 5549,            \
+        5697, 5848, 6000, 6155, 6312, 6471, 6632, 6795, 6960, 7127,            \
+        7296, 7467, 7641, 7816, 7994, 8173, 8355, 8539, 8725, 8913,            \
+        9103, 9295, 9489, 9686, 9884, 10085, 10288, 10492, 10699, 10908,       \
+        11120, 11333, 11549, 11766, 11986, 12208, 12432, 12658, 12886, 13117,  \
+        13349, 13584, 13821, 14060, 14301, 14544, 14789, 15037, 15287, 15538,  \
+        15792, 16049, 16307, 16568, 16830, 17095, 17362, 17631, 17903, 18176,  \
+        18452, 18730, 19010, 19292, 19576, 19863, 20152, 20443, 20736, 21031,  \
+        21329, 21628, 21930, 22234, 22540, 22849, 23160, 23472, 23788, 24105,  \
+        24424, 24746, 25070, 25396, 25724, 26055, 26387, 26722, 27059, 27399,  \
+        27740, 28084, 28430, 28778, 29129, 29481, 29836, 30193, 30553, 30914,  \
+        31278, 31644, 32012, 32383, 32756, 33131, 33508, 33887, 34269, 34653,  \
+        35039, 35427, 35818, 36211, 36606, 37003, 37403, 37805, 38209, 38615,  \
+        39024, 39435, 39848, 40263, 40681, 41101, 41523, 41948, 42374, 42803,  \
+        43234, 43668, 44104, 44542, 44982, 45424, 45869, 46316, 46766, 47217,  \
+        47671, 48127, 48586, 49047, 49510, 49975, 50443, 50912, 51385, 51859,  \
+        52336, 52815, 53296, 53780, 54265, 54754, 55244, 55737, 56232, 56729,  \
+        57229, 57730, 58235, 58741, 59250, 59761, 60274, 60790, 61308, 61828,  \
+        62351, 62876, 63403, 63933, 64464, 64999, 65535                        \
+    }
+
+// Gamma 2.2
+#define KB_BACKLIGHT_GAMMA_LUT_22                                              \
+    {                                                                          \
+        0, 0, 2, 4, 7, 11, 17, 24, 32, 41,                                     \
+        52, 64, 78, 93, 110, 128, 147, 168, 191, 215,                          \
+        240, 267, 296, 327, 359, 392, 428, 465, 504, 544,                      \
+        586, 630, 676, 723, 772, 823, 875, 930, 986, 1044,                     \
+        1104, 1165, 1229, 1294, 1361, 1430, 1501, 1574, 1648, 1725,            \
+        1803, 1884, 1966, 2050, 2136, 2224, 2314, 2406, 2500, 2595,            \
+        2693, 2793, 2895, 2998, 3104, 3212, 3322, 3433, 3547, 3663,            \
+        3781, 3900, 4022, 4146, 4272, 4400, 4530, 4663, 4797, 4933,            \
+        5072, 5212, 5355, 5499, 5646, 5795, 5946, 6099, 6255, 6412,            \
+        6572, 6733, 6897, 7063, 7231, 7402, 7574, 7749, 7926, 8105,            \
+        8286, 8469, 8655, 8843, 9033, 9225, 9419, 9616, 9815, 10016,           \
+        10219, 10425, 10632, 10842, 11054, 11269, 11486, 11705, 11926, 12149,  \
+        12375, 12603, 12833, 13066, 13301, 13538, 13777, 14019, 14263, 14509,  \
+        14758, 15009, 15262, 15517, 15775, 16035, 16298, 16563, 16830, 17099,  \
+        17371, 17645, 17922, 18201, 18482, 18765, 19051, 19339, 19630, 19923,  \
+        20218, 20516, 20816, 21119, 21424, 21731, 22040, 22352, 22667, 22984,  \
+        23303, 23624, 23949, 24275, 24604, 24935, 25269, 25605, 25943, 26284,  \
+        26628, 26973, 27322, 27672, 28026, 28381, 28739, 29100, 29462, 29828,  \
+        30196, 30566, 30939, 31314, 31692, 32072, 32454, 32840, 33227, 33617,  \
+        34010, 34405, 34802, 35202, 35605, 36010, 36417, 36827, 37240, 37655,  \
+        38072, 38493, 38915, 39340, 39768, 40198, 40631, 41066, 41503, 41944,  \
+        42387, 42832, 43280, 43730, 44183, 44639, 45097, 45557, 46020, 46486,  \
+        46954, 47425, 47899, 48374, 48853, 49334, 49818, 50304, 50793, 51284,  \
+        51778, 52275, 52774, 53276, 53780, 54287, 54796, 55308, 55823, 56341,  \
+        56860, 57383, 57908, 58436, 58966, 59499, 60035, 60573, 61114, 61657,  \
+        62203, 62752, 63303, 63857, 64414, 64973, 65535                        \
+    }
+
+// Gamma 2.3
+#define KB_BACKLIGHT_GAMMA_LUT_23                                              \
+    {                                                                          \
+        0, 0, 1, 2, 5, 8, 12, 17, 23, 30,                                      \
+        38, 47, 57, 69, 82, 96, 111, 128, 146, 165,                            \
+        186, 208, 232, 257, 283, 311, 340, 371, 404, 438,                      \
+        473, 510, 549, 589, 631, 674, 719, 766, 815, 865,                      \
+        917, 970, 1026, 1083, 1141, 1202, 1264, 1328, 1394, 1462,              \
+        1532, 1603, 1676, 1751, 1828, 1907, 1988, 2070, 2155, 2241,            \
+        2330, 2420, 2512, 2606, 2702, 2800, 2900, 3003, 3107, 3213,            \
+        3321, 3431, 3543, 3657, 3774, 3892, 4012, 4135, 4259, 4386,            \
+        4515, 4646, 4779, 4914, 5051, 5190, 5332, 5475, 5621, 5769,            \
+        5919, 6072, 6226, 6383, 6542, 6703, 6867, 7032, 7200, 7370,            \
+        7543, 7717, 7894, 8073, 8255, 8438, 8624, 8813, 9003, 9196,            \
+        9391, 9589, 9789, 9991, 10195, 10402, 10611, 10823, 11037, 11253,      \
+        11472, 11693, 11917, 12142, 12371, 12601, 12834, 13070, 13308, 13548,  \
+        13791, 14036, 14284, 14534, 14786, 15041, 15299, 15559, 15821, 16086,  \
+        16354, 16624, 16896, 17171, 17448, 17728, 18011, 18296, 18583, 18873,  \
+        19166, 19461, 19759, 20059, 20362, 20667, 20975, 21286, 21599, 21915,  \
+        22233, 22554, 22877, 23203, 23532, 23864, 24197, 24534, 24873, 25215,  \
+        25560, 25907, 26256, 26609, 26964, 27322, 27682, 28045, 28411, 28780,  \
+        29151, 29524, 29901, 30280, 30662, 31047, 31434, 31824, 32217, 32612,  \
+        33011, 33412, 33815, 34222, 34631, 35043, 35458, 35875, 36295, 36718,  \
+        37144, 37573, 38004, 38438, 38875, 39315, 39757, 40203, 40651, 41102,  \
+        41555, 42012, 42471, 42933, 43398, 43866, 44337, 44810, 45287, 45766,  \
+        46248, 46733, 47221, 47711, 48205, 48701, 49201, 49703, 50208, 50716,  \
+        51227, 51740, 52257, 52776, 53299, 53824, 54352, 54884, 55418, 55955,  \
+        56495, 57038, 57583, 58132, 58684, 59238, 59796, 60357, 60920, 61487,  \
+        62056, 62628, 63204, 63782, 64363, 64948, 65535                        \
+    }
+
+// Gamma 2.4
+#define KB_BACKLIGHT_GAMMA_LUT_24                                              \
+    {                                                                          \
+        0, 0, 1, 2, 3, 5, 8, 12, 16, 21,                                       \
+        27, 34, 42, 51, 61, 72, 84, 98, 112, 128,                              \
+        144, 162, 181, 202, 223, 246, 271, 296, 324, 352,                      \
+        382, 413, 446, 480, 516, 553, 591, 632, 673, 717,                      \
+        761, 808, 856, 906, 957, 1010, 1065, 1121, 1179, 1239,                 \
+        1301, 1364, 1429, 1496, 1565, 1635, 1707, 1782, 1857, 1935,            \
+        2015, 2096, 2180, 2265, 2352, 2442, 2533, 2626, 2721, 2818,            \
+        2917, 3018, 3121, 3226, 3333, 3442, 3553, 3667, 3782, 3899,            \
+        4019, 4141, 4264, 4390, 4518, 4648, 4781, 4915, 5052, 5191,            \
+        5332, 5475, 5621, 5768, 5918, 6071, 6225, 6382, 6541, 6702,            \
+        6866, 7032, 7200, 7371, 7544, 7719, 7896, 8076, 8259, 8443,            \
+        8631, 8820, 9012, 9206, 9403, 9602, 9804, 10008, 10214, 10423,         \
+        10635, 10849, 11065, 11284, 11506, 11730, 11956, 12185, 12417, 12651,  \
+        12887, 13126, 13368, 13613, 13860, 14109, 14361, 14616, 14873, 15133,  \
+        15396, 15661, 15929, 16200, 16473, 16749, 17027, 17308, 17592, 17879,  \
+        18168, 18460, 18755, 19053, 19353, 19656, 19962, 20270, 20581, 20895,  \
+        21212, 21532, 21854, 22179, 22507, 22838, 23172, 23508, 23847, 24189,  \
+        24534, 24882, 25233, 25586, 25943, 26302, 26664, 27029, 27397, 27768,  \
+        28142, 28518, 28898, 29281, 29666, 30055, 30446, 30840, 31237, 31638,  \
+        32041, 32447, 32856, 33269, 33684, 34102, 34523, 34948, 35375, 35805,  \
+        36238, 36675, 37114, 37557, 38002, 38451, 38903, 39357, 39815, 40276,  \
+        40740, 41207, 41678, 42151, 42628, 43107, 43590, 44076, 44565, 45057,  \
+        45552, 46051, 46553, 47058, 47566, 48077, 48591, 49109, 49630, 50154,  \
+        50681, 51211, 51745, 52282, 52822, 53365, 53912, 54462, 55015, 55572,  \
+        56131, 56694, 57260, 57830, 58403, 58979, 59558, 60141, 60727, 61316,  \
+        61909, 62505, 63104, 63707, 64313, 64922, 65535                        \
+    }
+
+// Gamma 2.5
+#define KB_BACKLIGHT_GAMMA_LUT_25                                              \
+    {                                                                          \
+        0, 0, 0, 1, 2, 3, 6, 8, 11, 15,                                        \
+        20, 25, 31, 38, 46, 54, 64, 74, 86, 98,                                \
+        112, 126, 142, 159, 176, 195, 215, 237, 259, 283,                      \
+        308, 334, 362, 391, 421, 453, 486, 520, 556, 594,                      \
+        632, 673, 714, 758, 803, 849, 897, 946, 998, 1050,                     \
+        1105, 1161, 1219, 1278, 1339, 1402, 1467, 1533, 1601, 1671,            \
+        1743, 1816, 1892, 1969, 2048, 2129, 2212, 2296, 2383, 2472,            \
+        2562, 2655, 2749, 2846, 2944, 3045, 3147, 3252, 3358, 3467,            \
+        3578, 3691, 3805, 3923, 4042, 4163, 4287, 4412, 4540, 4670,            \
+        4803, 4937, 5074, 5213, 5354, 5498, 5644, 5792, 5942, 6095,            \
+        6250, 6407, 6567, 6729, 6894, 7061, 7230, 7402, 7576, 7752,            \
+        7931, 8113, 8297, 8483, 8672, 8864, 9058, 9254, 9453, 9655,            \
+        9859, 10066, 10275, 10487, 10701, 10918, 11138, 11360, 11585, 11813,   \
+        12043, 12276, 12511, 12750, 12991, 13235, 13481, 13730, 13982, 14237,  \
+        14494, 14754, 15017, 15283, 15552, 15823, 16097, 16374, 16654, 16937,  \
+        17223, 17511, 17803, 18097, 18394, 18694, 18997, 19303, 19612, 19924,  \
+        20238, 20556, 20877, 21200, 21527, 21857, 22189, 22525, 22864, 23205,  \
+        23550, 23898, 24249, 24603, 24960, 25320, 25684, 26050, 26419, 26792,  \
+        27168, 27547, 27929, 28314, 28702, 29094, 29489, 29887, 30288, 30692,  \
+        31100, 31511, 31925, 32342, 32763, 33186, 33613, 34044, 34478, 34915,  \
+        35355, 35798, 36245, 36696, 37149, 37606, 38066, 38530, 38997, 39467,  \
+        39941, 40418, 40899, 41383, 41870, 42361, 42856, 43353, 43855, 44359,  \
+        44867, 45379, 45894, 46413, 46935, 47460, 47989, 48522, 49058, 49598,  \
+        50141, 50688, 51238, 51792, 52350, 52911, 53475, 54044, 54615, 55191,  \
+        55770, 56353, 56939, 57529, 58123, 58720, 59321, 59926, 60534, 61147,  \
+        61762, 62382, 63005, 63632, 64263, 64897, 65535                        \
+    }
+
+// Gamma 2.6
+#define KB_BACKLIGHT_GAMMA_LUT_26                                              \
+    {                                                                          \
+        0, 0, 0, 1, 1, 2, 4, 6, 8, 11,                                         \
+        14, 18, 23, 28, 34, 41, 49, 57, 66, 76,                                \
+        87, 98, 111, 125, 139, 155, 171, 189, 208, 228,                        \
+        249, 271, 294, 319, 344, 371, 399, 429, 460, 492,                      \
+        525, 560, 596, 634, 673, 714, 755, 799, 844, 890,                      \
+        938, 988, 1039, 1092, 1146, 1202, 1260, 1319, 1380, 1443,              \
+        1507, 1574, 1642, 1711, 1783, 1856, 1931, 2008, 2087, 2168,            \
+        2251, 2335, 2422, 2510, 2600, 2693, 2787, 2884, 2982, 3082,            \
+        3185, 3289, 3396, 3505, 3616, 3729, 3844, 3961, 4080, 4202,            \
+        4326, 4452, 4580, 4711, 4844, 4979, 5116, 5256, 5398, 5542,            \
+        5689, 5838, 5990, 6144, 6300, 6459, 6620, 6783, 6949, 7118,            \
+        7289, 7463, 7639, 7817, 7998, 8182, 8368, 8557, 8749, 8943,            \
+        9139, 9339, 9541, 9745, 9953, 10163, 10376, 10591, 10809, 11030,       \
+        11254, 11480, 11710, 11942, 12176, 12414, 12655, 12898, 13144, 13393,  \
+        13645, 13900, 14158, 14419, 14682, 14949, 15218, 15491, 15766, 16045,  \
+        16326, 16611, 16898, 17189, 17482, 17779, 18079, 18382, 18688, 18997,  \
+        19309, 19624, 19943, 20265, 20589, 20917, 21249, 21583, 21921, 22262,  \
+        22606, 22953, 23304, 23658, 24015, 24375, 24739, 25106, 25477, 25850,  \
+        26228, 26608, 26992, 27379, 27770, 28164, 28562, 28963, 29367, 29775,  \
+        30186, 30601, 31019, 31441, 31866, 32295, 32728, 33164, 33603, 34046,  \
+        34493, 34943, 35397, 35854, 36315, 36780, 37248, 37720, 38196, 38675,  \
+        39158, 39645, 40135, 40629, 41127, 41628, 42134, 42643, 43156, 43672,  \
+        44192, 44717, 45245, 45776, 46312, 46852, 47395, 47942, 48493, 49048,  \
+        49607, 50170, 50736, 51307, 51881, 52460, 53042, 53628, 54219, 54813,  \
+        55411, 56014, 56620, 57230, 57845, 58463, 59085, 59712, 60343, 60977,  \
+        61616, 62259, 62906, 63557, 64212, 64871, 65535                        \
+    }
+
+// Gamma 2.7
+#define KB_BACKLIGHT_GAMMA_LUT_27                                              \
+    {                                                                          \
+        0, 0, 0, 0, 1, 2, 3, 4, 6, 8,                                          \
+        10, 13, 17, 21, 26, 31, 37, 43, 51, 58,                                \
+        67, 77, 87, 98, 110, 123, 136, 151, 167, 183,                          \
+        201, 219, 239, 260, 281, 304, 328, 353, 380, 407,                      \
+        436, 466, 498, 530, 564, 600, 636, 674, 714, 755,                      \
+        797, 841, 886, 933, 981, 1031, 1082, 1135, 1190, 1246,                 \
+        1304, 1363, 1425, 1487, 1552, 1618, 1687, 1756, 1828, 1902,            \
+        1977, 2054, 2133, 2214, 2297, 2382, 2468, 2557, 2648, 2740,            \
+        2835, 2932, 3031, 3131, 3234, 3339, 3446, 3556, 3667, 3781,            \
+        3897, 4015, 4135, 4257, 4382, 4509, 4638, 4770, 4904, 5040,            \
+        5179, 5320, 5463, 5609, 5757, 5908, 6061, 6217, 6375, 6535,            \
+        6699, 6864, 7033, 7203, 7377, 7553, 7731, 7913, 8097, 8283,            \
+        8473, 8665, 8859, 9057, 9257, 9460, 9666, 9874, 10085, 10300,          \
+        10517, 10736, 10959, 11185, 11413, 11645, 11879, 12116, 12357, 12600,  \
+        12846, 13095, 13348, 13603, 13861, 14123, 14387, 14655, 14926, 15199,  \
+        15476, 15757, 16040, 16326, 16616, 16909, 17205, 17505, 17807, 18113,  \
+        18423, 18735, 19051, 19370, 19693, 20019, 20348, 20680, 21017, 21356,  \
+        21699, 22045, 22395, 22748, 23105, 23465, 23829, 24197, 24567, 24942,  \
+        25320, 25701, 26087, 26475, 26868, 27264, 27664, 28067, 28474, 28885,  \
+        29299, 29718, 30140, 30565, 30995, 31428, 31865, 32306, 32751, 33199,  \
+        33652, 34108, 34568, 35032, 35500, 35972, 36447, 36927, 37411, 37898,  \
+        38390, 38886, 39385, 39889, 40396, 40908, 41424, 41944, 42468, 42996,  \
+        43528, 44064, 44604, 45149, 45698, 46251, 46808, 47369, 47935, 48504,  \
+        49078, 49657, 50239, 50826, 51417, 52013, 52612, 53216, 53825, 54438,  \
+        55055, 55676, 56302, 56933, 57568, 58207, 58851, 59499, 60151, 60808,  \
+        61470, 62136, 62807, 63482, 64162, 64846, 65535                        \
+    }
+
+// Gamma 2.8
+#define KB_BACKLIGHT_GAMMA_LUT_28                                              \
+    {                                                                          \
+        0, 0, 0, 0, 1, 1, 2, 3, 4, 6,                                          \
+        7, 10, 12, 16, 19, 23, 28, 33, 39, 45,                                 \
+        52, 60, 68, 77, 87, 97, 108, 121, 133, 147,                            \
+        162, 178, 194, 211, 230, 249, 270, 291, 314, 338,                      \
+        362, 388, 415, 444, 473, 504, 536, 569, 604, 640,                      \
+        677, 715, 755, 797, 840, 884, 930, 977, 1026, 1076,                    \
+        1128, 1181, 1236, 1293, 1351, 1411, 1473, 1536, 1601, 1668,            \
+        1737, 1807, 1879, 1953, 2029, 2107, 2186, 2268, 2351, 2436,            \
+        2524, 2613, 2704, 2798, 2893, 2991, 3090, 3192, 3296, 3402,            \
+        3510, 3620, 3733, 3847, 3964, 4083, 4205, 4329, 4455, 4583,            \
+        4714, 4847, 4983, 5121, 5261, 5404, 5550, 5697, 5848, 6001,            \
+        6156, 6314, 6475, 6638, 6804, 6972, 7143, 7317, 7493, 7672,            \
+        7854, 8039, 8226, 8417, 8610, 8805, 9004, 9206, 9410, 9617,            \
+        9827, 10041, 10257, 10476, 10698, 10923, 11151, 11382, 11616, 11853,   \
+        12094, 12337, 12584, 12833, 13086, 13342, 13602, 13864, 14130, 14399,  \
+        14671, 14946, 15225, 15507, 15793, 16082, 16374, 16669, 16968, 17271,  \
+        17577, 17886, 18199, 18515, 18835, 19158, 19485, 19816, 20150, 20487,  \
+        20829, 21173, 21522, 21874, 22230, 22590, 22953, 23320, 23691, 24065,  \
+        24444, 24826, 25212, 25601, 25995, 26393, 26794, 27199, 27609, 28022,  \
+        28439, 28860, 29285, 29714, 30147, 30584, 31025, 31471, 31920, 32374,  \
+        32831, 33293, 33759, 34229, 34703, 35181, 35664, 36151, 36642, 37137,  \
+        37637, 38141, 38649, 39162, 39679, 40200, 40726, 41256, 41791, 42330,  \
+        42873, 43421, 43973, 44530, 45092, 45658, 46228, 46803, 47383, 47967,  \
+        48556, 49149, 49747, 50350, 50957, 51569, 52186, 52808, 53434, 54065,  \
+        54701, 55341, 55987, 56637, 57292, 57952, 58616, 59286, 59961, 60640,  \
+        61324, 62014, 62708, 63407, 64111, 64821, 65535                        \
+    }
+
+// Gamma 2.9
+#define KB_BACKLIGHT_GAMMA_LUT_29                                              \
+    {                                                                          \
+        0, 0, 0, 0, 0, 1, 1, 2, 3, 4,                                          \
+        5, 7, 9, 12, 14, 18, 21, 25, 30, 35,                                   \
+        40, 46, 53, 60, 68, 77, 86, 96, 107, 118,                              \
+        131, 144, 158, 172, 188, 204, 222, 240, 259, 280,                      \
+        301, 323, 347, 371, 397, 424, 451, 480, 511, 542,                      \
+        575, 609, 644, 681, 719, 758, 799, 841, 884, 929,                      \
+        975, 1023, 1073, 1124, 1176, 1230, 1286, 1343, 1402, 1463,             \
+        1525, 1589, 1655, 1723, 1792, 1863, 1936, 2011, 2088, 2166,            \
+        2247, 2329, 2413, 2500, 2588, 2679, 2771, 2865, 2962, 3061,            \
+        3161, 3264, 3369, 3477, 3586, 3698, 3812, 3928, 4047, 4168,            \
+        4291, 4417, 4545, 4675, 4808, 4943, 5081, 5221, 5364, 5510,            \
+        5657, 5808, 5961, 6117, 6275, 6436, 6599, 6766, 6935, 7107,            \
+        7281, 7459, 7639, 7822, 8008, 8196, 8388, 8582, 8780, 8980,            \
+        9184, 9390, 9599, 9812, 10027, 10246, 10467, 10692, 10920, 11151,      \
+        11385, 11623, 11864, 12107, 12355, 12605, 12859, 13116, 13376, 13640,  \
+        13907, 14178, 14452, 14729, 15010, 15295, 15583, 15874, 16169, 16468,  \
+        16770, 17075, 17385, 17698, 18015, 18335, 18659, 18987, 19319, 19654,  \
+        19993, 20336, 20683, 21033, 21388, 21746, 22109, 22475, 22845, 23219,  \
+        23598, 23980, 24366, 24756, 25151, 25549, 25952, 26358, 26769, 27184,  \
+        27603, 28027, 28455, 28886, 29323, 29763, 30208, 30657, 31110, 31568,  \
+        32031, 32497, 32968, 33444, 33924, 34408, 34897, 35391, 35889, 36392,  \
+        36899, 37411, 37927, 38448, 38974, 39505, 40040, 40580, 41125, 41674,  \
+        42228, 42787, 43351, 43920, 44494, 45072, 45655, 46244, 46837, 47435,  \
+        48038, 48647, 49260, 49878, 50501, 51130, 51763, 52402, 53046, 53695,  \
+        54349, 55008, 55673, 56342, 57017, 57698, 58383, 59074, 59771, 60472,  \
+        61179, 61892, 62609, 63333, 64061, 64795, 65535                        \
+    }
+
+// Gamma 3.0
+#define KB_BACKLIGHT_GAMMA_LUT_30                                              \
+    {                                                                          \
+        0, 0, 0, 0, 0, 0, 1, 1, 2, 3,                                          \
+        4, 5, 7, 9, 11, 13, 16, 19, 23, 27,                                    \
+        31, 36, 42, 48, 54, 61, 69, 77, 86, 95,                                \
+        105, 116, 128, 140, 154, 167, 182, 198, 214, 232,                      \
+        250, 269, 289, 311, 333, 356, 380, 406, 432, 460,                      \
+        488, 518, 549, 582, 615, 650, 686, 723, 762, 802,                      \
+        844, 887, 931, 977, 1024, 1073, 1123, 1175, 1228, 1283,                \
+        1340, 1398, 1458, 1520, 1583, 1648, 1715, 1783, 1854, 1926,            \
+        2000, 2076, 2154, 2234, 2315, 2399, 2485, 2572, 2662, 2754,            \
+        2848, 2944, 3042, 3142, 3244, 3349, 3456, 3565, 3676, 3790,            \
+        3906, 4025, 4145, 4268, 4394, 4522, 4652, 4785, 4921, 5059,            \
+        5199, 5342, 5488, 5636, 5787, 5941, 6097, 6256, 6418, 6583,            \
+        6750, 6920, 7093, 7269, 7448, 7629, 7814, 8001, 8192, 8385,            \
+        8582, 8781, 8984, 9190, 9399, 9611, 9826, 10044, 10266, 10491,         \
+        10719, 10950, 11185, 11423, 11664, 11909, 12157, 12408, 12663, 12921,  \
+        13183, 13449, 13718, 13990, 14266, 14546, 14830, 15117, 15407, 15702,  \
+        16000, 16302, 16607, 16917, 17230, 17547, 17868, 18193, 18522, 18854,  \
+        19191, 19532, 19876, 20225, 20578, 20935, 21296, 21661, 22030, 22403,  \
+        22781, 23163, 23549, 23939, 24334, 24733, 25136, 25543, 25955, 26372,  \
+        26793, 27218, 27648, 28082, 28521, 28964, 29412, 29864, 30321, 30783,  \
+        31250, 31721, 32196, 32677, 33162, 33652, 34147, 34647, 35151, 35661,  \
+        36175, 36694, 37219, 37748, 38282, 38821, 39365, 39915, 40469, 41029,  \
+        41593, 42163, 42738, 43318, 43903, 44494, 45090, 45691, 46298, 46909,  \
+        47527, 48149, 48777, 49411, 50050, 50694, 51344, 51999, 52660, 53327,  \
+        53999, 54677, 55360, 56050, 56744, 57445, 58151, 58863, 59581, 60305,  \
+        61034, 61770, 62511, 63258, 64011, 64770, 65535                        \
+    }
+
+#endif // LIB_KB_BACKLIGHT_GAMMA_H_
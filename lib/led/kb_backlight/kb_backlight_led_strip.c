@@ -5,41 +5,186 @@
 #include <lib/keyboard/kb_mappings.h>
 #include <lib/led/kb_backlight_state.h>
 #include <lib/led/kb_bl_mode.h>
+#include <lib/led/kb_leds_geom.h>
+
+#include "kb_backlight_gamma.h"
+
+#if CONFIG_LED_STRIP_ASYNC
+#include <drivers/led_strip_async.h>
+#endif // CONFIG_LED_STRIP_ASYNC
+
+#if CONFIG_KB_BACKLIGHT_CURRENT_LIMIT && CONFIG_LIB_USB_CONNECT
+#include <lib/connect/usb_connect.h>
+#endif // CONFIG_KB_BACKLIGHT_CURRENT_LIMIT && CONFIG_LIB_USB_CONNECT
 
 #include <zephyr/logging/log.h>
 #include <zephyr/settings/settings.h>
+#include <zephyr/sys/util.h>
 
 LOG_MODULE_REGISTER(kb_backlight_led_strip, CONFIG_KB_BACKLIGHT_LOG_LEVEL);
 
-#define BRIGHTNESS_K                                                           \
-    ((float)CONFIG_KB_BACKLIGHT_MAX_BRIGHTNESS_COMBINED / (255 * 3))
-
 #define KB_BACKLIGHT_MIN_DELTA_MS (1000 / CONFIG_KB_BACKLIGHT_FPS)
 
+// Maximum value of a single channel after brightness is applied
+#define KB_BACKLIGHT_CHANNEL_MAX                                               \
+    (CONFIG_KB_BACKLIGHT_MAX_BRIGHTNESS_COMBINED / 3)
+
+#define KB_BACKLIGHT_GAMMA_LUT_SIZE BIT(KB_BACKLIGHT_GAMMA_LUT_BITS)
+
 const struct device *strip = DEVICE_DT_GET(DT_CHOSEN(ykb_backlight));
 
 static int64_t last_update_time = 0;
 
+// Given whenever the backlight thread should render a frame sooner than
+// it planned to
+static K_SEM_DEFINE(bl_wake, 0, 1);
+
 static struct led_rgb frame[CONFIG_KB_KEY_COUNT];
 
+// Last frame sent to the strip, used to skip unchanged frames
+static struct led_rgb frame_sent[CONFIG_KB_KEY_COUNT];
+// Whether 'frame_sent' matches what the strip shows
+static bool frame_sent_valid = false;
+
+// Channel value -> gamma corrected value with brightness applied
+static uint8_t brightness_lut[256];
+
 backlight_state bl_state = {0};
 
-static inline uint8_t brightness_scale(uint8_t v, uint8_t pct) {
-    float scaled = (float)v * ((float)pct / 100.0f) * BRIGHTNESS_K;
-    if (scaled < 0.f)
-        scaled = 0.f;
-    if (scaled > 255.f)
-        scaled = 255.f;
-    return (uint8_t)scaled;
+// Added to uptime to get the animation clock, see 'kb_backlight_clock_ms'
+static atomic_t clock_offset = ATOMIC_INIT(0);
+
+static kb_backlight_on_update_cb on_update = NULL;
+
+void kb_backlight_set_on_update(kb_backlight_on_update_cb cb) {
+    on_update = cb;
+}
+
+static void kb_backlight_notify_update() {
+    if (on_update) {
+        on_update();
+    }
+}
+
+uint32_t kb_backlight_clock_ms() {
+    return k_uptime_get_32() + (uint32_t)atomic_get(&clock_offset);
+}
+
+void kb_backlight_clock_sync(uint32_t clock_ms) {
+    atomic_set(&clock_offset, (atomic_val_t)(clock_ms - k_uptime_get_32()));
+    k_sem_give(&bl_wake);
+}
+
+// x^(CONFIG_KB_BACKLIGHT_GAMMA / 10) at KB_BACKLIGHT_GAMMA_LUT_SIZE + 1
+// evenly spaced x in [0, 1], scaled to KB_BACKLIGHT_GAMMA_LUT_ONE
+static const uint16_t gamma_lut[KB_BACKLIGHT_GAMMA_LUT_SIZE + 1] =
+    UTIL_CAT(KB_BACKLIGHT_GAMMA_LUT_, CONFIG_KB_BACKLIGHT_GAMMA);
+
+// Rebuild 'brightness_lut' for brightness 'pct' (1 - 100)
+//
+// Brightness is applied before gamma correction so brightness steps look
+// perceptually even. Should be called only when brightness changes, frames
+// are then post-processed with table lookups only.
+static void brightness_lut_rebuild(uint8_t pct) {
+    for (uint32_t v = 0; v < ARRAY_SIZE(brightness_lut); ++v) {
+        // Position in 'gamma_lut' with 8 fractional bits
+        uint32_t pos = (v * pct * (KB_BACKLIGHT_GAMMA_LUT_SIZE << 8)) /
+                       (255 * 100);
+        uint32_t i = MIN(pos >> 8, KB_BACKLIGHT_GAMMA_LUT_SIZE - 1);
+        uint32_t frac = pos - (i << 8);
+        uint32_t lo = gamma_lut[i];
+        uint32_t hi = gamma_lut[i + 1];
+        uint32_t g = lo + (((hi - lo) * frac) >> 8);
+        uint32_t y = (g * KB_BACKLIGHT_CHANNEL_MAX +
+                      KB_BACKLIGHT_GAMMA_LUT_ONE / 2) /
+                     KB_BACKLIGHT_GAMMA_LUT_ONE;
+        brightness_lut[v] = (uint8_t)MIN(y, 255);
+    }
+}
+
+// Length of the chain prefix which differs from the last sent frame
+static size_t frame_dirty_len() {
+    if (!frame_sent_valid) {
+        return CONFIG_KB_KEY_COUNT;
+    }
+
+    for (size_t i = CONFIG_KB_KEY_COUNT; i > 0; --i) {
+        const struct led_rgb *a = &frame[i - 1];
+        const struct led_rgb *b = &frame_sent[i - 1];
+        if (a->r != b->r || a->g != b->g || a->b != b->b) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+static void apply_brightness(struct led_rgb *buf, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        buf[i].r = brightness_lut[buf[i].r];
+        buf[i].g = brightness_lut[buf[i].g];
+        buf[i].b = brightness_lut[buf[i].b];
+    }
+}
+
+#if CONFIG_KB_BACKLIGHT_CURRENT_LIMIT
+
+static uint32_t current_budget_ua() {
+#if CONFIG_LIB_USB_CONNECT
+    if (usb_connect_is_powered()) {
+        return CONFIG_KB_BACKLIGHT_CURRENT_BUDGET_USB_MA * 1000u;
+    }
+#endif // CONFIG_LIB_USB_CONNECT
+    return CONFIG_KB_BACKLIGHT_CURRENT_BUDGET_BATTERY_MA * 1000u;
 }
 
-static void apply_brightness(struct led_rgb *buf, size_t n, uint8_t pct) {
+// Scale the frame down if the estimated strip current exceeds the budget
+//
+// Expects the frame with brightness already applied, i.e. actual channel
+// values the LEDs are driven with
+static void apply_current_limit(struct led_rgb *buf, size_t n) {
+    uint32_t sum = 0;
     for (size_t i = 0; i < n; ++i) {
-        buf[i].r = brightness_scale(buf[i].r, pct);
-        buf[i].g = brightness_scale(buf[i].g, pct);
-        buf[i].b = brightness_scale(buf[i].b, pct);
+        sum += buf[i].r + buf[i].g + buf[i].b;
     }
+    if (sum == 0) {
+        return;
+    }
+
+    const uint32_t idle_ua = n * CONFIG_KB_BACKLIGHT_CURRENT_LED_IDLE_UA;
+    const uint32_t budget_ua = current_budget_ua();
+    const uint64_t channels_ua =
+        (uint64_t)sum * CONFIG_KB_BACKLIGHT_CURRENT_LED_CHANNEL_UA / 255;
+    if (idle_ua + channels_ua <= budget_ua) {
+        return;
+    }
+
+    // Whatever is left after the quiescent current is shared by channels
+    uint32_t avail_ua = budget_ua > idle_ua ? budget_ua - idle_ua : 0;
+    uint32_t scale = (uint32_t)(((uint64_t)avail_ua << 16) / channels_ua);
+    for (size_t i = 0; i < n; ++i) {
+        buf[i].r = (buf[i].r * scale) >> 16;
+        buf[i].g = (buf[i].g * scale) >> 16;
+        buf[i].b = (buf[i].b * scale) >> 16;
+    }
+}
+
+#else
+
+static inline void apply_current_limit(struct led_rgb *buf, size_t n) {
+    ARG_UNUSED(buf);
+    ARG_UNUSED(n);
+}
+
+#endif // CONFIG_KB_BACKLIGHT_CURRENT_LIMIT
+
+#if CONFIG_LED_STRIP_ASYNC
+static void strip_update_done(const struct device *dev, void *user_data) {
+    ARG_UNUSED(dev);
+    ARG_UNUSED(user_data);
+
+    k_sem_give(&bl_wake);
 }
+#endif // CONFIG_LED_STRIP_ASYNC
 
 int kb_backlight_init() {
     if (!device_is_ready(strip)) {
@@ -54,6 +199,14 @@ int kb_backlight_init() {
 
     kb_backlight_settings_init();
 
+    kb_leds_geom_init();
+
+    brightness_lut_rebuild(bl_state.brightness);
+
+#if CONFIG_LED_STRIP_ASYNC
+    led_strip_async_set_callback(strip, strip_update_done, NULL);
+#endif // CONFIG_LED_STRIP_ASYNC
+
     int err = kb_backlight_set_mode(bl_state.mode_idx);
     if (err) {
         LOG_ERR("Unable to set mode with index '%d' (err %d)",
@@ -77,7 +230,10 @@ unknown_err:
     return -3;
 }
 
-int kb_backlight_set_mode(size_t mode_idx) {
+// Setters below only change the runtime state, callers save it, wake the
+// backlight thread and notify with 'kb_backlight_changed'
+
+static int bl_set_mode(size_t mode_idx) {
     const size_t mode_count = kb_bl_mode_count();
     if (mode_count == 0)
         return -ENODEV;
@@ -98,7 +254,45 @@ int kb_backlight_set_mode(size_t mode_idx) {
     if (bl_state.on && bl_state.mode->init) {
         bl_state.mode->init(CONFIG_KB_KEY_COUNT);
     }
+    return 0;
+}
+
+static void bl_set_brightness(uint8_t brightness) {
+    brightness = MIN(brightness, 100);
+    brightness = MAX(brightness, 1);
+    if (brightness != bl_state.brightness) {
+        brightness_lut_rebuild(brightness);
+    }
+    bl_state.brightness = brightness;
+}
+
+static void bl_turn_on() {
+    bl_state.on = true;
+    frame_sent_valid = false;
+    if (bl_state.mode && bl_state.mode->init) {
+        bl_state.mode->init(CONFIG_KB_KEY_COUNT);
+    }
+}
+
+static void bl_turn_off() {
+    bl_state.on = false;
+    if (bl_state.mode && bl_state.mode->deinit) {
+        bl_state.mode->deinit();
+    }
+}
+
+static void kb_backlight_changed() {
     kb_bl_settings_save();
+    k_sem_give(&bl_wake);
+    kb_backlight_notify_update();
+}
+
+int kb_backlight_set_mode(size_t mode_idx) {
+    int err = bl_set_mode(mode_idx);
+    if (err) {
+        return err;
+    }
+    kb_backlight_changed();
     return 0;
 }
 
@@ -121,10 +315,16 @@ void kb_backlight_prev_mode(void) {
 }
 
 void kb_backlight_set_brightness(uint8_t brightness) {
-    brightness = MIN(brightness, 100);
-    brightness = MAX(brightness, 1);
-    bl_state.brightness = brightness;
-    kb_bl_settings_save();
+    bl_set_brightness(brightness);
+    kb_backlight_changed();
+}
+
+void kb_backlight_set_speed(float speed) {
+    if (speed <= 0.f) {
+        return;
+    }
+    bl_state.mode_speed = speed;
+    kb_backlight_changed();
 }
 
 void kb_backlight_toggle() {
@@ -133,51 +333,154 @@ void kb_backlight_toggle() {
     } else {
         kb_backlight_turn_on();
     }
-    kb_bl_settings_save();
 }
 
 void kb_backlight_turn_on() {
-    bl_state.on = true;
-    if (bl_state.mode && bl_state.mode->init) {
-        bl_state.mode->init(CONFIG_KB_KEY_COUNT);
-    }
-    kb_bl_settings_save();
+    bl_turn_on();
+    kb_backlight_changed();
 }
+
 void kb_backlight_turn_off() {
-    bl_state.on = false;
-    if (bl_state.mode && bl_state.mode->deinit) {
-        bl_state.mode->deinit();
+    bl_turn_off();
+    kb_backlight_changed();
+}
+
+// State requested by 'kb_backlight_request_state', applied by the backlight
+// thread
+static struct {
+    struct k_spinlock lock;
+    bool pending;
+    bool on;
+    size_t mode_idx;
+    uint8_t brightness;
+    float speed;
+} requested;
+
+void kb_backlight_request_state(bool on, size_t mode_idx, uint8_t brightness,
+                                float speed) {
+    k_spinlock_key_t key = k_spin_lock(&requested.lock);
+    requested.pending = true;
+    requested.on = on;
+    requested.mode_idx = mode_idx;
+    requested.brightness = brightness;
+    requested.speed = speed;
+    k_spin_unlock(&requested.lock, key);
+
+    k_sem_give(&bl_wake);
+}
+
+// Apply fields of the requested state which differ from the current one
+static void kb_backlight_apply_requested_state() {
+    k_spinlock_key_t key = k_spin_lock(&requested.lock);
+    if (!requested.pending) {
+        k_spin_unlock(&requested.lock, key);
+        return;
+    }
+    requested.pending = false;
+    bool on = requested.on;
+    size_t mode_idx = requested.mode_idx;
+    uint8_t brightness = requested.brightness;
+    float speed = requested.speed;
+    k_spin_unlock(&requested.lock, key);
+
+    bool changed = false;
+
+    if (brightness != bl_state.brightness) {
+        bl_set_brightness(brightness);
+        changed = true;
+    }
+    if (speed > 0.f && speed != bl_state.mode_speed) {
+        bl_state.mode_speed = speed;
+        changed = true;
+    }
+    // Off first and on last, so the mode is initialized at most once
+    if (!on && bl_state.on) {
+        bl_turn_off();
+        changed = true;
+    }
+    if (mode_idx != bl_state.mode_idx) {
+        int err = bl_set_mode(mode_idx);
+        if (err) {
+            LOG_WRN("Unable to set requested mode %u (err %d)",
+                    (unsigned)mode_idx, err);
+        } else {
+            changed = true;
+        }
+    }
+    if (on && !bl_state.on) {
+        bl_turn_on();
+        changed = true;
+    }
+
+    if (changed) {
+        kb_bl_settings_save();
+        kb_backlight_notify_update();
     }
-    kb_bl_settings_save();
 }
 
-void kb_backlight_handle() {
+k_timeout_t kb_backlight_handle() {
+    kb_backlight_apply_requested_state();
+
+    if (!bl_state.on) {
+        return K_FOREVER;
+    }
+
+    if (!bl_state.mode || !bl_state.mode->apply) {
+        return K_FOREVER;
+    }
+
     int64_t current = k_uptime_get();
     int64_t dt = current - last_update_time;
     if (dt < KB_BACKLIGHT_MIN_DELTA_MS) {
-        return;
+        return K_MSEC(KB_BACKLIGHT_MIN_DELTA_MS - dt);
     }
-    last_update_time = current;
 
-    if (!bl_state.on) {
-        return;
+#if CONFIG_LED_STRIP_ASYNC
+    // Previous frame may still be read by the strip driver,
+    // the completion callback wakes us up
+    if (led_strip_async_busy(strip)) {
+        return K_FOREVER;
     }
+#endif // CONFIG_LED_STRIP_ASYNC
 
-    if (!bl_state.mode || !bl_state.mode->apply) {
-        return;
+    last_update_time = current;
+
+    bool animating = bl_state.mode->apply(dt, bl_state.mode_speed, frame);
+    apply_brightness(frame, CONFIG_KB_KEY_COUNT);
+    apply_current_limit(frame, CONFIG_KB_KEY_COUNT);
+
+    k_timeout_t next =
+        animating ? K_MSEC(KB_BACKLIGHT_MIN_DELTA_MS) : K_FOREVER;
+
+    size_t len = frame_dirty_len();
+    if (len == 0) {
+        return next;
     }
 
-    bl_state.mode->apply(dt, bl_state.mode_speed, frame);
-    apply_brightness(frame, CONFIG_KB_KEY_COUNT, bl_state.brightness);
+    // Strip drivers are allowed to overwrite the frame, copy it first
+    memcpy(frame_sent, frame, len * sizeof(frame[0]));
+    frame_sent_valid = true;
 
-    int res = led_strip_update_rgb(strip, frame, CONFIG_KB_KEY_COUNT);
+    // LEDs past the last changed one keep their latched color,
+    // so only the changed prefix of the chain needs to be sent
+    int res = led_strip_update_rgb(strip, frame, len);
     if (res) {
         LOG_ERR("Unable to update strip (err %d)", res);
+        frame_sent_valid = false;
     }
+
+    return next;
+}
+
+void kb_backlight_wait(k_timeout_t timeout) {
+    k_sem_take(&bl_wake, timeout);
 }
 
 void kb_backlight_on_event(kb_key_t *key) {
     if (bl_state.mode && bl_state.mode->on_event) {
         bl_state.mode->on_event(key);
     }
+    // Idle modes without a callback (e.g. depth) render from the key state,
+    // so every event wakes the thread
+    k_sem_give(&bl_wake);
 }
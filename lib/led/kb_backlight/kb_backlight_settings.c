@@ -2,6 +2,8 @@
 
 #include <lib/led/kb_backlight_state.h>
 
+#include <lib/keyboard/kb_settings_persist.h>
+
 #include <zephyr/logging/log.h>
 #include <zephyr/settings/settings.h>
 
@@ -90,14 +92,21 @@ static struct settings_handler kb_bl_settings_handler = {
     .h_export = kb_bl_settings_export,
 };
 
-void kb_bl_settings_save(void) {
+static int kb_bl_settings_store(void) {
     backlight_state_img img;
     kb_backlight_settings_build_image_from_runtime(&img);
 
     int w = settings_save_one(KB_BL_SETTINGS_KEY, &img, sizeof(img));
     if (w) {
-        LOG_WRN("Could not save default backlight state: %d", w);
+        LOG_WRN("Could not save backlight state: %d", w);
     }
+    return w;
+}
+
+KB_SETTINGS_PERSIST_SECTION_DEFINE(bl, kb_bl_settings_store);
+
+void kb_bl_settings_save(void) {
+    kb_settings_persist_mark_dirty(KB_SETTINGS_PERSIST_SECTION(bl));
 }
 
 void kb_backlight_settings_init(void) {
@@ -130,14 +139,5 @@ void kb_backlight_settings_init(void) {
 load_defaults:
 
     kb_backlight_settings_load_default();
-
-    backlight_state_img img;
-    kb_backlight_settings_build_image_from_runtime(&img);
-
-    int w = settings_save_one(KB_BL_SETTINGS_KEY, &img, sizeof(img));
-    if (w) {
-        LOG_WRN("Could not save default backlight state: %d", w);
-    } else {
-        LOG_INF("Default backlight settings saved.");
-    }
+    kb_bl_settings_save();
 }
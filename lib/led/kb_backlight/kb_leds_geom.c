@@ -0,0 +1,127 @@
+#include <lib/led/kb_leds_geom.h>
+
+#include YKB_LEDS_GEOM_PATH
+
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_DECLARE(kb_backlight_led_strip, CONFIG_KB_BACKLIGHT_LOG_LEVEL);
+
+#define KB_LEDS_GEOM_LED_COUNT CONFIG_KB_KEY_COUNT
+#define KB_LEDS_GEOM_MAX_NEIGHBORS                                             \
+    MIN(CONFIG_KB_LEDS_GEOM_MAX_NEIGHBORS, KB_LEDS_GEOM_LED_COUNT)
+
+static struct kb_leds_neighbor neighbors[KB_LEDS_GEOM_LED_COUNT]
+                                        [KB_LEDS_GEOM_MAX_NEIGHBORS];
+static uint8_t neighbors_count[KB_LEDS_GEOM_LED_COUNT];
+
+static uint32_t isqrt32(uint32_t v) {
+    uint32_t res = 0;
+    uint32_t bit = 1u << 30;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (v >= res + bit) {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return res;
+}
+
+// Insert 'nb' into the sorted list of 'led', dropping the farthest one
+// when the list is full
+static void kb_leds_geom_insert(uint8_t led,
+                                const struct kb_leds_neighbor *nb) {
+    struct kb_leds_neighbor *list = neighbors[led];
+    size_t n = neighbors_count[led];
+
+    if (n == KB_LEDS_GEOM_MAX_NEIGHBORS) {
+        if (nb->d2 >= list[n - 1].d2) {
+            return;
+        }
+        n--;
+    }
+
+    size_t i = n;
+    while (i > 0 && list[i - 1].d2 > nb->d2) {
+        list[i] = list[i - 1];
+        i--;
+    }
+    list[i] = *nb;
+    neighbors_count[led] = n + 1;
+}
+
+int kb_leds_geom_init() {
+    const int32_t r2 = (int32_t)Q(CONFIG_KB_LEDS_GEOM_RADIUS) *
+                       (int32_t)Q(CONFIG_KB_LEDS_GEOM_RADIUS);
+    const uint32_t ring_width = Q(CONFIG_KB_LEDS_GEOM_RING_WIDTH);
+
+    size_t total = 0;
+    // Most LEDs found within the radius of a single LED
+    size_t max_found = 0;
+    // Nearest distance of a neighbor dropped due to a full list (Q8.8)
+    uint32_t cut_dist = UINT32_MAX;
+
+    for (size_t led = 0; led < KB_LEDS_GEOM_LED_COUNT; ++led) {
+        size_t found = 0;
+        neighbors_count[led] = 0;
+
+        for (size_t other = 0; other < KB_LEDS_GEOM_LED_COUNT; ++other) {
+            int32_t d2 = kb_leds_geom_sqdist_fp(
+                LEDS_POSITIONS[led].x, LEDS_POSITIONS[led].y,
+                LEDS_POSITIONS[other].x, LEDS_POSITIONS[other].y);
+            if (d2 > r2) {
+                continue;
+            }
+
+            uint32_t dist = isqrt32((uint32_t)d2);
+            found++;
+            struct kb_leds_neighbor nb = {
+                .d2 = d2,
+                .dist = (kb_fp16)dist,
+                .led = (uint8_t)other,
+                .ring = (uint8_t)MIN(dist / ring_width, UINT8_MAX),
+            };
+            kb_leds_geom_insert(led, &nb);
+        }
+
+        if (found > neighbors_count[led]) {
+            // The farthest kept neighbor is as near as a dropped one can be
+            const struct kb_leds_neighbor *last =
+                &neighbors[led][neighbors_count[led] - 1];
+            cut_dist = MIN(cut_dist, (uint32_t)last->dist);
+        }
+
+        total += neighbors_count[led];
+        max_found = MAX(max_found, found);
+    }
+
+    if (cut_dist != UINT32_MAX) {
+        LOG_WRN("LED neighbor lists truncated to %d entries, %zu needed: "
+                "spatial modes are cut off past %u.%02u units",
+                KB_LEDS_GEOM_MAX_NEIGHBORS, max_found, cut_dist >> KB_Q,
+                ((cut_dist & BIT_MASK(KB_Q)) * 100) >> KB_Q);
+    }
+
+    LOG_DBG("LEDs geometry: %zu neighbors within radius %d", total,
+            CONFIG_KB_LEDS_GEOM_RADIUS);
+
+    return 0;
+}
+
+const struct kb_leds_neighbor *kb_leds_geom_neighbors(uint8_t led,
+                                                      size_t *count) {
+    if (led >= KB_LEDS_GEOM_LED_COUNT) {
+        *count = 0;
+        return NULL;
+    }
+
+    *count = neighbors_count[led];
+    return neighbors[led];
+}
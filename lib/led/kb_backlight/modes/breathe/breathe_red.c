@@ -1,10 +1,12 @@
+#include <lib/led/kb_backlight.h>
 #include <lib/led/kb_bl_mode.h>
 
+// Full breathe cycle at speed 1
+#define BREATHE_PERIOD_MS 6600
+
 typedef struct {
     struct led_rgb rgb;
     size_t len;
-    int8_t breathe_bright;
-    bool inc;
 } static_red_data;
 
 static static_red_data data = {0};
@@ -16,35 +18,33 @@ static void init(size_t len) {
         .g = 0,
         .b = 0,
     };
-    data.breathe_bright = 0;
-    data.inc = true;
 }
 
 static void deinit() {
     data.rgb.r = 0;
 }
 
-static void apply(uint32_t dt_ms, float speed, struct led_rgb *frame) {
-    for (size_t i = 0; i < data.len; ++i) {
-        frame[i] = data.rgb;
-        frame[i].r *= (double)data.breathe_bright / 100;
+static bool apply(uint32_t dt_ms, float speed, struct led_rgb *frame) {
+    // Phase is derived from the shared animation clock so both halves
+    // of split keyboards breathe in sync
+    float period_f = BREATHE_PERIOD_MS / (speed > 0.f ? speed : 1.f);
+    uint32_t period = MAX((uint32_t)period_f, 2);
+    uint32_t phase = kb_backlight_clock_ms() % period;
+
+    // Triangle wave 0 -> 100 -> 0
+    uint32_t breathe_bright = (phase * 200) / period;
+    if (breathe_bright > 100) {
+        breathe_bright = 200 - breathe_bright;
     }
 
-    if (data.inc) {
-        data.breathe_bright += 1;
-        if (data.breathe_bright >= 100) {
-            data.breathe_bright = 100;
-            data.inc = false;
-        }
+    struct led_rgb rgb = data.rgb;
+    rgb.r = (uint8_t)((rgb.r * breathe_bright) / 100);
 
-        return;
+    for (size_t i = 0; i < data.len; ++i) {
+        frame[i] = rgb;
     }
 
-    data.breathe_bright -= 1;
-    if (data.breathe_bright <= 0) {
-        data.breathe_bright = 0;
-        data.inc = true;
-    }
+    return true;
 }
 
 KB_BL_MODE_DEFINE(breathe_red, init, deinit, apply, NULL);
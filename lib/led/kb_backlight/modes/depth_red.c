@@ -0,0 +1,53 @@
+#include <lib/keyboard/kb_depth.h>
+#include <lib/led/kb_bl_mode.h>
+#include YKB_LEDS_GEOM_PATH
+
+// Red brightness of every key follows how deep the key is pressed
+
+#define KEY2LED KEY_IDX_TO_LED_IDX_MAP
+
+typedef struct {
+    size_t len;
+    uint8_t depths[CONFIG_KB_KEY_COUNT];
+} depth_red_data;
+
+static depth_red_data data = {0};
+
+static void init(size_t len) {
+    data.len = len;
+    memset(data.depths, 0, sizeof(data.depths));
+}
+
+static void deinit() {
+    memset(&data, 0, sizeof(data));
+}
+
+static bool apply(uint32_t dt_ms, float speed, struct led_rgb *frame) {
+    // Keep the previous snapshot if the scan loop is busy publishing
+    uint8_t depths[CONFIG_KB_KEY_COUNT];
+    if (!kb_depth_snapshot(depths)) {
+        memcpy(data.depths, depths, sizeof(depths));
+    }
+
+    bool animating = false;
+
+    for (size_t i = 0; i < data.len; ++i) {
+        frame[i] = (struct led_rgb){0};
+    }
+
+    for (size_t key = 0; key < CONFIG_KB_KEY_COUNT; ++key) {
+        uint8_t led = KEY2LED[key];
+        if (led >= data.len) {
+            continue;
+        }
+        frame[led].r = data.depths[key];
+        if (data.depths[key]) {
+            animating = true;
+        }
+    }
+
+    // Keep rendering while any key is held, a press wakes us up otherwise
+    return animating;
+}
+
+KB_BL_MODE_DEFINE(depth_red, init, deinit, apply, NULL);
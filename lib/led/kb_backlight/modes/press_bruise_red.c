@@ -9,11 +9,16 @@
 #define RADIUS_Q Q(RADIUS_UNITS) // Q8.8 radius
 // ---------------------------------------------------------------------------
 
+BUILD_ASSERT(RADIUS_UNITS <= CONFIG_KB_LEDS_GEOM_RADIUS,
+             "Bruise radius exceeds precomputed LED neighbor lists");
+
 typedef struct {
     bool alive;
-    kb_fp16 cx, cy;   // center (Q8.8)
-    uint32_t age_ms;  // age of bruise
-    uint32_t life_ms; // lifespan
+    bool remote;                    // centered on a key of the other half
+    uint8_t led;                    // center LED (local spots)
+    struct kb_leds_position center; // center position (remote spots)
+    uint32_t age_ms;                // age of bruise
+    uint32_t life_ms;               // lifespan
 } spot_t;
 
 typedef struct {
@@ -23,16 +28,10 @@ typedef struct {
 
 static bruise_state_t S;
 
-#define LED_POS LEDS_POSITIONS
 #define KEY2LED KEY_IDX_TO_LED_IDX_MAP
 
-// distance^2 in Q16.16 (from kb_leds_geom.h helper)
-static inline int32_t d2_led(uint8_t led, kb_fp16 cx, kb_fp16 cy) {
-    return kb_leds_geom_sqdist_fp(LED_POS[led].x, LED_POS[led].y, cx, cy);
-}
-
-// Add/replace a spot at (cx,cy)
-static void spawn_spot(kb_fp16 cx, kb_fp16 cy) {
+// Add/replace a spot, returns it for the caller to set the center
+static spot_t *spawn_spot(void) {
     // find a free slot, else overwrite the oldest
     int victim = -1;
     uint32_t oldest = 0;
@@ -48,24 +47,76 @@ static void spawn_spot(kb_fp16 cx, kb_fp16 cy) {
     }
     spot_t *sp = &S.spots[victim];
     sp->alive = true;
-    sp->cx = cx;
-    sp->cy = cy;
+    sp->remote = false;
     sp->age_ms = 0;
     sp->life_ms = BASE_LIFE_MS;
+    return sp;
+}
+
+// Add the red of a spot with envelope 'env' to LED 'i' at 'd2' from its
+// center, linear falloff with distance^2 (no sqrt):
+// val = env * (R2 - d2) / R2
+static void add_contrib(struct led_rgb *frame, size_t i, uint16_t env,
+                        int32_t d2, int32_t R2) {
+    uint32_t num = (uint32_t)(R2 - d2);
+    uint32_t contrib = (env * num) / (uint32_t)R2; // 0..255
+    uint16_t r = frame[i].r + (uint16_t)contrib;
+    frame[i].r = (r > 255) ? 255 : (uint8_t)r;
+}
+
+#if CONFIG_YKB_SPLIT
+
+// Squared distance of local LED 'i' from 'pos'
+static inline int32_t local_sqdist(size_t i, struct kb_leds_position pos) {
+    return kb_leds_geom_sqdist_fp(LEDS_POSITIONS[i].x, LEDS_POSITIONS[i].y,
+                                  pos.x, pos.y);
 }
 
+// Bruise around other half key 'index', placed in our coordinates
+static void spawn_remote_spot(uint8_t index) {
+    if (index >= ARRAY_SIZE(KEY_IDX_TO_LED_IDX_MAP_REMOTE))
+        return;
+    uint8_t led = KEY_IDX_TO_LED_IDX_MAP_REMOTE[index];
+    if (led >= ARRAY_SIZE(LEDS_POSITIONS_REMOTE))
+        return;
+
+    struct kb_leds_position center =
+        LEDS_POSITION_FROM_REMOTE(LEDS_POSITIONS_REMOTE[led]);
+
+    // Do not evict local spots for one which lights nothing here
+    const int32_t R2 = (int32_t)RADIUS_Q * (int32_t)RADIUS_Q;
+    size_t len = MIN(S.len, ARRAY_SIZE(LEDS_POSITIONS));
+    size_t i = 0;
+    while (i < len && local_sqdist(i, center) >= R2)
+        ++i;
+    if (i == len)
+        return;
+
+    spot_t *sp = spawn_spot();
+    sp->remote = true;
+    sp->center = center;
+}
+
+#endif // CONFIG_YKB_SPLIT
+
 // on_event: light around the pressed key (release ignored)
 static void on_event(kb_key_t *key) {
     if (!key || !key->pressed)
         return;
 
+    if (key->remote) {
+#if CONFIG_YKB_SPLIT
+        spawn_remote_spot(key->index);
+#endif // CONFIG_YKB_SPLIT
+        return;
+    }
+
     // Map key index -> LED index on the current side
     uint8_t led_idx = KEY2LED[key->index];
     if (led_idx >= S.len)
         return;
 
-    // Center at that LED's position
-    spawn_spot(LED_POS[led_idx].x, LED_POS[led_idx].y);
+    spawn_spot()->led = led_idx;
 }
 
 // init/deinit
@@ -79,7 +130,7 @@ static void deinit(void) {
 }
 
 // Core apply: accumulate contributions from all alive spots
-static void apply(uint32_t dt_ms, float speed, struct led_rgb *frame) {
+static bool apply(uint32_t dt_ms, float speed, struct led_rgb *frame) {
     // advance ages (scale by speed; clamp to avoid wild jumps)
     if (dt_ms > 100)
         dt_ms = 100;
@@ -92,6 +143,8 @@ static void apply(uint32_t dt_ms, float speed, struct led_rgb *frame) {
     for (size_t i = 0; i < S.len; ++i)
         frame[i] = (struct led_rgb){0};
 
+    bool animating = false;
+
     // accumulate red per LED from each spot
     for (int s = 0; s < MAX_SPOTS; ++s) {
         spot_t *sp = &S.spots[s];
@@ -106,27 +159,46 @@ static void apply(uint32_t dt_ms, float speed, struct led_rgb *frame) {
         }
         uint16_t env = 255u - (uint16_t)((age * 255u) / sp->life_ms);
 
-        // each LED gets contribution if within radius
-        for (size_t i = 0; i < S.len; ++i) {
-            int32_t d2 = d2_led((uint8_t)i, sp->cx, sp->cy); // Q16.16
-            if (d2 >= R2)
-                continue; // outside circle
-
-            // linear falloff with distance^2 (no sqrt):
-            // val = env * (R2 - d2) / R2
-            // Keep in 32-bit, clamp at 255
-            uint32_t num = (uint32_t)(R2 - d2);
-            uint32_t contrib = (env * num) / (uint32_t)R2; // 0..255
-            uint16_t r = frame[i].r + (uint16_t)contrib;
-            frame[i].r = (r > 255) ? 255 : (uint8_t)r;
+#if CONFIG_YKB_SPLIT
+        if (sp->remote) {
+            // no neighbor list for other half keys, check every LED
+            size_t len = MIN(S.len, ARRAY_SIZE(LEDS_POSITIONS));
+            for (size_t i = 0; i < len; ++i) {
+                int32_t d2 = local_sqdist(i, sp->center); // Q16.16
+                if (d2 < R2)
+                    add_contrib(frame, i, env, d2, R2);
+            }
+        } else
+#endif // CONFIG_YKB_SPLIT
+        {
+            // each LED gets contribution if within radius, neighbors are
+            // sorted by distance so stop at the first one outside the circle
+            size_t nb_count;
+            const struct kb_leds_neighbor *nb =
+                kb_leds_geom_neighbors(sp->led, &nb_count);
+            for (size_t n = 0; n < nb_count; ++n) {
+                int32_t d2 = nb[n].d2; // Q16.16
+                if (d2 >= R2)
+                    break; // outside circle
+                size_t i = nb[n].led;
+                if (i >= S.len)
+                    continue;
+                add_contrib(frame, i, env, d2, R2);
+            }
         }
 
         sp->age_ms += age_step;
         if (sp->age_ms >= sp->life_ms)
             sp->alive = false;
+
+        // a spot still fading, or one which just died and needs one more
+        // frame to be cleared
+        animating = true;
     }
 
     // green/blue remain 0 (pure red)
+
+    return animating;
 }
 
 KB_BL_MODE_DEFINE(press_bruise_red, init, deinit, apply, on_event);
@@ -20,10 +20,12 @@ static void deinit() {
     data.rgb.r = 0;
 }
 
-static void apply(uint32_t dt_ms, float speed, struct led_rgb *frame) {
+static bool apply(uint32_t dt_ms, float speed, struct led_rgb *frame) {
     for (size_t i = 0; i < data.len; ++i) {
         frame[i] = data.rgb;
     }
+
+    return false;
 }
 
 KB_BL_MODE_DEFINE(static_red, init, deinit, apply, NULL);
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+
+'''kb_backlight_gamma_lut.py
+
+Generate the backlight gamma LUTs of
+lib/led/kb_backlight/kb_backlight_gamma.h:
+
+  kb_backlight_gamma_lut.py > lib/led/kb_backlight/kb_backlight_gamma.h
+  kb_backlight_gamma_lut.py --check     # print the worst interpolation error
+
+One LUT per CONFIG_KB_BACKLIGHT_GAMMA value (in tenths), entry i holds
+(i / size)^gamma scaled to LUT_ONE, so the firmware only interpolates.'''
+
+import argparse
+import sys
+
+LUT_BITS = 8
+LUT_SIZE = 1 << LUT_BITS
+LUT_ONE = 0xFFFF
+
+# Range of CONFIG_KB_BACKLIGHT_GAMMA
+GAMMA_MIN = 10
+GAMMA_MAX = 30
+
+
+def lut(gamma):
+    return [round((i / LUT_SIZE) ** (gamma / 10) * LUT_ONE)
+            for i in range(LUT_SIZE + 1)]
+
+
+def max_error(gamma, steps=10000):
+    '''Worst difference of the interpolated LUT from the curve, in 8-bit
+    channel steps.'''
+    table = lut(gamma)
+    worst = 0
+    for k in range(steps + 1):
+        x = k / steps
+        pos = x * LUT_SIZE
+        i = min(int(pos), LUT_SIZE - 1)
+        y = table[i] + (table[i + 1] - table[i]) * (pos - i)
+        worst = max(worst, abs(y / LUT_ONE - x ** (gamma / 10)) * 255)
+    return worst
+
+
+def macro_line(text):
+    '''Line of a multi-line macro, backslash at column 80.'''
+    return text.ljust(79) + '\\\n'
+
+
+def emit(out):
+    out.write('// Generated by scripts/kb_backlight_gamma_lut.py, '
+              'do not edit\n\n')
+    out.write('#ifndef LIB_KB_BACKLIGHT_GAMMA_H_\n')
+    out.write('#define LIB_KB_BACKLIGHT_GAMMA_H_\n\n')
+    out.write(f'#define KB_BACKLIGHT_GAMMA_LUT_BITS {LUT_BITS}\n')
+    out.write(f'#define KB_BACKLIGHT_GAMMA_LUT_ONE {LUT_ONE}\n')
+    for gamma in range(GAMMA_MIN, GAMMA_MAX + 1):
+        table = lut(gamma)
+        out.write(f'\n// Gamma {gamma / 10:.1f}\n')
+        out.write(macro_line(f'#define KB_BACKLIGHT_GAMMA_LUT_{gamma}'))
+        out.write(macro_line('    {'))
+        for i in range(0, len(table), 10):
+            row = ', '.join(str(v) for v in table[i:i + 10])
+            if i + 10 < len(table):
+                row += ','
+            out.write(macro_line('        ' + row))
+        out.write('    }\n')
+    out.write('\n#endif // LIB_KB_BACKLIGHT_GAMMA_H_\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Backlight gamma LUT generator')
+    parser.add_argument('--check', action='store_true',
+                        help='print interpolation errors instead')
+    args = parser.parse_args()
+
+    if args.check:
+        for gamma in range(GAMMA_MIN, GAMMA_MAX + 1):
+            print(f'{gamma / 10:.1f}: {max_error(gamma):.3f} (channel steps)')
+        return
+    emit(sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,287 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+
+'''kb_configurator.py
+
+Talk to the keyboard over the vendor HID interface
+(see include/lib/keyboard/kb_configurator.h).
+
+  kb_configurator.py info
+  kb_configurator.py read calib
+  kb_configurator.py write-calib 3 520 1010 900
+  kb_configurator.py write-actuation 3 1.2     # mm
+  kb_configurator.py calibrate-rest           # hands off the keyboard
+  kb_configurator.py calibrate                # press every key down
+  kb_configurator.py stream --duration 5 > values.csv
+
+Needs the 'hidapi' Python package.'''
+
+import argparse
+import struct
+import sys
+import time
+
+VID = 0x6969
+USAGE_PAGE = 0xff60
+
+REPORT_SIZE = 63
+REPORT_COMMAND, REPORT_RESPONSE, REPORT_STREAM = 2, 3, 4
+
+CMD_INFO = 0x01
+CMD_READ = 0x10
+CMD_WRITE = 0x11
+CMD_CALIBRATE = 0x20
+CMD_STREAM = 0x30
+
+SECTIONS = {
+    'main': 0,
+    'calib': 1,
+    'keymap': 2,
+    'calib_slave': 3,
+    'keymap_slave': 4,
+    'actuation': 5,
+}
+
+CALIBRATE_REST = 0
+CALIBRATE_START = 1
+CALIBRATE_FINISH = 2
+CALIBRATE_ABORT = 3
+CALIBRATE_STATUS = 4
+CALIBRATION_IDLE = 0
+
+STREAM_HEADER = struct.Struct('<HIBB')
+
+
+class ProtoError(Exception):
+    pass
+
+
+class Keyboard:
+
+    def __init__(self, path=None):
+        import hid  # hidapi
+
+        if path is None:
+            for dev in hid.enumerate(VID):
+                if dev['usage_page'] == USAGE_PAGE:
+                    path = dev['path']
+                    break
+            else:
+                raise ProtoError('no keyboard vendor interface found')
+        self.dev = hid.device()
+        self.dev.open_path(path)
+        self.tag = 0
+
+    def command(self, cmd, args=b'', timeout_ms=1000):
+        '''Send 'cmd' with 'args' and return the response data.'''
+        self.tag = (self.tag + 1) & 0xff
+        report = bytes([REPORT_COMMAND, cmd, self.tag]) + bytes(args)
+        self.dev.write(report.ljust(REPORT_SIZE + 1, b'\0'))
+
+        deadline = time.monotonic() + timeout_ms / 1000
+        while time.monotonic() < deadline:
+            data = bytes(self.dev.read(REPORT_SIZE + 1, timeout_ms))
+            # Stream reports may be interleaved with the response
+            if len(data) < 4 or data[0] != REPORT_RESPONSE:
+                continue
+            if data[1] != cmd or data[2] != self.tag:
+                continue
+            status = struct.unpack('b', data[3:4])[0]
+            if status:
+                raise ProtoError(f'command 0x{cmd:02x} failed ({status})')
+            return data[4:]
+        raise ProtoError(f'no response to command 0x{cmd:02x}')
+
+    def info(self):
+        data = self.command(CMD_INFO)
+        version, keys, slave_keys, rules, profile, generation, per_report = \
+            struct.unpack_from('<BBBBBIB', data)
+        travel = struct.unpack_from('<H', data, 10)[0] \
+            if len(data) >= 12 else 0
+        return {
+            'version': version,
+            'keys': keys,
+            'slave_keys': slave_keys,
+            'max_rules': rules,
+            'profile': profile,
+            'generation': generation,
+            'stream_keys_per_report': per_report,
+            'travel_mm': travel / 100,
+        }
+
+    def read(self, section, first, count):
+        '''Return (first key, items bytes) of up to 'count' keys.'''
+        data = self.command(CMD_READ, bytes([section, first, count]))
+        _, first, count = data[:3]
+        return first, count, data[3:]
+
+    def stream(self, interval):
+        return self.command(CMD_STREAM, bytes([interval]))
+
+
+def cmd_info(kb, args):
+    for name, value in kb.info().items():
+        print(f'{name}: {value}')
+
+
+def cmd_read(kb, args):
+    info = kb.info()
+    section = SECTIONS[args.section]
+    if section == SECTIONS['main']:
+        _, _, data = kb.read(section, 0, 1)
+        mode, polling_rate = struct.unpack_from('<BH', data)
+        print(f'mode: {mode}\npolling_rate_ms: {polling_rate}')
+        return
+
+    keys = info['slave_keys'] if args.section.endswith('_slave') else \
+        info['keys']
+    rules = info['max_rules']
+    key = 0
+    while key < keys:
+        first, count, data = kb.read(section, key, keys - key)
+        for i in range(count):
+            if section in (SECTIONS['calib'], SECTIONS['calib_slave']):
+                lo, hi, thr = struct.unpack_from('<HHH', data, i * 6)
+                print(f'key {first + i}: min={lo} max={hi} threshold={thr}')
+            elif section == SECTIONS['actuation']:
+                point = struct.unpack_from('<H', data, i * 2)[0]
+                print(f'key {first + i}: {point / 100:.2f} mm')
+            else:
+                size = 1 + 3 * rules
+                item = data[i * size:(i + 1) * size]
+                pairs = [struct.unpack_from('<HB', item, 1 + r * 3)
+                         for r in range(item[0])]
+                text = ' '.join(f'{layer:#x}:{code:#04x}'
+                                for layer, code in pairs)
+                print(f'key {first + i}: {text}')
+        key = first + count
+
+
+def cmd_write_calib(kb, args):
+    section = SECTIONS['calib_slave' if args.slave else 'calib']
+    item = struct.pack('<HHH', args.minimum, args.maximum, args.threshold)
+    kb.command(CMD_WRITE, bytes([section, args.key, 1]) + item)
+
+
+def cmd_write_actuation(kb, args):
+    item = struct.pack('<H', round(args.mm * 100))
+    kb.command(CMD_WRITE, bytes([SECTIONS['actuation'], args.key, 1]) + item)
+
+
+def cmd_calibrate_rest(kb, args):
+    data = kb.command(CMD_CALIBRATE, bytes([CALIBRATE_REST]))
+    print(f'{data[0]} keys calibrated')
+
+
+def cmd_calibrate(kb, args):
+    kb.command(CMD_CALIBRATE, bytes([CALIBRATE_START]))
+    print('press every key all the way down, Ctrl-C to abort',
+          file=sys.stderr)
+    end = time.monotonic() + args.duration if args.duration else None
+    try:
+        while True:
+            time.sleep(0.5)
+            if end is not None and time.monotonic() >= end:
+                kb.command(CMD_CALIBRATE, bytes([CALIBRATE_FINISH]))
+                end = None
+            state, count = kb.command(CMD_CALIBRATE,
+                                      bytes([CALIBRATE_STATUS]))[:2]
+            if state == CALIBRATION_IDLE:
+                break
+    except KeyboardInterrupt:
+        kb.command(CMD_CALIBRATE, bytes([CALIBRATE_ABORT]))
+        raise ProtoError('calibration aborted')
+    print(f'{count} keys calibrated')
+
+
+def cmd_stream(kb, args):
+    keys = kb.info()['keys']
+    data = kb.stream(args.interval)
+    print(f'streaming every {data[0]} scans, {data[1]} reports per frame',
+          file=sys.stderr)
+
+    print(','.join(['seq', 'time_us'] + [f'key{i}' for i in range(keys)]))
+    frames = lost = 0
+    prev_seq = None
+    values = [0] * keys
+    seq = None
+    end = time.monotonic() + args.duration
+    try:
+        while time.monotonic() < end:
+            report = bytes(kb.dev.read(REPORT_SIZE + 1, 100))
+            if len(report) < 1 + STREAM_HEADER.size or \
+                    report[0] != REPORT_STREAM:
+                continue
+            seq, time_us, first, count = STREAM_HEADER.unpack_from(report, 1)
+            values[first:first + count] = struct.unpack_from(
+                f'<{count}H', report, 1 + STREAM_HEADER.size)
+            if first + count < keys:
+                continue
+
+            # Last report of the frame
+            if prev_seq is not None:
+                lost += (seq - prev_seq - 1) & 0xffff
+            prev_seq = seq
+            frames += 1
+            print(','.join(str(v) for v in [seq, time_us] + values))
+    finally:
+        kb.stream(0)
+    print(f'{frames} frames, {lost} lost, '
+          f'{frames / args.duration:.1f} frames/s', file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Keyboard configurator protocol client')
+    parser.add_argument('--path', help='hidraw path of the vendor interface')
+    sub = parser.add_subparsers(dest='cmd', required=True)
+
+    p = sub.add_parser('info', help='print keyboard information')
+    p.set_defaults(func=cmd_info)
+
+    p = sub.add_parser('read', help='print a settings section')
+    p.add_argument('section', choices=SECTIONS.keys())
+    p.set_defaults(func=cmd_read)
+
+    p = sub.add_parser('write-calib', help='set calibration of a key')
+    p.add_argument('key', type=int)
+    p.add_argument('minimum', type=int)
+    p.add_argument('maximum', type=int)
+    p.add_argument('threshold', type=int)
+    p.add_argument('--slave', action='store_true',
+                   help='key of the slave half')
+    p.set_defaults(func=cmd_write_calib)
+
+    p = sub.add_parser('write-actuation',
+                       help='set actuation point of a key')
+    p.add_argument('key', type=int)
+    p.add_argument('mm', type=float)
+    p.set_defaults(func=cmd_write_actuation)
+
+    p = sub.add_parser('calibrate-rest',
+                       help='take current values as released values')
+    p.set_defaults(func=cmd_calibrate_rest)
+
+    p = sub.add_parser('calibrate',
+                       help='capture released and pressed values of keys')
+    p.add_argument('--duration', type=float,
+                   help='seconds before finishing early '
+                   '(default: the keyboard calibration window)')
+    p.set_defaults(func=cmd_calibrate)
+
+    p = sub.add_parser('stream', help='print live key values as CSV')
+    p.add_argument('--interval', type=int, default=1,
+                   help='scans per frame (1 = every scan)')
+    p.add_argument('--duration', type=float, default=10.0,
+                   help='seconds to stream')
+    p.set_defaults(func=cmd_stream)
+
+    args = parser.parse_args()
+    try:
+        args.func(Keyboard(args.path), args)
+    except ProtoError as e:
+        sys.exit(f'error: {e}')
+
+
+if __name__ == '__main__':
+    main()
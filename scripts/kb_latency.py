@@ -0,0 +1,215 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+
+'''kb_latency.py
+
+Capture and decode hot path latency dumps
+(see include/lib/keyboard/kb_latency.h).
+
+  kb_latency.py capture /dev/ttyACM1 dump.ykbl   # firmware built with *_latency
+  kb_latency.py report dump.ykbl
+  kb_latency.py entries dump.ykbl > entries.csv
+
+Every time the port is opened the keyboard dumps its trace ring, so type
+something first, then capture.'''
+
+import argparse
+import struct
+import sys
+
+MAGIC = b'YKBL'
+VERSION = 1
+HEADER = struct.Struct('<4sBBHII')
+ENTRY = struct.Struct('<IBBBB')
+
+SAMPLE, EDGE, KEYMAP, REPORT_BUILD, REPORT_SUBMIT = range(5)
+STAGE_NAMES = ['sample', 'edge', 'keymap', 'report_build', 'report_submit']
+KEY_NONE = 0xff
+FLAG_PRESS = 0x01
+
+# (name, from stage, to stage)
+INTERVALS = [
+    ('sample -> edge', SAMPLE, EDGE),
+    ('edge -> keymap', EDGE, KEYMAP),
+    ('keymap -> build', KEYMAP, REPORT_BUILD),
+    ('build -> submit', REPORT_BUILD, REPORT_SUBMIT),
+    ('sample -> submit', SAMPLE, REPORT_SUBMIT),
+]
+
+HIST_BINS = 10
+HIST_WIDTH = 40
+
+
+class DumpError(Exception):
+    pass
+
+
+def decode(data):
+    '''Return (cycles per second, entries) of dump 'data'.
+
+    Entries are (cycles, stage, key, flags, seq) tuples, oldest first.'''
+    if len(data) < HEADER.size:
+        raise DumpError('dump too short')
+    magic, version, _, entry_size, hz, count = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise DumpError('bad magic')
+    if version != VERSION:
+        raise DumpError(f'unsupported version {version}')
+    if entry_size != ENTRY.size:
+        raise DumpError(f'unexpected entry size {entry_size}')
+    if hz == 0:
+        raise DumpError('bad cycle counter frequency')
+
+    end = HEADER.size + count * ENTRY.size
+    if len(data) < end:
+        raise DumpError(f'truncated dump, {count} entries expected')
+
+    entries = [ENTRY.unpack_from(data, HEADER.size + i * ENTRY.size)
+               for i in range(count)]
+    return hz, entries
+
+
+def polls(entries):
+    '''Split entries into lists belonging to a single kscan poll.
+
+    The ring may start in the middle of a poll, such entries are skipped.'''
+    poll = None
+    for entry in entries:
+        stage, seq = entry[1], entry[4]
+        if stage == SAMPLE:
+            if poll:
+                yield poll
+            poll = [entry]
+        elif poll is not None and seq == poll[0][4]:
+            poll.append(entry)
+    if poll:
+        yield poll
+
+
+def intervals(hz, entries):
+    '''Return {interval name: [microseconds]} over all polls.'''
+    result = {name: [] for name, _, _ in INTERVALS}
+
+    def us(start, end):
+        # Cycle counter is 32 bit and wraps
+        return ((end - start) & 0xffffffff) * 1e6 / hz
+
+    for poll in polls(entries):
+        sample = poll[0][0]
+        edges = {}
+        keymaps = []
+        build = None
+        for cycles, stage, key, _, _ in poll[1:]:
+            if stage == EDGE:
+                edges.setdefault(key, cycles)
+                result['sample -> edge'].append(us(sample, cycles))
+            elif stage == KEYMAP:
+                keymaps.append(cycles)
+                if key in edges:
+                    result['edge -> keymap'].append(us(edges[key], cycles))
+            elif stage == REPORT_BUILD:
+                build = cycles
+                if keymaps:
+                    result['keymap -> build'].append(
+                        us(keymaps[-1], cycles))
+            elif stage == REPORT_SUBMIT:
+                if build is not None:
+                    result['build -> submit'].append(us(build, cycles))
+                result['sample -> submit'].append(us(sample, cycles))
+    return result
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def histogram(values):
+    lo, hi = min(values), max(values)
+    width = (hi - lo) / HIST_BINS or 1
+    bins = [0] * HIST_BINS
+    for v in values:
+        bins[min(HIST_BINS - 1, int((v - lo) / width))] += 1
+    top = max(bins)
+    for i, n in enumerate(bins):
+        bar = '#' * round(n * HIST_WIDTH / top)
+        print(f'  {lo + i * width:9.1f} us | {bar} {n}')
+
+
+def cmd_capture(args):
+    import serial  # pyserial
+
+    data = b''
+    # Opening the port asserts DTR, which triggers the dump
+    with serial.Serial(args.port, timeout=args.timeout) as port:
+        while True:
+            chunk = port.read(4096)
+            if not chunk:
+                break
+            data += chunk
+    if not data:
+        sys.exit('error: nothing received')
+    with open(args.output, 'wb') as out:
+        out.write(data)
+    print(f'{len(data)} bytes captured', file=sys.stderr)
+
+
+def cmd_report(args):
+    hz, entries = decode(open(args.dump, 'rb').read())
+    print(f'entries: {len(entries)} ({hz} cycles/s)')
+    for name, values in intervals(hz, entries).items():
+        print()
+        if not values:
+            print(f'{name}: no samples')
+            continue
+        print(f'{name}: n={len(values)} '
+              f'p50={percentile(values, 50):.1f} us '
+              f'p99={percentile(values, 99):.1f} us '
+              f'max={max(values):.1f} us')
+        if not args.no_hist:
+            histogram(values)
+
+
+def cmd_entries(args):
+    hz, entries = decode(open(args.dump, 'rb').read())
+    print('time_us,stage,key,press,seq')
+    start = entries[0][0] if entries else 0
+    for cycles, stage, key, flags, seq in entries:
+        time_us = ((cycles - start) & 0xffffffff) * 1e6 / hz
+        name = STAGE_NAMES[stage] if stage < len(STAGE_NAMES) else stage
+        key = '' if key == KEY_NONE else key
+        print(f'{time_us:.1f},{name},{key},{int(bool(flags & FLAG_PRESS))},'
+              f'{seq}')
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Capture and decode hot path latency dumps')
+    sub = parser.add_subparsers(dest='cmd', required=True)
+
+    p = sub.add_parser('capture', help='capture dump sent by the keyboard')
+    p.add_argument('port', help='latency serial port (CDC ACM)')
+    p.add_argument('output', help='dump file to write')
+    p.add_argument('--timeout', type=float, default=1.0,
+                   help='seconds of silence ending the dump')
+    p.set_defaults(func=cmd_capture)
+
+    p = sub.add_parser('report', help='print per-stage latency statistics')
+    p.add_argument('dump')
+    p.add_argument('--no-hist', action='store_true',
+                   help='do not print histograms')
+    p.set_defaults(func=cmd_report)
+
+    p = sub.add_parser('entries', help='print raw trace entries as CSV')
+    p.add_argument('dump')
+    p.set_defaults(func=cmd_entries)
+
+    args = parser.parse_args()
+    try:
+        args.func(args)
+    except DumpError as e:
+        sys.exit(f'error: {e}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+
+'''kb_trace.py
+
+Record and inspect raw key value traces (see include/lib/keyboard/kb_trace.h).
+
+  kb_trace.py record /dev/ttyACM1 session.ykbt   # firmware built with *_trace
+  kb_trace.py info session.ykbt
+  kb_trace.py dump session.ykbt > session.csv
+  kb_trace.py synth typing.keys typing.ykbt --keys 22
+
+Recorded or synthesized traces are replayed on native_sim with
+`make native_sim_replay TRACE=session.ykbt`.
+
+Synth scripts hold one tap per line, '#' starts a comment:
+
+  # <press time ms> <key index> <hold ms>
+  3000 4 40
+  3100 5 40'''
+
+import argparse
+import struct
+import sys
+
+MAGIC = b'YKBT'
+VERSION = 1
+HEADER = struct.Struct('<4sBxH')
+
+
+class TraceError(Exception):
+    pass
+
+
+def decode(data):
+    '''Yield (time_us, values) for every frame of trace 'data'.'''
+    if len(data) < HEADER.size:
+        raise TraceError('trace too short')
+    magic, version, key_count = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise TraceError('bad magic')
+    if version != VERSION:
+        raise TraceError(f'unsupported version {version}')
+
+    mask_size = (key_count + 7) // 8
+    values = [0] * key_count
+    time_us = 0
+    pos = HEADER.size
+
+    while pos < len(data):
+        dt = 0
+        shift = 0
+        while True:
+            if pos >= len(data):
+                raise TraceError(f'truncated frame at {pos}')
+            byte = data[pos]
+            pos += 1
+            dt |= (byte & 0x7f) << shift
+            shift += 7
+            if not byte & 0x80:
+                break
+
+        mask = data[pos:pos + mask_size]
+        if len(mask) < mask_size:
+            raise TraceError(f'truncated frame at {pos}')
+        pos += mask_size
+
+        for i in range(key_count):
+            if mask[i // 8] & (1 << (i % 8)):
+                if pos + 2 > len(data):
+                    raise TraceError(f'truncated frame at {pos}')
+                values[i] = data[pos] | (data[pos + 1] << 8)
+                pos += 2
+
+        time_us += dt
+        yield time_us, values
+
+
+def key_count(data):
+    return HEADER.unpack_from(data)[2]
+
+
+def encode(keys, frames):
+    '''Return trace of 'keys' keys from (dt_us, values) 'frames'.'''
+    out = bytearray(HEADER.pack(MAGIC, VERSION, keys))
+    prev = None
+    for dt, values in frames:
+        while True:
+            byte = dt & 0x7f
+            dt >>= 7
+            out.append(byte | (0x80 if dt else 0))
+            if not dt:
+                break
+        mask = bytearray((keys + 7) // 8)
+        changed = []
+        for i, v in enumerate(values):
+            if prev is None or v != prev[i]:
+                mask[i // 8] |= 1 << (i % 8)
+                changed.append(v)
+        out += mask
+        for v in changed:
+            out += struct.pack('<H', v)
+        prev = list(values)
+    return bytes(out)
+
+
+def parse_taps(path, keys):
+    '''Return (press ms, key, hold ms) taps of synth script 'path'.'''
+    taps = []
+    for n, line in enumerate(open(path), 1):
+        line = line.split('#')[0].strip()
+        if not line:
+            continue
+        try:
+            start, key, hold = (int(f) for f in line.split())
+        except ValueError:
+            raise TraceError(f'{path}:{n}: expected <time ms> <key> <hold ms>')
+        if not 0 <= key < keys or start < 0 or hold <= 0:
+            raise TraceError(f'{path}:{n}: tap out of range')
+        taps.append((start, key, hold))
+    return taps
+
+
+def cmd_record(args):
+    import serial  # pyserial
+
+    written = 0
+    # Opening the port asserts DTR, which starts the recording
+    with serial.Serial(args.port, timeout=0.5) as port, \
+            open(args.output, 'wb') as out:
+        print(f'Recording to {args.output}, Ctrl-C to stop', file=sys.stderr)
+        try:
+            while True:
+                chunk = port.read(4096)
+                if chunk:
+                    out.write(chunk)
+                    written += len(chunk)
+        except KeyboardInterrupt:
+            pass
+    print(f'{written} bytes recorded', file=sys.stderr)
+
+
+def cmd_info(args):
+    data = open(args.trace, 'rb').read()
+    frames = 0
+    time_us = 0
+    try:
+        for time_us, _ in decode(data):
+            frames += 1
+    except TraceError as e:
+        print(f'warning: {e}', file=sys.stderr)
+    print(f'keys:     {key_count(data)}')
+    print(f'frames:   {frames}')
+    print(f'duration: {time_us / 1e6:.3f} s')
+    if frames > 1:
+        print(f'rate:     {frames / (time_us / 1e6):.1f} Hz')
+    print(f'size:     {len(data)} bytes')
+
+
+def cmd_dump(args):
+    data = open(args.trace, 'rb').read()
+    keys = key_count(data)
+    print(','.join(['time_us'] + [f'key{i}' for i in range(keys)]))
+    for time_us, values in decode(data):
+        print(','.join(str(v) for v in [time_us] + values))
+
+
+def cmd_synth(args):
+    taps = parse_taps(args.script, args.keys)
+    end_ms = max((s + h for s, _, h in taps), default=0) + args.tail
+    frames = []
+    for t in range(end_ms):
+        values = [args.rest] * args.keys
+        for start, key, hold in taps:
+            if start <= t < start + hold:
+                values[key] = args.bottom
+        # One frame per kscan poll, replay consumes a frame per poll
+        frames.append((0 if t == 0 else 1000, values))
+    data = encode(args.keys, frames)
+    with open(args.output, 'wb') as out:
+        out.write(data)
+    print(f'{len(taps)} taps, {len(frames)} frames, {len(data)} bytes',
+          file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Record and inspect raw key value traces')
+    sub = parser.add_subparsers(dest='cmd', required=True)
+
+    p = sub.add_parser('record', help='record trace streamed by the keyboard')
+    p.add_argument('port', help='trace serial port (CDC ACM)')
+    p.add_argument('output', help='trace file to write')
+    p.set_defaults(func=cmd_record)
+
+    p = sub.add_parser('info', help='print trace summary')
+    p.add_argument('trace')
+    p.set_defaults(func=cmd_info)
+
+    p = sub.add_parser('dump', help='print trace frames as CSV')
+    p.add_argument('trace')
+    p.set_defaults(func=cmd_dump)
+
+    p = sub.add_parser('synth', help='build trace from a tap script')
+    p.add_argument('script', help='tap script, see above')
+    p.add_argument('output', help='trace file to write')
+    p.add_argument('--keys', type=int, required=True,
+                   help='key count of the keyboard')
+    p.add_argument('--rest', type=int, default=500,
+                   help='raw value of released keys')
+    p.add_argument('--bottom', type=int, default=1023,
+                   help='raw value of pressed keys')
+    p.add_argument('--tail', type=int, default=1000,
+                   help='ms of idle frames after the last tap')
+    p.set_defaults(func=cmd_synth)
+
+    args = parser.parse_args()
+    try:
+        args.func(args)
+    except TraceError as e:
+        sys.exit(f'error: {e}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+
+'''kb_travel_lut.py
+
+Generate the switch profile travel LUTs of
+lib/keyboard/kb_travel/kb_travel_profiles.h (see
+include/lib/keyboard/kb_travel.h):
+
+  kb_travel_lut.py > lib/keyboard/kb_travel/kb_travel_profiles.h
+  kb_travel_lut.py --check     # print the worst interpolation error
+
+Magnetic profiles model the magnet as a dipole on the sensor axis, the
+field falls with the cube of the distance:
+
+  B(x) ~ 1 / (gap + travel - x)^3
+
+where 'x' is the key travel, 'travel' the total travel and 'gap' the
+magnet to sensor distance of a bottomed out key. Sensor output is taken
+as linear in B between the calibrated minimum (released) and maximum
+(bottomed out), so every LUT entry i holds the travel at normalized
+output i / size.'''
+
+import argparse
+import sys
+
+LUT_BITS = 8
+LUT_SIZE = 1 << LUT_BITS
+
+# name: (total travel, bottom out gap or None for linear), 0.01 mm
+PROFILES = {
+    'MAGNETIC_4MM': (400, 150),
+    'MAGNETIC_3_5MM': (350, 150),
+    'LINEAR_4MM': (400, None),
+}
+
+
+def output(x, travel, gap):
+    '''Normalized sensor output at travel 'x'.'''
+    if gap is None:
+        return x / travel
+
+    def field(x):
+        return (gap + travel - x) ** -3
+    return (field(x) - field(0)) / (field(travel) - field(0))
+
+
+def travel_at(s, travel, gap):
+    '''Travel at normalized sensor output 's'.'''
+    if gap is None:
+        return s * travel
+    rest = (gap + travel) ** -3
+    bottom = gap ** -3
+    return gap + travel - (rest + s * (bottom - rest)) ** (-1 / 3)
+
+
+def lut(travel, gap):
+    return [round(travel_at(i / LUT_SIZE, travel, gap))
+            for i in range(LUT_SIZE + 1)]
+
+
+def max_error(travel, gap, steps=10000):
+    '''Worst difference of the interpolated LUT from the model.'''
+    table = lut(travel, gap)
+    worst = 0
+    for k in range(steps + 1):
+        x = travel * k / steps
+        pos = output(x, travel, gap) * LUT_SIZE
+        i = min(int(pos), LUT_SIZE - 1)
+        y = table[i] + (table[i + 1] - table[i]) * (pos - i)
+        worst = max(worst, abs(y - x))
+    return worst
+
+
+def macro_line(text):
+    '''Line of a multi-line macro, backslash at column 80.'''
+    return text.ljust(79) + '\\\n'
+
+
+def emit(out):
+    out.write('// Generated by scripts/kb_travel_lut.py, do not edit\n\n')
+    out.write('#ifndef LIB_KB_TRAVEL_PROFILES_H_\n')
+    out.write('#define LIB_KB_TRAVEL_PROFILES_H_\n\n')
+    out.write(f'#define KB_TRAVEL_PROFILES_LUT_BITS {LUT_BITS}\n')
+    for name, (travel, gap) in PROFILES.items():
+        table = lut(travel, gap)
+        model = 'linear' if gap is None else \
+            f'dipole, {gap / 100:.2f} mm bottom out gap'
+        out.write(f'\n// {travel / 100:.2f} mm travel, {model}\n')
+        out.write(f'#define KB_TRAVEL_PROFILE_{name}_TOTAL {travel}\n')
+        out.write(macro_line(f'#define KB_TRAVEL_PROFILE_{name}_LUT'))
+        out.write(macro_line('    {'))
+        for i in range(0, len(table), 10):
+            row = ', '.join(str(v) for v in table[i:i + 10])
+            if i + 10 < len(table):
+                row += ','
+            out.write(macro_line('        ' + row))
+        out.write('    }\n')
+    out.write('\n#endif // LIB_KB_TRAVEL_PROFILES_H_\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Switch profile travel LUT generator')
+    parser.add_argument('--check', action='store_true',
+                        help='print interpolation errors instead')
+    args = parser.parse_args()
+
+    if args.check:
+        for name, (travel, gap) in PROFILES.items():
+            print(f'{name}: {max_error(travel, gap):.2f} (0.01 mm)')
+        return
+    emit(sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
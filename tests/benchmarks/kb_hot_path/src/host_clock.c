@@ -0,0 +1,12 @@
+// SPDX-License-Identifier: Apache-2.0
+
+// Runs in the native simulator runner context, next to the host libc
+
+#include <stdint.h>
+#include <time.h>
+
+uint64_t bench_host_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
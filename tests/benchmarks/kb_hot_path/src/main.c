@@ -0,0 +1,348 @@
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * @file key processing hot path benchmarks
+ *
+ * Measures cost per call of the keyboard pipeline stages for the key count
+ * of the build (see testcase.yaml), with different press densities and
+ * keymap sizes. Every result is printed as a single JSON line:
+ *
+ *   KB_BENCH {"bench":"edge_detection","keys":22,"density_pct":25,
+ *             "calls":2000,"cycles":51234,"cycles_per_call":25.61,
+ *             "hz":1000000000}
+ *
+ * 'cycles' are ticks of a 'hz' clock: the host monotonic clock on native_sim
+ * (simulated time does not advance while code runs) and the system cycle
+ * counter everywhere else.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/iterable_sections.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/ztest.h>
+
+#include "kb_handle_common.h"
+
+#include <lib/keyboard/kb_depth.h>
+#include <lib/keyboard/kb_fn_keystroke.h>
+#include <lib/keyboard/kb_handle.h>
+#include <lib/keyboard/kb_keys.h>
+#include <lib/keyboard/kb_mappings.h>
+#include <lib/keyboard/kb_settings.h>
+#include <lib/keyboard/kb_travel.h>
+
+#define KEY_COUNT CONFIG_KB_KEY_COUNT
+#define MAX_RULES CONFIG_KB_MAX_RULES_PER_KEY
+
+#define ITERATIONS 2000
+
+#if CONFIG_ARCH_POSIX
+
+uint64_t bench_host_clock_ns(void);
+
+#define BENCH_HZ 1000000000u
+
+static inline uint32_t bench_now() {
+    return (uint32_t)bench_host_clock_ns();
+}
+
+#else
+
+#define BENCH_HZ sys_clock_hw_cycles_per_sec()
+
+static inline uint32_t bench_now() {
+    return k_cycle_get_32();
+}
+
+#endif // CONFIG_ARCH_POSIX
+
+static void bench_report(const char *bench, const char *param,
+                         uint32_t param_value, uint32_t calls,
+                         uint32_t cycles) {
+    char param_json[32] = "";
+    if (param) {
+        snprintk(param_json, sizeof(param_json), "\"%s\":%u,", param,
+                 param_value);
+    }
+
+    uint64_t per_call = ((uint64_t)cycles * 100u) / calls;
+
+    printk("KB_BENCH {\"bench\":\"%s\",\"keys\":%u,%s\"calls\":%u,"
+           "\"cycles\":%u,\"cycles_per_call\":%u.%02u,\"hz\":%u}\n",
+           bench, KEY_COUNT, param_json, calls, cycles,
+           (uint32_t)(per_call / 100u), (uint32_t)(per_call % 100u),
+           (uint32_t)BENCH_HZ);
+}
+
+// Fixed seed, so every build benchmarks the same key patterns
+static uint32_t rand_state;
+
+static uint32_t bench_rand() {
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+static kb_settings_t settings;
+static kb_map_rule_t rules[KEY_COUNT][MAX_RULES];
+
+// Every key gets 'count' rules, LAYER0 one being the last like in the
+// default keymaps, so LAYER0 lookups walk all of them
+static void keymap_init(uint8_t count) {
+    for (uint8_t k = 0; k < KEY_COUNT; ++k) {
+        for (uint8_t r = 0; r < count - 1; ++r) {
+            rules[k][r] = RULE(r + 1, KEY_F1 + r);
+        }
+        rules[k][count - 1] = RULE(LAYER0, KEY_A + k % 26);
+        settings.mappings[k] = (kb_key_rules_t){
+            .rules = rules[k],
+            .count = count,
+        };
+    }
+}
+
+static void keymap_set(uint8_t key_index, uint8_t code) {
+    rules[key_index][0] = RULE(LAYER0, code);
+    settings.mappings[key_index] = (kb_key_rules_t){
+        .rules = rules[key_index],
+        .count = 1,
+    };
+}
+
+static void press(uint8_t key_index) {
+    press_ctx_t ctx = {
+        .mappings = settings.mappings,
+        .settings = &settings,
+        .index = key_index,
+    };
+    on_press_default(&ctx);
+}
+
+static void release(uint8_t key_index) {
+    press_ctx_t ctx = {
+        .mappings = settings.mappings,
+        .settings = &settings,
+        .index = key_index,
+    };
+    on_release_default(&ctx);
+}
+
+static void kb_hot_path_before(void *fixture) {
+    rand_state = 0x2545f491;
+    memset(&settings, 0, sizeof(settings));
+    // Raw value of the default actuation point
+    const kb_settings_key_calib_t uncalibrated = {0};
+    uint16_t threshold = kb_settings_calib_rescale_threshold(
+        &uncalibrated, CONFIG_KB_SETTINGS_DEFAULT_MINIMUM,
+        CONFIG_KB_SETTINGS_DEFAULT_MAXIMUM);
+    for (uint8_t k = 0; k < KEY_COUNT; ++k) {
+        settings.keys_calibration[k] = (kb_settings_key_calib_t){
+            .minimum = CONFIG_KB_SETTINGS_DEFAULT_MINIMUM,
+            .maximum = CONFIG_KB_SETTINGS_DEFAULT_MAXIMUM,
+            .threshold = threshold,
+        };
+#if CONFIG_KB_TRAVEL
+        kb_travel_key_init(&settings.key_travel[k],
+                           CONFIG_KB_SETTINGS_DEFAULT_MINIMUM,
+                           CONFIG_KB_SETTINGS_DEFAULT_MAXIMUM);
+#endif // CONFIG_KB_TRAVEL
+    }
+    keymap_init(1);
+}
+
+static uint32_t edges;
+
+static void on_edge(uint8_t idx, const kb_settings_t *s) {
+    edges++;
+}
+
+static void bitmap_fill(uint32_t *bm, uint8_t density) {
+    memset(bm, 0, KB_BITMAP_WORDS * sizeof(uint32_t));
+    for (uint8_t k = 0; k < KEY_COUNT; ++k) {
+        if (bench_rand() % 100 < density) {
+            bm[k / KB_WORD_BITS] |= BIT(k % KB_WORD_BITS);
+        }
+    }
+}
+
+ZTEST(kb_hot_path, test_edge_detection) {
+    static const uint8_t densities[] = {0, 5, 25, 50};
+
+    for (size_t d = 0; d < ARRAY_SIZE(densities); ++d) {
+        uint32_t bm[2][KB_BITMAP_WORDS];
+        uint32_t prev[KB_BITMAP_WORDS] = {0};
+        uint32_t changes = 0;
+
+        bitmap_fill(bm[0], densities[d]);
+        bitmap_fill(bm[1], densities[d]);
+        for (size_t w = 0; w < KB_BITMAP_WORDS; ++w) {
+            changes += __builtin_popcount(bm[0][w] ^ bm[1][w]);
+        }
+
+        edge_detection(&settings, prev, bm[0], KB_BITMAP_BYTECNT, on_edge,
+                       on_edge);
+        edges = 0;
+
+        // Alternate between both bitmaps, every call sees all changes
+        uint32_t start = bench_now();
+        for (uint32_t i = 0; i < ITERATIONS; ++i) {
+            edge_detection(&settings, prev, bm[(i + 1) & 1],
+                           KB_BITMAP_BYTECNT, on_edge, on_edge);
+        }
+        uint32_t cycles = bench_now() - start;
+
+        zassert_equal(edges, changes * ITERATIONS, "%u edges, expected %u",
+                      edges, changes * ITERATIONS);
+        bench_report("edge_detection", "density_pct", densities[d],
+                     ITERATIONS, cycles);
+    }
+}
+
+ZTEST(kb_hot_path, test_translate_key) {
+    static const uint8_t rule_counts[] = {1, 2, 3, MAX_RULES};
+
+    for (size_t r = 0; r < ARRAY_SIZE(rule_counts); ++r) {
+        volatile uint32_t sink = 0;
+
+        keymap_init(rule_counts[r]);
+
+        uint32_t start = bench_now();
+        for (uint32_t i = 0; i < ITERATIONS; ++i) {
+            for (uint8_t k = 0; k < KEY_COUNT; ++k) {
+                uint8_t code;
+                kb_mapping_translate_key(&settings.mappings[k], LAYER0,
+                                         &code);
+                sink += code;
+            }
+        }
+        uint32_t cycles = bench_now() - start;
+
+        zassert_not_equal(sink, 0);
+        bench_report("kb_mapping_translate_key", "rules", rule_counts[r],
+                     ITERATIONS * KEY_COUNT, cycles);
+    }
+}
+
+// Key that does not complete any FN keystroke on its own, so the lookup
+// walks all keystrokes without triggering one
+static int fn_probe_key() {
+    for (uint8_t k = 1; k < KEY_COUNT; ++k) {
+        bool used = false;
+        STRUCT_SECTION_FOREACH(kb_fn_keystroke, keystroke) {
+            if (keystroke->count == 1 && keystroke->keys[0] == k) {
+                used = true;
+                break;
+            }
+        }
+        if (!used) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+ZTEST(kb_hot_path, test_process_fn_buff) {
+    size_t keystrokes = 0;
+    STRUCT_SECTION_COUNT(kb_fn_keystroke, &keystrokes);
+
+    int probe = fn_probe_key();
+    zassert_true(probe > 0, "No free key for FN keystroke lookup");
+
+    keymap_set(0, KEY_FN);
+    keymap_set(probe, KEY_A);
+
+    press(0);
+
+    // Every press looks the FN buffer up, the release empties it again
+    uint32_t start = bench_now();
+    for (uint32_t i = 0; i < ITERATIONS; ++i) {
+        press(probe);
+        release(probe);
+    }
+    uint32_t cycles = bench_now() - start;
+
+    release(0);
+
+    bench_report("process_fn_buff", "keystrokes", keystrokes, ITERATIONS,
+                 cycles);
+}
+
+ZTEST(kb_hot_path, test_handle_hid_report) {
+    // Up to 8 regular keys, modifiers after them
+    static const uint8_t pressed_counts[] = {0, 1, 6, 10};
+
+    for (uint8_t k = 0; k < MIN(KEY_COUNT, 10); ++k) {
+        keymap_set(k, k < 8 ? KEY_A + k : KEY_LEFTCONTROL + k - 8);
+    }
+
+    for (size_t p = 0; p < ARRAY_SIZE(pressed_counts); ++p) {
+        uint8_t pressed = MIN(pressed_counts[p], KEY_COUNT);
+        for (uint8_t k = 0; k < pressed; ++k) {
+            press(k);
+        }
+
+        // No USB/BT in this build, only the report is built
+        uint32_t start = bench_now();
+        for (uint32_t i = 0; i < ITERATIONS; ++i) {
+            handle_hid_report();
+        }
+        uint32_t cycles = bench_now() - start;
+
+        for (uint8_t k = 0; k < pressed; ++k) {
+            release(k);
+        }
+
+        bench_report("handle_hid_report", "pressed", pressed, ITERATIONS,
+                     cycles);
+    }
+}
+
+ZTEST(kb_hot_path, test_depth_percentage) {
+    static uint16_t values[KEY_COUNT];
+    volatile uint32_t sink = 0;
+
+    for (uint8_t k = 0; k < KEY_COUNT; ++k) {
+        values[k] = bench_rand() % 1024;
+    }
+
+    uint32_t start = bench_now();
+    for (uint32_t i = 0; i < ITERATIONS; ++i) {
+        for (uint8_t k = 0; k < KEY_COUNT; ++k) {
+            sink += kb_depth_percentage(&settings.keys_calibration[k],
+                                        values[k]);
+        }
+    }
+    uint32_t cycles = bench_now() - start;
+
+    ARG_UNUSED(sink);
+    bench_report("kb_depth_percentage", NULL, 0, ITERATIONS * KEY_COUNT,
+                 cycles);
+}
+
+#if CONFIG_KB_TRAVEL
+
+ZTEST(kb_hot_path, test_travel_from_value) {
+    static uint16_t values[KEY_COUNT];
+    volatile uint32_t sink = 0;
+
+    for (uint8_t k = 0; k < KEY_COUNT; ++k) {
+        values[k] = bench_rand() % 1024;
+    }
+
+    uint32_t start = bench_now();
+    for (uint32_t i = 0; i < ITERATIONS; ++i) {
+        for (uint8_t k = 0; k < KEY_COUNT; ++k) {
+            sink += kb_travel_from_value(&settings.key_travel[k], values[k]);
+        }
+    }
+    uint32_t cycles = bench_now() - start;
+
+    ARG_UNUSED(sink);
+    bench_report("kb_travel_from_value", NULL, 0, ITERATIONS * KEY_COUNT,
+                 cycles);
+}
+
+#endif // CONFIG_KB_TRAVEL
+
+ZTEST_SUITE(kb_hot_path, NULL, NULL, kb_hot_path_before, NULL, NULL);
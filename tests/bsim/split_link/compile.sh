@@ -0,0 +1,46 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+
+# Build the split link BabbleSim images into ${BSIM_OUT_PATH}/bin:
+#
+#   bs_nrf52_bsim_ykb_split_link_master       left half
+#   bs_nrf52_bsim_ykb_split_link_master_drop  left half dropping the link
+#   bs_nrf52_bsim_ykb_split_link_slave        right half typing typing.keys
+#
+# Then run tests_scripts/*.sh, e.g.
+#   tests/bsim/split_link/compile.sh
+#   tests/bsim/split_link/tests_scripts/latency.sh
+
+set -ue
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must be defined}"
+: "${BSIM_COMPONENTS_PATH:?BSIM_COMPONENTS_PATH must be defined}"
+
+here=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+root=$(cd "${here}/../../.." && pwd)
+out=${BUILD_DIR:-${root}/build/bsim_split_link}
+bin=${BSIM_OUT_PATH}/bin
+
+mkdir -p "${out}" "${bin}"
+
+python3 "${root}/scripts/kb_trace.py" synth "${here}/typing.keys" \
+    "${out}/typing.ykbt" --keys 22
+
+# build <name> <extra conf files> [cmake args...]
+build() {
+    local name=$1
+    local conf=$2
+    shift 2
+    west build -p -b nrf52_bsim -d "${out}/${name}" "${root}/app" -- \
+        -DEXTRA_CONF_FILE="${conf}" "$@"
+    cp "${out}/${name}/zephyr/zephyr.exe" \
+        "${bin}/bs_nrf52_bsim_ykb_split_link_${name}"
+}
+
+master="conf/left.conf;${here}/probe.conf;${here}/master.conf"
+slave="conf/right.conf;${here}/probe.conf;${here}/slave.conf"
+
+build master "${master}"
+build master_drop "${master};${here}/master_drop.conf"
+build slave "${slave}" \
+    -DCONFIG_KB_TRACE_REPLAY_FILE=\"${out}/typing.ykbt\"
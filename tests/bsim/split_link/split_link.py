@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+
+'''split_link.py
+
+Match split link probe lines (CONFIG_BT_INTER_KB_COMM_PROBE) of a master
+and a slave simulation log and print delivery statistics as JSON:
+
+  split_link.py master.log slave.log [--max-loss N] [--expect-reconnect]
+
+Both devices run on the same simulated clock, so slave 'tx' and master
+'rx' timestamps are directly comparable. Key bitmaps are only sent when
+they change and notifications arrive in order, so every 'tx' is matched
+with the next 'rx' carrying the same bitmap.'''
+
+import argparse
+import json
+import re
+import sys
+
+PROBE = re.compile(r'\bikb (\w+) (\d+) ?([0-9a-f]*)')
+
+# 'tx' without an 'rx' within this time is lost
+MAX_LATENCY_US = 1000000
+
+
+def events(path):
+    '''Return (event, time us, data) probe events of log 'path'.'''
+    result = []
+    with open(path, errors='replace') as log:
+        for line in log:
+            m = PROBE.search(line)
+            if m:
+                result.append((m[1], int(m[2]), m[3]))
+    return result
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def latencies(sent, received):
+    '''Return latencies (us) of delivered 'sent' events.'''
+    result = []
+    j = 0
+    for tx_time, bitmap in sent:
+        for k in range(j, len(received)):
+            rx_time, rx_bitmap = received[k]
+            if rx_time - tx_time > MAX_LATENCY_US:
+                break
+            if rx_time >= tx_time and rx_bitmap == bitmap:
+                result.append(rx_time - tx_time)
+                j = k + 1
+                break
+    return result
+
+
+def reconnects(master):
+    '''Return times (us) from every link loss to the link being usable.'''
+    result = []
+    lost = None
+    for event, time, _ in master:
+        if event in ('drop', 'down') and lost is None:
+            lost = time
+        elif event == 'ready' and lost is not None:
+            result.append(time - lost)
+            lost = None
+    return result
+
+
+def analyze(master, slave):
+    sent = [(t, d) for e, t, d in slave if e == 'tx']
+    received = [(t, d) for e, t, d in master if e == 'rx']
+    lat = latencies(sent, received)
+    ready = [t for e, t, _ in master if e == 'ready']
+    rec = reconnects(master)
+
+    result = {
+        'link_ready_us': ready[0] if ready else None,
+        'sent': len(sent),
+        'send_errors': sum(1 for e, _, _ in slave if e == 'txerr'),
+        'delivered': len(lat),
+        'lost': len(sent) - len(lat),
+        'disconnects': sum(1 for e, _, _ in master if e == 'down'),
+        'reconnect_us': rec,
+    }
+    if lat:
+        result['latency_us'] = {
+            'mean': sum(lat) // len(lat),
+            'p50': percentile(lat, 50),
+            'p99': percentile(lat, 99),
+            'max': max(lat),
+        }
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Split link delivery statistics')
+    parser.add_argument('master_log')
+    parser.add_argument('slave_log')
+    parser.add_argument('--max-loss', type=int,
+                        help='fail if more bitmaps are lost or not sent')
+    parser.add_argument('--expect-link', action='store_true',
+                        help='fail if the link never becomes ready')
+    parser.add_argument('--expect-reconnect', action='store_true',
+                        help='fail unless every link loss is recovered')
+    args = parser.parse_args()
+
+    result = analyze(events(args.master_log), events(args.slave_log))
+    print(json.dumps(result, indent=2))
+
+    errors = []
+    if (args.expect_link or args.max_loss is not None or
+            args.expect_reconnect) and result['link_ready_us'] is None:
+        errors.append('link never became ready')
+    if args.max_loss is not None:
+        missed = result['lost'] + result['send_errors']
+        if missed > args.max_loss:
+            errors.append(f'{missed} bitmaps lost, {args.max_loss} allowed')
+        if not result['sent']:
+            errors.append('nothing sent')
+    if args.expect_reconnect:
+        if not result['reconnect_us']:
+            errors.append('link never recovered')
+        if result['disconnects'] > len(result['reconnect_us']):
+            errors.append('link lost at the end of the simulation')
+    for e in errors:
+        print(f'error: {e}', file=sys.stderr)
+    sys.exit(1 if errors else 0)
+
+
+if __name__ == '__main__':
+    main()
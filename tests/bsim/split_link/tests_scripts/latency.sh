@@ -0,0 +1,11 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+
+# Key event delivery latency over a clean radio channel, nothing may be
+# lost
+
+source "$(dirname "${BASH_SOURCE[0]}")/_split_link.source"
+
+set -ueo pipefail
+
+run_split_link ykb_split_link_latency master --max-loss 0
@@ -0,0 +1,15 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+
+# Key event delivery over a lossy channel: path loss close to the radio
+# sensitivity makes packets fail CRC and get retransmitted. Set
+# ATTENUATION (dB) to sweep, only the link has to survive.
+
+source "$(dirname "${BASH_SOURCE[0]}")/_split_link.source"
+
+set -ueo pipefail
+
+attenuation=${ATTENUATION:-93}
+
+run_split_link ykb_split_link_lossy_${attenuation} master --expect-link -- \
+    -channel=NtNcable -argschannel -at="${attenuation}"
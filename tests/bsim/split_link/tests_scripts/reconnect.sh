@@ -0,0 +1,11 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+
+# Master drops the split link while typing (master_drop.conf), the link
+# has to come back and the reconnect time is reported
+
+source "$(dirname "${BASH_SOURCE[0]}")/_split_link.source"
+
+set -ueo pipefail
+
+run_split_link ykb_split_link_reconnect master_drop --expect-reconnect
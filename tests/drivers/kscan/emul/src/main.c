@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * @file test emulated kscan driver
+ *
+ * This suite verifies that the emulated kscan driver reports key values
+ * and pressed keys the same way as the ADC based drivers.
+ */
+
+#include <zephyr/ztest.h>
+
+#include <drivers/kscan.h>
+#include <drivers/kscan_emul.h>
+
+#define KEY_COUNT DT_PROP(DT_NODELABEL(kscan), key_count)
+#define BITMAP_WORDS DIV_ROUND_UP(KEY_COUNT, 32)
+
+static const struct device *kscan = DEVICE_DT_GET(DT_NODELABEL(kscan));
+
+static uint16_t thresholds[KEY_COUNT];
+static uint16_t values[KEY_COUNT];
+static uint32_t bitmap[BITMAP_WORDS];
+
+static void *kscan_emul_setup(void) {
+    zassert_true(device_is_ready(kscan), "kscan is not ready");
+    return NULL;
+}
+
+static void kscan_emul_before(void *fixture) {
+    static const uint16_t zeros[KEY_COUNT];
+
+    kscan_emul_set_source(kscan, NULL, NULL);
+    kscan_emul_set_values(kscan, zeros, KEY_COUNT);
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        thresholds[i] = 500;
+    }
+    memset(values, 0xff, sizeof(values));
+    memset(bitmap, 0, sizeof(bitmap));
+}
+
+ZTEST(kscan_emul, test_key_count) {
+    zassert_equal(kscan_emul_key_count(kscan), KEY_COUNT);
+}
+
+ZTEST(kscan_emul, test_set_value_bounds) {
+    zassert_equal(kscan_emul_set_value(kscan, KEY_COUNT - 1, 1), 0);
+    zassert_equal(kscan_emul_set_value(kscan, KEY_COUNT, 1), -EINVAL);
+    zassert_equal(kscan_emul_set_values(kscan, values, KEY_COUNT + 1),
+                  -EINVAL);
+}
+
+ZTEST(kscan_emul, test_poll_normal) {
+    kscan_emul_set_value(kscan, 0, 499);
+    kscan_emul_set_value(kscan, 1, 500);
+    kscan_emul_set_value(kscan, 33, 1023);
+
+    int res = kscan_poll_normal(kscan, bitmap, thresholds, values);
+    zassert_equal(res, 2, "unexpected pressed count %d", res);
+
+    zassert_equal(bitmap[0], BIT(1));
+    zassert_equal(bitmap[1], BIT(1));
+
+    zassert_equal(values[0], 499);
+    zassert_equal(values[1], 500);
+    zassert_equal(values[2], 0);
+    zassert_equal(values[33], 1023);
+}
+
+ZTEST(kscan_emul, test_poll_normal_thresholds) {
+    thresholds[5] = 100;
+    kscan_emul_set_value(kscan, 5, 200);
+    kscan_emul_set_value(kscan, 6, 200);
+
+    int res = kscan_poll_normal(kscan, bitmap, thresholds, NULL);
+    zassert_equal(res, 1);
+    zassert_equal(bitmap[0], BIT(5));
+}
+
+ZTEST(kscan_emul, test_poll_race) {
+    kscan_emul_set_value(kscan, 3, 700);
+    kscan_emul_set_value(kscan, 34, 900);
+    kscan_emul_set_value(kscan, 35, 400);
+
+    int res = kscan_poll_race(kscan, bitmap, thresholds, values);
+    zassert_equal(res, 34, "unexpected pressed index %d", res);
+    zassert_equal(bitmap[0], 0);
+    zassert_equal(bitmap[1], BIT(2));
+    zassert_equal(values[3], 700);
+    zassert_equal(values[35], 400);
+}
+
+ZTEST(kscan_emul, test_poll_race_none) {
+    kscan_emul_set_value(kscan, 3, 100);
+
+    int res = kscan_poll_race(kscan, bitmap, thresholds, values);
+    zassert_equal(res, -1);
+    zassert_equal(bitmap[0], 0);
+    zassert_equal(bitmap[1], 0);
+    zassert_equal(values[3], 100);
+    zassert_equal(values[4], 0);
+}
+
+struct ramp {
+    size_t key;
+    uint16_t step;
+    int calls;
+};
+
+static void ramp_source(const struct device *dev, uint16_t *vals,
+                        size_t count, void *user_data) {
+    struct ramp *ramp = user_data;
+
+    zassert_equal(dev, kscan);
+    zassert_equal(count, KEY_COUNT);
+
+    vals[ramp->key] += ramp->step;
+    ramp->calls++;
+}
+
+ZTEST(kscan_emul, test_source) {
+    struct ramp ramp = {.key = 7, .step = 200};
+    kscan_emul_set_source(kscan, ramp_source, &ramp);
+
+    zassert_equal(kscan_poll_normal(kscan, bitmap, thresholds, values), 0);
+    zassert_equal(values[7], 200);
+    zassert_equal(kscan_poll_normal(kscan, bitmap, thresholds, values), 0);
+    zassert_equal(values[7], 400);
+    zassert_equal(kscan_poll_normal(kscan, bitmap, thresholds, values), 1);
+    zassert_equal(values[7], 600);
+    zassert_equal(bitmap[0], BIT(7));
+    zassert_equal(ramp.calls, 3);
+
+    kscan_emul_set_source(kscan, NULL, NULL);
+    kscan_poll_normal(kscan, bitmap, thresholds, values);
+    zassert_equal(values[7], 600);
+    zassert_equal(ramp.calls, 3);
+}
+
+ZTEST_SUITE(kscan_emul, NULL, kscan_emul_setup, kscan_emul_before, NULL,
+            NULL);
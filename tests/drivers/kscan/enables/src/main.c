@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * @file test 'enables' kscan driver
+ *
+ * This suite verifies that the ADC based kscan driver reports raw values of
+ * released keys too, as the calibration relies on them.
+ */
+
+#include <zephyr/drivers/adc/adc_emul.h>
+#include <zephyr/ztest.h>
+
+#include <drivers/kscan.h>
+
+#define KEY_COUNT DT_PROP_BY_IDX(DT_NODELABEL(kscan), map, 0)
+#define BITMAP_WORDS DIV_ROUND_UP(KEY_COUNT, 32)
+
+#define ADC_CHANNEL 0
+#define ADC_INPUT_MV 1000
+
+static const struct device *kscan = DEVICE_DT_GET(DT_NODELABEL(kscan));
+static const struct device *adc = DEVICE_DT_GET(DT_NODELABEL(adc0));
+
+static uint16_t thresholds[KEY_COUNT];
+static uint16_t values[KEY_COUNT];
+static uint16_t pressed_values[KEY_COUNT];
+static uint32_t bitmap[BITMAP_WORDS];
+
+static void *kscan_enables_setup(void) {
+    zassert_true(device_is_ready(kscan), "kscan is not ready");
+    zassert_true(device_is_ready(adc), "adc is not ready");
+    return NULL;
+}
+
+static void kscan_enables_before(void *fixture) {
+    zassert_ok(adc_emul_const_value_set(adc, ADC_CHANNEL, ADC_INPUT_MV));
+
+    // Reference values with every key pressed
+    memset(thresholds, 0, sizeof(thresholds));
+    memset(bitmap, 0, sizeof(bitmap));
+    zassert_equal(
+        kscan_poll_normal(kscan, bitmap, thresholds, pressed_values),
+        KEY_COUNT);
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        zassert_not_equal(pressed_values[i], 0);
+        zassert_not_equal(pressed_values[i], UINT16_MAX);
+    }
+
+    // No key can reach these
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        thresholds[i] = UINT16_MAX;
+    }
+    memset(values, 0xff, sizeof(values));
+    memset(bitmap, 0, sizeof(bitmap));
+}
+
+ZTEST(kscan_enables, test_poll_normal_released_values) {
+    int res = kscan_poll_normal(kscan, bitmap, thresholds, values);
+    zassert_equal(res, 0, "unexpected pressed count %d", res);
+    zassert_equal(bitmap[0], 0);
+
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        zassert_equal(values[i], pressed_values[i],
+                      "key %u value %u, expected %u", (unsigned)i, values[i],
+                      pressed_values[i]);
+    }
+}
+
+ZTEST(kscan_enables, test_poll_race_released_values) {
+    int res = kscan_poll_race(kscan, bitmap, thresholds, values);
+    zassert_equal(res, -1, "unexpected pressed index %d", res);
+
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        zassert_equal(values[i], pressed_values[i],
+                      "key %u value %u, expected %u", (unsigned)i, values[i],
+                      pressed_values[i]);
+    }
+}
+
+ZTEST(kscan_enables, test_poll_normal_mixed) {
+    thresholds[1] = 0;
+
+    int res = kscan_poll_normal(kscan, bitmap, thresholds, values);
+    zassert_equal(res, 1);
+    zassert_equal(bitmap[0], BIT(1));
+
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        zassert_equal(values[i], pressed_values[i]);
+    }
+}
+
+ZTEST_SUITE(kscan_enables, NULL, kscan_enables_setup, kscan_enables_before,
+            NULL, NULL);
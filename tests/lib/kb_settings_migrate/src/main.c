@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * @file test keyboard settings record migrations
+ *
+ * This suite verifies that registered migrations upgrade a stored record
+ * payload version by version, including layouts which used to be larger than
+ * the current one.
+ */
+
+#include <zephyr/ztest.h>
+
+#include <lib/keyboard/kb_settings_migrate.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+// Record kind no real record uses, so the test migrations never apply to them
+#define TEST_KIND ((enum kb_settings_rec_kind)0x7f)
+
+// Version 1, larger than the current layout
+struct test_payload_v1 {
+    uint32_t minimum;
+    uint32_t maximum;
+    uint32_t unused[4];
+};
+
+// Version 2
+struct test_payload_v2 {
+    uint16_t minimum;
+    uint16_t maximum;
+};
+
+// Version 3, current
+struct test_payload_v3 {
+    uint16_t minimum;
+    uint16_t maximum;
+    uint16_t threshold;
+};
+
+static uint8_t buf[sizeof(struct test_payload_v1)];
+
+static int test_migrate_v1(uint8_t *payload, size_t size, size_t buf_size) {
+    struct test_payload_v1 v1;
+    if (size != sizeof(v1)) {
+        return -EINVAL;
+    }
+    memcpy(&v1, payload, sizeof(v1));
+
+    struct test_payload_v2 v2 = {
+        .minimum = v1.minimum,
+        .maximum = v1.maximum,
+    };
+    memcpy(payload, &v2, sizeof(v2));
+    return sizeof(v2);
+}
+
+KB_SETTINGS_MIGRATION_DEFINE(test_v1, TEST_KIND, 1, test_migrate_v1);
+
+static int test_migrate_v2(uint8_t *payload, size_t size, size_t buf_size) {
+    struct test_payload_v2 v2;
+    if (size != sizeof(v2) || buf_size < sizeof(struct test_payload_v3)) {
+        return -EINVAL;
+    }
+    memcpy(&v2, payload, sizeof(v2));
+
+    struct test_payload_v3 v3 = {
+        .minimum = v2.minimum,
+        .maximum = v2.maximum,
+        .threshold = (v2.minimum + v2.maximum) / 2,
+    };
+    memcpy(payload, &v3, sizeof(v3));
+    return sizeof(v3);
+}
+
+KB_SETTINGS_MIGRATION_DEFINE(test_v2, TEST_KIND, 2, test_migrate_v2);
+
+static void kb_settings_migrate_before(void *fixture) {
+    memset(buf, 0, sizeof(buf));
+}
+
+ZTEST(kb_settings_migrate, test_migrate_larger_record) {
+    struct test_payload_v1 v1 = {
+        .minimum = 500,
+        .maximum = 1023,
+        .unused = {1, 2, 3, 4},
+    };
+    memcpy(buf, &v1, sizeof(v1));
+
+    uint16_t version = 1;
+    uint16_t size = sizeof(v1);
+    zassert_ok(kb_settings_migrate(TEST_KIND, &version, 2, buf, &size,
+                                   sizeof(buf)));
+    zassert_equal(version, 2);
+    zassert_equal(size, sizeof(struct test_payload_v2));
+
+    struct test_payload_v2 v2;
+    memcpy(&v2, buf, sizeof(v2));
+    zassert_equal(v2.minimum, 500);
+    zassert_equal(v2.maximum, 1023);
+}
+
+ZTEST(kb_settings_migrate, test_migrate_chain) {
+    struct test_payload_v1 v1 = {
+        .minimum = 100,
+        .maximum = 900,
+    };
+    memcpy(buf, &v1, sizeof(v1));
+
+    uint16_t version = 1;
+    uint16_t size = sizeof(v1);
+    zassert_ok(kb_settings_migrate(TEST_KIND, &version, 3, buf, &size,
+                                   sizeof(buf)));
+    zassert_equal(version, 3);
+    zassert_equal(size, sizeof(struct test_payload_v3));
+
+    struct test_payload_v3 v3;
+    memcpy(&v3, buf, sizeof(v3));
+    zassert_equal(v3.minimum, 100);
+    zassert_equal(v3.maximum, 900);
+    zassert_equal(v3.threshold, 500);
+}
+
+ZTEST(kb_settings_migrate, test_migrate_current) {
+    uint16_t version = 3;
+    uint16_t size = sizeof(struct test_payload_v3);
+    zassert_ok(kb_settings_migrate(TEST_KIND, &version, 3, buf, &size,
+                                   sizeof(buf)));
+    zassert_equal(version, 3);
+    zassert_equal(size, sizeof(struct test_payload_v3));
+}
+
+ZTEST(kb_settings_migrate, test_migrate_missing) {
+    uint16_t version = 3;
+    uint16_t size = sizeof(struct test_payload_v3);
+    zassert_equal(kb_settings_migrate(TEST_KIND, &version, 4, buf, &size,
+                                      sizeof(buf)),
+                  -ENOENT);
+    zassert_equal(version, 3);
+}
+
+ZTEST(kb_settings_migrate, test_migrate_failed_step) {
+    struct test_payload_v2 v2 = {
+        .minimum = 100,
+        .maximum = 900,
+    };
+    memcpy(buf, &v2, sizeof(v2));
+
+    // No room for the version 3 layout
+    uint16_t version = 2;
+    uint16_t size = sizeof(v2);
+    zassert_equal(kb_settings_migrate(TEST_KIND, &version, 3, buf, &size,
+                                      sizeof(v2)),
+                  -EINVAL);
+    zassert_equal(version, 2);
+    zassert_equal(size, sizeof(v2));
+}
+
+ZTEST_SUITE(kb_settings_migrate, NULL, NULL, kb_settings_migrate_before, NULL,
+            NULL);